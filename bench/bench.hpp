@@ -0,0 +1,151 @@
+#pragma once
+#include <mkl_parallel.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//== minimal benchmark harness shared by the bench_* executables.
+//   every case runs for each thread count, repeats until `min_time` seconds (at least `min_iters` calls)
+//   and reports the median time per call with the derived GB/s and GFLOP/s.
+//   results go to stdout as a table and, with --json, to a file read by bench/compare.py.
+//
+//   usage: bench_x [--sizes 256,1024] [--threads 1,4] [--min-time 0.2] [--filter name] [--json out.json]
+namespace bench
+{
+    struct config
+    {
+        std::vector<size_t> sizes;
+        std::vector<int> threads;
+        double min_time = 0.2;
+        int min_iters = 3;
+        std::string filter;
+        std::string json;
+    };
+    struct record
+    {
+        std::string name, type;
+        size_t size = 0;
+        int threads = 1;
+        size_t iterations = 0;
+        double seconds = 0;     // median per call
+        double gbps = 0, gflops = 0;
+    };
+
+    template<class T> std::vector<T> parse_list(const std::string& s)
+    {
+        std::vector<T> values;
+        std::stringstream ss(s);
+        for(std::string item; std::getline(ss, item, ',');) if(!item.empty()) values.push_back(T(std::stoll(item)));
+        return values;
+    }
+    inline config parse(int argc, char** argv, std::vector<size_t> default_sizes)
+    {
+        config cfg;
+        cfg.sizes = std::move(default_sizes);
+        cfg.threads = {1, mkl::max_threads()};
+        for(int i = 1; i + 1 < argc; i += 2){
+            const std::string key = argv[i], value = argv[i + 1];
+            if("--sizes" == key)         cfg.sizes = parse_list<size_t>(value);
+            else if("--threads" == key)  cfg.threads = parse_list<int>(value);
+            else if("--min-time" == key) cfg.min_time = std::stod(value);
+            else if("--filter" == key)   cfg.filter = value;
+            else if("--json" == key)     cfg.json = value;
+            else std::fprintf(stderr, "unknown option %s\n", key.c_str());
+        }
+        std::sort(cfg.threads.begin(), cfg.threads.end());
+        cfg.threads.erase(std::unique(cfg.threads.begin(), cfg.threads.end()), cfg.threads.end());
+        return cfg;
+    }
+
+    template<class T> const char* type_name()
+    {
+        if constexpr(std::is_same_v<T, float>)                     return "float";
+        else if constexpr(std::is_same_v<T, double>)               return "double";
+        else if constexpr(std::is_same_v<T, std::complex<float>>)  return "complex<float>";
+        else if constexpr(std::is_same_v<T, std::complex<double>>) return "complex<double>";
+        else return "other";
+    }
+
+    class suite
+    {
+    public:
+        suite(std::string name, config cfg) : name_(std::move(name)), cfg_(std::move(cfg))
+        {
+            std::printf("%-28s %-16s %10s %4s %12s %10s %10s\n", name_.c_str(), "type", "size", "thr", "time(us)", "GB/s", "GFLOP/s");
+        }
+        ~suite() {write_json();}
+        const config& cfg() const {return cfg_;}
+
+        //== f() is one call of the measured operation; bytes and flops are per call (0 : not reported)
+        template<class F> void run(const std::string& name, const std::string& type, size_t size, double bytes, double flops, F&& f)
+        {
+            if(!cfg_.filter.empty() && std::string::npos == name.find(cfg_.filter)) return;
+            for(int t : cfg_.threads){
+                mkl::execution_policy policy = mkl::current_execution_policy();
+                policy.num_threads = t;
+                mkl::set_execution_policy(policy);
+                f();    // warm up : page faults, plan caches, arena
+                std::vector<double> samples;
+                double total = 0;
+                while(total < cfg_.min_time || int(samples.size()) < cfg_.min_iters){
+                    const auto t0 = std::chrono::steady_clock::now();
+                    f();
+                    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                    samples.push_back(s);
+                    total += s;
+                }
+                std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+                record r;
+                r.name = name;
+                r.type = type;
+                r.size = size;
+                r.threads = t;
+                r.iterations = samples.size();
+                r.seconds = samples[samples.size() / 2];
+                r.gbps = bytes / r.seconds * 1e-9;
+                r.gflops = flops / r.seconds * 1e-9;
+                std::printf("%-28s %-16s %10zu %4d %12.2f %10.2f %10.2f\n", name.c_str(), type.c_str(), size, t, r.seconds * 1e6, r.gbps, r.gflops);
+                records_.push_back(r);
+            }
+        }
+
+    private:
+        void write_json() const
+        {
+            if(cfg_.json.empty()) return;
+            std::ofstream out(cfg_.json);
+            if(!out){
+                std::fprintf(stderr, "cannot write %s\n", cfg_.json.c_str());
+                return;
+            }
+            out << "{\n  \"suite\": \"" << name_ << "\",\n  \"max_threads\": " << mkl::max_threads() << ",\n  \"results\": [\n";
+            for(size_t i = 0; i < records_.size(); i++){
+                const auto& r = records_[i];
+                char line[512];
+                std::snprintf(line, sizeof(line),
+                    "    {\"name\": \"%s\", \"type\": \"%s\", \"size\": %zu, \"threads\": %d, \"iterations\": %zu, "
+                    "\"seconds\": %.9g, \"gbps\": %.6g, \"gflops\": %.6g}%s\n",
+                    r.name.c_str(), r.type.c_str(), r.size, r.threads, r.iterations, r.seconds, r.gbps, r.gflops,
+                    i + 1 < records_.size() ? "," : "");
+                out << line;
+            }
+            out << "  ]\n}\n";
+        }
+
+        std::string name_;
+        config cfg_;
+        std::vector<record> records_;
+    };
+
+    //== nominal flop count of an n-point FFT, 5 n log2 n, half of it for real input
+    inline double fft_flops(size_t n, bool real)
+    {
+        return (real ? 2.5 : 5.0) * double(n) * std::log2(double(std::max<size_t>(n, 2)));
+    }
+}
@@ -0,0 +1,49 @@
+#include "bench.hpp"
+#include <mkl_krylov.hpp>
+
+//== single-vector against block Krylov-Schur on a 5-point Laplacian (CSR) and on a dense matrix.
+//   sizes are the grid side of the Laplacian, the dense matrix is 3000 x 3000.
+template<class Op> void run(bench::suite& s, const std::string& name, const Op& op, size_t size, int nev)
+{
+    for(int b : {1, 2, 4, 8}){
+        mkl::krylov::options opt;
+        opt.nev = nev;
+        opt.block_size = b;
+        opt.tol = 1e-8;
+        opt.target = mkl::krylov::which::largest_real;
+        s.run(name + "_block" + std::to_string(b), "double", size, 0, 0, [&]{ mkl::krylov::eigsh(op, opt); });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto cfg = bench::parse(argc, argv, {300});
+    cfg.min_iters = 1;
+    bench::suite s("block_krylov", cfg);
+    const int nev = 16;
+    for(size_t grid : s.cfg().sizes){
+        const size_t n = grid * grid;
+        std::vector<MKL_INT> row_ptr{0}, col_idx;
+        std::vector<double> values;
+        for(size_t y = 0; y < grid; y++){
+            for(size_t x = 0; x < grid; x++){
+                const size_t i = y * grid + x;
+                if(y > 0)        {col_idx.push_back(MKL_INT(i - grid)); values.push_back(-1);}
+                if(x > 0)        {col_idx.push_back(MKL_INT(i - 1));    values.push_back(-1);}
+                col_idx.push_back(MKL_INT(i)); values.push_back(4);
+                if(x + 1 < grid) {col_idx.push_back(MKL_INT(i + 1));    values.push_back(-1);}
+                if(y + 1 < grid) {col_idx.push_back(MKL_INT(i + grid)); values.push_back(-1);}
+                row_ptr.push_back(MKL_INT(col_idx.size()));
+            }
+        }
+        auto laplacian = mkl::sparse_operator<double>::csr(n, n, row_ptr.data(), col_idx.data(), values.data());
+        run(s, "laplacian", laplacian, grid, nev);
+    }
+
+    const size_t nd = 3000;
+    std::vector<double> A(nd * nd);
+    uniform_random<double> rand(-1, 1);
+    for(size_t j = 0; j < nd; j++) for(size_t i = 0; i <= j; i++) A[j * nd + i] = A[i * nd + j] = rand();
+    run(s, "dense", mkl::dense_operator<double>(nd, nd, A.data(), nd), nd, nev);
+    return 0;
+}
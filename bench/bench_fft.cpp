@@ -0,0 +1,93 @@
+#include "bench.hpp"
+#include <mkl_fft.hpp>
+#include <mkl_small_fft.hpp>
+#include <mkl_half_spectrum.hpp>
+#include <mkl_arena.hpp>
+
+//== 2D transforms of n x n images : plan creation against execution, r2c / c2c, in and out of place
+template<class T> void bench_fft(bench::suite& s, size_t n)
+{
+    using plan_t = mekil::fft_plan<T>;
+    using complex_type = complex_t<T>;
+    constexpr bool real = is_real_v<T>;
+    const std::string type = bench::type_name<T>();
+    const size_t N = n * n, nf = real ? n * (n / 2 + 1) : N;
+    const double flops = bench::fft_flops(N, real);
+    const double bytes = double(N * sizeof(T) + nf * sizeof(complex_type));
+
+    s.run(real ? "plan_r2c" : "plan_c2c", type, n, 0, 0, [&]{
+        auto plan = plan_t::directional({MKL_LONG(n), MKL_LONG(n)}, true);
+    });
+
+    mkl::aligned_vector<T> image(N, T(1));
+    mkl::aligned_vector<complex_type> freq(nf);
+    auto forward = plan_t::directional({MKL_LONG(n), MKL_LONG(n)}, true);
+    auto backward = plan_t::directional({MKL_LONG(n), MKL_LONG(n)}, false);
+    s.run(real ? "r2c_out_of_place" : "c2c_out_of_place", type, n, bytes, flops, [&]{
+        forward.forward(image.data(), freq.data());
+    });
+    s.run(real ? "c2r_out_of_place" : "c2c_backward_out_of_place", type, n, bytes, flops, [&]{
+        backward.backward(freq.data(), image.data());
+    });
+
+    //== mklFFT runs real transforms in place for rank 1 only : the real case is one n*n long line
+    const std::vector<MKL_LONG> dims = real ? std::vector<MKL_LONG>{MKL_LONG(N)} : std::vector<MKL_LONG>{MKL_LONG(n), MKL_LONG(n)};
+    mkl::aligned_vector<T> inplace(real ? 2 * (N / 2 + 1) : N, T(1));
+    auto plan = plan_t::row_major(dims, true);
+    s.run(real ? "r2c_in_place_1d" : "c2c_in_place", type, n, double(inplace.size() * sizeof(T)) * 2, flops, [&]{
+        plan.forward(inplace.data());
+    });
+}
+
+//== n * n / 32 independent 32-point transforms : one batched descriptor against the codelet
+template<class T> void bench_small_fft(bench::suite& s, size_t n)
+{
+    using complex_type = complex_t<T>;
+    constexpr size_t M = 32;
+    constexpr bool real = is_real_v<T>;
+    using codelet = mekil::small_fft<T, M>;
+    const std::string type = bench::type_name<T>();
+    const size_t count = n * n / M;
+    const double flops = bench::fft_flops(M, real) * count;
+    const double bytes = double(count * (M * sizeof(T) + codelet::fourier_size * sizeof(complex_type)));
+    mkl::aligned_vector<T> blocks(count * M, T(1));
+    mkl::aligned_vector<complex_type> freq(count * codelet::fourier_size);
+
+    auto plan = mekil::fft_plan<T>::directional({MKL_LONG(M)}, true, int(count));
+    s.run("batch32_descriptor", type, n, bytes, flops, [&]{ plan.forward(blocks.data(), freq.data()); });
+    s.run("batch32_codelet", type, n, bytes, flops, [&]{
+        codelet::forward_batch(blocks.data(), M, freq.data(), codelet::fourier_size, count);
+    });
+}
+
+//== gaussian low pass of an n x n real image : fused on the r2c half spectrum against the full c2c spectrum
+template<class R> void bench_spectral_filter(bench::suite& s, size_t n)
+{
+    const std::string type = bench::type_name<R>();
+    const mkl::filter::gaussian gain{0.1};
+    mkl::half_spectrum<R> half({n, n});
+    std::fill(half.data(), half.data() + half.size(), std::complex<R>(1));
+    s.run("filter_half_spectrum", type, n, double(2 * half.size() * sizeof(std::complex<R>)), 0, [&]{ half.view().apply(gain); });
+
+    mkl::aligned_vector<std::complex<R>> full(n * n, std::complex<R>(1));
+    std::vector<double> f(n);
+    for(size_t i = 0; i < n; i++) f[i] = double(i < (n + 1) / 2 ? (long long)i : (long long)i - (long long)n) / double(n);
+    s.run("filter_full_spectrum", type, n, double(2 * full.size() * sizeof(std::complex<R>)), 0, [&]{
+        for(size_t y = 0; y < n; y++) for(size_t x = 0; x < n; x++) full[y * n + x] *= R(gain(f[x], f[y]));
+    });
+}
+
+int main(int argc, char** argv)
+{
+    bench::suite s("fft", bench::parse(argc, argv, {256, 1024, 2048}));
+    for(size_t n : s.cfg().sizes){
+        bench_fft<float>(s, n);
+        bench_fft<std::complex<float>>(s, n);
+        bench_fft<double>(s, n);
+        bench_fft<std::complex<double>>(s, n);
+        bench_small_fft<float>(s, n);
+        bench_small_fft<std::complex<float>>(s, n);
+        bench_spectral_filter<float>(s, n);
+    }
+    return 0;
+}
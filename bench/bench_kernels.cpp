@@ -0,0 +1,42 @@
+#include "bench.hpp"
+#include <mkl_intergral.hpp>
+#include <mkl_linespace.hpp>
+#include <mkl_vec.hpp>
+#include <mkl_arena.hpp>
+
+//== streaming kernels on n x n images : integral images, element-wise vec ops, grids
+template<class T> void bench_kernels(bench::suite& s, size_t n)
+{
+    const std::string type = bench::type_name<T>();
+    const size_t N = n * n;
+    const vec2<size_t> shape{n, n};
+    mkl::aligned_vector<T> a(N, T(1)), b(N, T(2)), c(N);
+    const double flop_scale = is_complex_v<T> ? 2 : 1;
+
+    s.run("integral_x", type, n, 2.0 * N * sizeof(T), flop_scale * N, [&]{ mkl::integral_x(shape, a.data()); });
+    s.run("integral_y", type, n, 2.0 * N * sizeof(T), flop_scale * N, [&]{ mkl::integral_y(shape, a.data()); });
+    s.run("integral_xy", type, n, 2.0 * N * sizeof(T), flop_scale * 2 * N, [&]{ mkl::integral_xy(shape, a.data()); });
+
+    s.run("vec_add", type, n, 3.0 * N * sizeof(T), flop_scale * N, [&]{ mkl::vec::add<T>(int(N), a.data(), b.data(), c.data()); });
+    s.run("vec_mul", type, n, 3.0 * N * sizeof(T), (is_complex_v<T> ? 6 : 1) * double(N), [&]{ mkl::vec::mul<T>(int(N), a.data(), b.data(), c.data()); });
+    s.run("vec_self_add", type, n, 3.0 * N * sizeof(T), flop_scale * N, [&]{ mkl::vec::self_add<T>(int(N), a.data(), c.data()); });
+
+    if constexpr(is_real_v<T>){
+        mkl::aligned_vector<vec2<T>> grid(N);
+        s.run("meshgrid_2d", type, n, double(N * sizeof(vec2<T>)), 0, [&]{
+            mkl::meshgrid_nd(grid.data(), vec<size_t, 2>{n, n}, vec<T, 2>{0, 0}, vec<T, 2>{1, 1});
+        });
+        s.run("linespace", type, N, double(N * sizeof(T)), double(N) * 2, [&]{ mkl::linespace(c.data(), N, T(0), T(0.5)); });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bench::suite s("kernels", bench::parse(argc, argv, {512, 2048, 4096}));
+    for(size_t n : s.cfg().sizes){
+        bench_kernels<float>(s, n);
+        bench_kernels<double>(s, n);
+        bench_kernels<std::complex<float>>(s, n);
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "bench.hpp"
+#include <mkl_reshape.hpp>
+#include <mkl_arena.hpp>
+
+//== memory bound reshapes of n x n images, GB/s counts one read and one write of every moved element
+template<class T> void bench_reshape(bench::suite& s, size_t n)
+{
+    const std::string type = bench::type_name<T>();
+    const size_t N = n * n;
+    const double bytes = 2.0 * N * sizeof(T);
+    mkl::aligned_vector<T> a(N, T(1)), b(N, T(0));
+
+    s.run("fftshift_even", type, n, bytes, 0, [&]{ fftshift(a.data(), n, n); });
+    s.run("fftshift_odd", type, n - 1, 2.0 * (n - 1) * (n - 1) * sizeof(T), 0, [&]{ fftshift(a.data(), n - 1, n - 1); });
+
+    const size_t h = n / 2;
+    s.run("crop_to_center", type, n, 2.0 * h * h * sizeof(T), 0, [&]{
+        crop_to<T, T>(b.data(), {h, h}, {0, 0}, a.data(), {n, n}, {n / 4, n / 4});
+    });
+    if constexpr(is_complex_v<T>){
+        //== complex -> real part of the central crop
+        mkl::aligned_vector<real_t<T>> r(h * h);
+        s.run("crop_to_real", type, n, double(h * h) * (sizeof(T) + sizeof(real_t<T>)), 0, [&]{
+            crop_to<T, real_t<T>>(r.data(), {h, h}, {0, 0}, a.data(), {n, n}, {n / 4, n / 4});
+        });
+    }
+    //== crop, convert to the other precision and normalize in one pass
+    using TOther = std::conditional_t<is_s<real_t<T>>, std::conditional_t<is_real_v<T>, double, std::complex<double>>,
+                                      std::conditional_t<is_real_v<T>, float, std::complex<float>>>;
+    mkl::aligned_vector<TOther> o(h * h);
+    s.run("crop_convert_scale", type, n, double(h * h) * (sizeof(T) + sizeof(TOther)), 0, [&]{
+        crop_convert<T, TOther>(o.data(), {h, h}, {0, 0}, a.data(), {n, n}, {n / 4, n / 4}, real_t<TOther>(1) / real_t<TOther>(N));
+    });
+
+    s.run("transpose", type, n, bytes, 0, [&]{ transpose<T, true>(a.data(), b.data(), {int(n), int(n)}); });
+    s.run("transpose_inplace", type, n, bytes, 0, [&]{ transpose_inplace<T, true>(a.data(), {n, n}); });
+    s.run("transpose_batch", type, n, bytes, 0, [&]{ transpose_batch<T, true>(a.data(), b.data(), {n / 4, n / 4}, 16); });
+
+    //== n x n/4 x 4 volume, innermost axis moved outermost
+    const std::vector<int> shape{int(n), int(n / 4), 4}, perm{2, 0, 1};
+    auto identity = [](T v){ return v; };
+    s.run("permuteND_3d", type, n, bytes, 0, [&]{
+        permuteND<T, T, decltype(identity), true>(a.data(), b.data(), shape, perm, identity);
+    });
+}
+
+int main(int argc, char** argv)
+{
+    bench::suite s("reshape", bench::parse(argc, argv, {512, 2048, 4096}));
+    for(size_t n : s.cfg().sizes){
+        bench_reshape<float>(s, n);
+        bench_reshape<double>(s, n);
+        bench_reshape<std::complex<float>>(s, n);
+    }
+    return 0;
+}
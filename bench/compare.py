@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Compare bench_* JSON results against a stored baseline and flag regressions.
+
+usage:
+    compare.py RESULT.json [RESULT.json ...] --baseline DIR [--threshold 0.10] [--update]
+
+Every result file is matched with DIR/<suite>.json by (name, type, size, threads).
+A case regresses when its median time grows by more than the threshold.
+--update stores the given results as the new baseline instead of comparing.
+The exit code is 1 when at least one case regressed, so the script can gate CI.
+"""
+import argparse
+import json
+import os
+import shutil
+import sys
+
+
+def load(path):
+    with open(path, 'r') as file:
+        data = json.load(file)
+    cases = {}
+    for r in data.get('results', []):
+        cases[(r['name'], r['type'], r['size'], r['threads'])] = r
+    return data.get('suite', os.path.splitext(os.path.basename(path))[0]), cases
+
+
+def compare(result_path, baseline_dir, threshold):
+    suite, current = load(result_path)
+    baseline_path = os.path.join(baseline_dir, suite + '.json')
+    if not os.path.exists(baseline_path):
+        print('* %s: no baseline at %s, skipped' % (suite, baseline_path))
+        return 0
+    _, baseline = load(baseline_path)
+
+    regressions = 0
+    print('* %s against %s' % (suite, baseline_path))
+    print('    %-28s %-16s %8s %4s %12s %12s %8s' % ('name', 'type', 'size', 'thr', 'base(us)', 'now(us)', 'change'))
+    for key in sorted(current):
+        if key not in baseline:
+            continue
+        before, now = baseline[key]['seconds'], current[key]['seconds']
+        change = now / before - 1 if before > 0 else 0
+        flag = ''
+        if change > threshold:
+            flag = '  REGRESSION'
+            regressions += 1
+        elif change < -threshold:
+            flag = '  faster'
+        name, type_name, size, threads = key
+        print('    %-28s %-16s %8d %4d %12.2f %12.2f %+7.1f%%%s' % (name, type_name, size, threads, before * 1e6, now * 1e6, change * 100, flag))
+    missing = sorted(set(baseline) - set(current))
+    if missing:
+        print('    %d baseline cases not measured' % len(missing))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('results', nargs='+')
+    parser.add_argument('--baseline', required=True, help='directory holding one <suite>.json per benchmark')
+    parser.add_argument('--threshold', type=float, default=0.10, help='relative slowdown that counts as a regression')
+    parser.add_argument('--update', action='store_true', help='store the results as the new baseline')
+    args = parser.parse_args()
+
+    if args.update:
+        os.makedirs(args.baseline, exist_ok=True)
+        for path in args.results:
+            suite, _ = load(path)
+            shutil.copyfile(path, os.path.join(args.baseline, suite + '.json'))
+            print('* baseline %s updated from %s' % (suite, path))
+        return 0
+
+    regressions = sum(compare(path, args.baseline, args.threshold) for path in args.results)
+    if regressions:
+        print('%d regression(s) beyond %.0f%%' % (regressions, args.threshold * 100))
+        return 1
+    print('no regression beyond %.0f%%' % (args.threshold * 100))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -31,6 +31,7 @@ endif()
 
 find_package(MKL CONFIG REQUIRED PATHS /opt/intel/oneapi/mkl/latest/)
 message(STATUS "Imported oneMKL targets: ${MKL_IMPORTED_TARGETS}")
+find_package(OpenMP REQUIRED)
 
 # FFT
 find_package(PkgConfig QUIET)
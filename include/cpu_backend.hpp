@@ -0,0 +1,58 @@
+#pragma once
+#include "mkl_basic_operator.h"
+
+//== runtime-dispatched kernel table exported by libmekil.
+//   the hand-written loops are compiled once per instruction set inside the library,
+//   the best set supported by the cpu is picked when the library is loaded (cpuid),
+//   MEKIL_ISA=generic|sse42|avx2|avx512 in the environment or set_cpu_isa() override it.
+//   callers get the fast kernels without building the header templates with -march flags.
+//
+//   shapes of the fft entries are column-major (fastest axis first) like mklFFT::make_plan,
+//   inverse transforms are normalized by 1/N.
+namespace mekil
+{
+    enum class cpu_isa : int
+    {
+        generic = 0,
+        sse42,
+        avx2,
+        avx512,
+    };
+    const char* cpu_isa_name(cpu_isa isa);
+    //== best instruction set of this cpu that the library was built with
+    cpu_isa detect_cpu_isa();
+    cpu_isa active_cpu_isa();
+    //== switch every backend table to `isa`, false (and no change) when the cpu cannot run it
+    bool set_cpu_isa(cpu_isa isa);
+
+    template<class T> struct cpu_backend
+    {
+        using complex_type = complex_t<T>;
+
+        bool enable = false;
+        cpu_isa isa = cpu_isa::generic;
+        void (*VtAdd)(int n, const T* x, T* y) = nullptr;                  // y += x
+        void (*integral_x)(vec2<size_t> shape, T* image) = nullptr;
+        void (*integral_y)(vec2<size_t> shape, T* image) = nullptr;
+        void (*integral_xy)(vec2<size_t> shape, T* image) = nullptr;
+        //== in place, real data uses the padded layout of mekil::cal_fft_memory_layout.
+        //   plans are cached per thread and shape, so repeated transforms of one shape commit once
+        void (*self_fft)(T* self, const size_t* shape, size_t rank) = nullptr;
+        void (*self_ifft)(T* self, const size_t* shape, size_t rank) = nullptr;
+        void (*fft)(const T* from, complex_type* to, const size_t* shape, size_t rank) = nullptr;
+        void (*ifft)(const complex_type* from, T* to, const size_t* shape, size_t rank) = nullptr;
+    };
+    //== table of the active instruction set
+    template<class T> const cpu_backend<T>& backend();
+    //== table of a given instruction set, enable == false when it is not built in
+    template<class T> const cpu_backend<T>& backend(cpu_isa isa);
+
+    extern template const cpu_backend<float>& backend<float>();
+    extern template const cpu_backend<double>& backend<double>();
+    extern template const cpu_backend<complex_t<float>>& backend<complex_t<float>>();
+    extern template const cpu_backend<complex_t<double>>& backend<complex_t<double>>();
+    extern template const cpu_backend<float>& backend<float>(cpu_isa);
+    extern template const cpu_backend<double>& backend<double>(cpu_isa);
+    extern template const cpu_backend<complex_t<float>>& backend<complex_t<float>>(cpu_isa);
+    extern template const cpu_backend<complex_t<double>>& backend<complex_t<double>>(cpu_isa);
+}
@@ -0,0 +1,244 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include <array>
+#include <atomic>
+#include <new>
+#include <vector>
+#ifdef __linux__
+#   include <sys/mman.h>
+#endif
+
+//== scratch memory for the temporaries of the library.
+//   every block is 64-byte aligned (one cache line, one AVX-512 register) and comes from mkl_malloc.
+//   freed blocks are kept in a thread-local arena of power-of-two size classes and handed out again,
+//   so a hot path that requests the same temporaries on every call stops touching the system allocator
+//   after its first call. blocks of huge_page_bytes and more are 2 MiB aligned, advised as huge pages and
+//   sized to the next multiple of 2 MiB instead of the next power of two (a 1 GiB buffer takes 1 GiB) :
+//   they are cached by exact size, and freed directly when larger than the cache limit.
+//
+//   aligned_allocator<T> plugs the arena into the STL (aligned_vector<T>),
+//   scratch<T> is a fixed-size buffer for function-local temporaries.
+//   counters() reports the system allocations so tests can check for a zero-allocation steady state.
+namespace mkl::memory
+{
+    constexpr size_t alignment = 64;
+    constexpr size_t huge_page_bytes = size_t(2) << 20;
+
+    struct statistics
+    {
+        size_t system_allocations = 0;  // mkl_malloc calls
+        size_t system_frees = 0;        // mkl_free calls
+        size_t arena_hits = 0;          // requests served from a cached block
+    };
+    namespace detail
+    {
+        struct atomic_statistics
+        {
+            std::atomic<size_t> system_allocations{0}, system_frees{0}, arena_hits{0};
+        };
+        inline atomic_statistics& global_statistics()
+        {
+            static atomic_statistics stats;
+            return stats;
+        }
+        inline std::atomic<size_t>& cache_limit_bytes()
+        {
+            static std::atomic<size_t> limit{size_t(256) << 20};
+            return limit;
+        }
+
+        //== size class c holds blocks of 64 << c bytes
+        inline size_t size_class(size_t bytes)
+        {
+            size_t c = 0;
+            while((alignment << c) < bytes) c++;
+            return c;
+        }
+        //== bytes actually allocated for a request : a size class below huge_page_bytes, whole 2 MiB pages above
+        inline size_t block_bytes(size_t bytes)
+        {
+            if(bytes >= huge_page_bytes) return (bytes + huge_page_bytes - 1) / huge_page_bytes * huge_page_bytes;
+            return alignment << size_class(bytes);
+        }
+        inline void* system_allocate(size_t bytes)
+        {
+            const bool huge = bytes >= huge_page_bytes;
+            void* p = mkl_malloc(bytes, int(huge ? huge_page_bytes : alignment));
+            if(nullptr == p) throw std::bad_alloc();
+#ifdef __linux__
+            if(huge) madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+            global_statistics().system_allocations++;
+            return p;
+        }
+        inline void system_free(void* p)
+        {
+            mkl_free(p);
+            global_statistics().system_frees++;
+        }
+
+        class arena
+        {
+        public:
+            ~arena()
+            {
+                release();
+                alive() = false;
+            }
+            //== false once the thread-local arena of this thread is destroyed (thread or program exit)
+            static bool& alive()
+            {
+                static thread_local bool flag = true;
+                return flag;
+            }
+            void* allocate(size_t bytes)
+            {
+                if(bytes >= huge_page_bytes){
+                    const size_t size = block_bytes(bytes);
+                    for(size_t i = 0; i < huge_.size(); i++){
+                        if(huge_[i].first != size) continue;
+                        void* p = huge_[i].second;
+                        huge_.erase(huge_.begin() + i);
+                        cached_ -= size;
+                        global_statistics().arena_hits++;
+                        return p;
+                    }
+                    return system_allocate(size);
+                }
+                const size_t c = size_class(bytes);
+                if(c < free_.size() && !free_[c].empty()){
+                    void* p = free_[c].back();
+                    free_[c].pop_back();
+                    cached_ -= alignment << c;
+                    global_statistics().arena_hits++;
+                    return p;
+                }
+                return system_allocate(alignment << c);
+            }
+            void deallocate(void* p, size_t bytes)
+            {
+                if(bytes >= huge_page_bytes){
+                    const size_t size = block_bytes(bytes);
+                    if(cached_ + size > cache_limit_bytes().load(std::memory_order_relaxed)){
+                        system_free(p);
+                        return;
+                    }
+                    huge_.emplace_back(size, p);
+                    cached_ += size;
+                    return;
+                }
+                const size_t c = size_class(bytes);
+                if(cached_ + (alignment << c) > cache_limit_bytes().load(std::memory_order_relaxed)){
+                    system_free(p);
+                    return;
+                }
+                if(c >= free_.size()) free_.resize(c + 1);
+                free_[c].push_back(p);
+                cached_ += alignment << c;
+            }
+            void release()
+            {
+                for(auto& blocks : free_){
+                    for(void* p : blocks) system_free(p);
+                    blocks.clear();
+                }
+                for(auto& block : huge_) system_free(block.second);
+                huge_.clear();
+                cached_ = 0;
+            }
+            size_t cached_bytes() const {return cached_;}
+
+        private:
+            std::vector<std::vector<void*>> free_;
+            std::vector<std::pair<size_t, void*>> huge_;   // (block bytes, block), few entries
+            size_t cached_ = 0;
+        };
+        inline arena& thread_arena()
+        {
+            static thread_local arena a;
+            return a;
+        }
+    }
+
+    //== 64-byte aligned block of at least `bytes` bytes from the arena of the calling thread
+    inline void* allocate(size_t bytes)
+    {
+        if(0 == bytes) bytes = 1;
+        if(!detail::arena::alive()) return detail::system_allocate(detail::block_bytes(bytes));
+        return detail::thread_arena().allocate(bytes);
+    }
+    //== `bytes` must be the size passed to allocate. the block may be freed by another thread,
+    //   it then joins the arena of that thread.
+    inline void deallocate(void* p, size_t bytes)
+    {
+        if(nullptr == p) return;
+        if(0 == bytes) bytes = 1;
+        if(!detail::arena::alive()) return detail::system_free(p);
+        detail::thread_arena().deallocate(p, bytes);
+    }
+
+    inline statistics counters()
+    {
+        auto& s = detail::global_statistics();
+        return {s.system_allocations.load(), s.system_frees.load(), s.arena_hits.load()};
+    }
+    inline void reset_counters()
+    {
+        auto& s = detail::global_statistics();
+        s.system_allocations = 0;
+        s.system_frees = 0;
+        s.arena_hits = 0;
+    }
+    //== bytes kept by the arena of the calling thread
+    inline size_t cached_bytes() {return detail::thread_arena().cached_bytes();}
+    //== return the cached blocks of the calling thread to the system
+    inline void release_cached() {detail::thread_arena().release();}
+    //== per-thread cap on cached bytes, blocks beyond it go back to the system
+    inline void set_cache_limit(size_t bytes) {detail::cache_limit_bytes() = bytes;}
+}
+
+namespace mkl
+{
+    template<class T> struct aligned_allocator
+    {
+        using value_type = T;
+        static_assert(alignof(T) <= memory::alignment);
+
+        aligned_allocator() noexcept = default;
+        template<class U> aligned_allocator(const aligned_allocator<U>&) noexcept {}
+
+        T* allocate(size_t n) {return static_cast<T*>(memory::allocate(n * sizeof(T)));}
+        void deallocate(T* p, size_t n) noexcept {memory::deallocate(p, n * sizeof(T));}
+
+        template<class U> bool operator==(const aligned_allocator<U>&) const noexcept {return true;}
+        template<class U> bool operator!=(const aligned_allocator<U>&) const noexcept {return false;}
+    };
+    template<class T> using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+    //== fixed-size uninitialized buffer of trivially copyable values, returned to the arena on scope exit
+    template<class T> class scratch
+    {
+    public:
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        explicit scratch(size_t n) : n_(n), p_(static_cast<T*>(memory::allocate(n * sizeof(T)))) {}
+        scratch(size_t n, const T& value) : scratch(n) {std::fill(p_, p_ + n_, value);}
+        ~scratch() {memory::deallocate(p_, n_ * sizeof(T));}
+        scratch(const scratch&) = delete;
+        scratch& operator=(const scratch&) = delete;
+
+        T* data() {return p_;}
+        const T* data() const {return p_;}
+        size_t size() const {return n_;}
+        T& operator[](size_t i) {return p_[i];}
+        const T& operator[](size_t i) const {return p_[i];}
+        T* begin() {return p_;}
+        T* end() {return p_ + n_;}
+        const T* begin() const {return p_;}
+        const T* end() const {return p_ + n_;}
+
+    private:
+        size_t n_;
+        T* p_;
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "mkl_basic_operator.h"
+
+//== typed column-major cblas wrappers: real scalars are passed by value, complex ones by address.
+namespace mkl::blas
+{
+    template<class T> inline void copy(MKL_INT n, const T* x, MKL_INT incx, T* y, MKL_INT incy)
+    {
+        CBLAS_REPEAT_CODE(T, copy, n, x, incx, y, incy);
+    }
+    template<class T> inline void scal(MKL_INT n, T alpha, T* x, MKL_INT incx = 1)
+    {
+        if constexpr(is_real_v<T>){
+            CBLAS_REPEAT_CODE(T, scal, n, alpha, x, incx);
+        }
+        else{
+            CBLAS_REPEAT_CODE(T, scal, n, &alpha, x, incx);
+        }
+    }
+    template<class T> inline void axpy(MKL_INT n, T alpha, const T* x, MKL_INT incx, T* y, MKL_INT incy)
+    {
+        if constexpr(is_real_v<T>){
+            CBLAS_REPEAT_CODE(T, axpy, n, alpha, x, incx, y, incy);
+        }
+        else{
+            CBLAS_REPEAT_CODE(T, axpy, n, &alpha, x, incx, y, incy);
+        }
+    }
+    //== conjugated dot product x^H y
+    template<class T> inline T dotc(MKL_INT n, const T* x, MKL_INT incx, const T* y, MKL_INT incy)
+    {
+        T result{};
+        if constexpr(is_s<T>)      result = cblas_sdot(n, x, incx, y, incy);
+        else if constexpr(is_d<T>) result = cblas_ddot(n, x, incx, y, incy);
+        else if constexpr(is_c<T>) cblas_cdotc_sub(n, x, incx, y, incy, &result);
+        else if constexpr(is_z<T>) cblas_zdotc_sub(n, x, incx, y, incy, &result);
+        else unreachable_constexpr_if();
+        return result;
+    }
+    template<class T> inline real_t<T> nrm2(MKL_INT n, const T* x, MKL_INT incx = 1)
+    {
+        if constexpr(is_s<T>)      return cblas_snrm2(n, x, incx);
+        else if constexpr(is_d<T>) return cblas_dnrm2(n, x, incx);
+        else if constexpr(is_c<T>) return cblas_scnrm2(n, x, incx);
+        else if constexpr(is_z<T>) return cblas_dznrm2(n, x, incx);
+        else unreachable_constexpr_if();
+    }
+    template<class T> inline void gemv(CBLAS_TRANSPOSE trans, MKL_INT m, MKL_INT n, T alpha, const T* A, MKL_INT lda,
+        const T* x, MKL_INT incx, T beta, T* y, MKL_INT incy)
+    {
+        if constexpr(is_real_v<T>){
+            CBLAS_REPEAT_CODE(T, gemv, CblasColMajor, trans, m, n, alpha, A, lda, x, incx, beta, y, incy);
+        }
+        else{
+            CBLAS_REPEAT_CODE(T, gemv, CblasColMajor, trans, m, n, &alpha, A, lda, x, incx, &beta, y, incy);
+        }
+    }
+    template<class T> inline void gemm(CBLAS_TRANSPOSE transa, CBLAS_TRANSPOSE transb, MKL_INT m, MKL_INT n, MKL_INT k,
+        T alpha, const T* A, MKL_INT lda, const T* B, MKL_INT ldb, T beta, T* C, MKL_INT ldc)
+    {
+        if constexpr(is_real_v<T>){
+            CBLAS_REPEAT_CODE(T, gemm, CblasColMajor, transa, transb, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+        }
+        else{
+            CBLAS_REPEAT_CODE(T, gemm, CblasColMajor, transa, transb, m, n, k, &alpha, A, lda, B, ldb, &beta, C, ldc);
+        }
+    }
+    template<class T> inline void trsm(CBLAS_SIDE side, CBLAS_UPLO uplo, CBLAS_TRANSPOSE trans, CBLAS_DIAG diag,
+        MKL_INT m, MKL_INT n, T alpha, const T* A, MKL_INT lda, T* B, MKL_INT ldb)
+    {
+        if constexpr(is_real_v<T>){
+            CBLAS_REPEAT_CODE(T, trsm, CblasColMajor, side, uplo, trans, diag, m, n, alpha, A, lda, B, ldb);
+        }
+        else{
+            CBLAS_REPEAT_CODE(T, trsm, CblasColMajor, side, uplo, trans, diag, m, n, &alpha, A, lda, B, ldb);
+        }
+    }
+    //== transpose for real types, conjugate transpose for complex ones
+    template<class T> constexpr CBLAS_TRANSPOSE adjoint = is_complex_v<T> ? CblasConjTrans : CblasTrans;
+}
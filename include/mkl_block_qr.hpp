@@ -0,0 +1,97 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_blas.hpp"
+#include "mkl_lapack.hpp"
+#include "mkl_parallel.hpp"
+#include "mkl_arena.hpp"
+
+//== QR of tall-skinny column-major blocks A (m x n, m >> n) : A = Q R, Q overwrites A,
+//   R is n x n upper triangular (ldr >= n).
+//   cholqr2 : two passes of Cholesky QR, two gemm + one potrf + one trsm each, BLAS-3 only.
+//             fails (returns false, A untouched) when A is too ill-conditioned for the Gram matrix.
+//   tsqr    : one level of the communication-avoiding tree, a geqrf per row chunk in parallel,
+//             then one geqrf of the stacked R factors. unconditionally stable.
+namespace mkl
+{
+    template<class T> void tsqr(size_t m, size_t n, T* A, size_t lda, T* R, size_t ldr);
+
+    template<class T> bool cholqr2(size_t m, size_t n, T* A, size_t lda, T* R, size_t ldr)
+    {
+        using real_type = real_t<T>;
+        scratch<T> G(n * n), R1(n * n);
+        for(int pass = 0; pass < 2; pass++){
+            blas::gemm<T>(blas::adjoint<T>, CblasNoTrans, n, n, m, T(1), A, lda, A, lda, T(0), G.data(), n);
+            if(0 != lapack::potrf<T>('U', n, G.data(), n)){
+                if(0 == pass) return false;
+                //== A is already close to orthonormal here, finish with the stable path
+                tsqr(m, n, A, lda, G.data(), n);
+                break;
+            }
+            for(size_t j = 0; j < n; j++) for(size_t i = j + 1; i < n; i++) G[j * n + i] = T(0);
+            //== diag(R)^2 spans the spectrum of A^H A : reject blocks with cond(A) beyond eps^(-1/2)
+            if(0 == pass){
+                real_type dmin = std::numeric_limits<real_type>::max(), dmax = 0;
+                for(size_t i = 0; i < n; i++){
+                    dmin = std::min(dmin, std::abs(G[i * n + i]));
+                    dmax = std::max(dmax, std::abs(G[i * n + i]));
+                }
+                if(!(dmin > std::sqrt(std::numeric_limits<real_type>::epsilon()) * dmax)) return false;
+            }
+            blas::trsm<T>(CblasRight, CblasUpper, CblasNoTrans, CblasNonUnit, m, n, T(1), G.data(), n, A, lda);
+            if(0 == pass) std::copy(G.begin(), G.end(), R1.begin());
+        }
+        //== R = R2 R1, both upper triangular
+        for(size_t j = 0; j < n; j++){
+            for(size_t i = 0; i < n; i++){
+                T s = 0;
+                for(size_t k = i; k <= j; k++) s += G[k * n + i] * R1[j * n + k];
+                R[j * ldr + i] = s;
+            }
+        }
+        return true;
+    }
+
+    template<class T> void tsqr(size_t m, size_t n, T* A, size_t lda, T* R, size_t ldr)
+    {
+        //== balanced chunks of at least 2n rows, one per thread
+        const size_t max_chunks = std::max<size_t>(1, m / std::max<size_t>(1, 2 * n));
+        const size_t nchunk = std::min<size_t>(max_chunks, size_t(std::max(1, mkl::loop_threads(m * n))));
+        const size_t lds = nchunk * n;
+        scratch<T> stacked(lds * n, T(0));
+        int info = 0;
+        const int nthreads = int(nchunk);
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1) reduction(|:info)
+        for(long long c = 0; c < static_cast<long long>(nchunk); c++){
+            const size_t r0 = size_t(c) * m / nchunk;
+            const size_t rc = size_t(c + 1) * m / nchunk - r0;
+            T* Ac = A + r0;
+            scratch<T> tau(n);
+            info |= lapack::geqrf<T>(rc, n, Ac, lda, tau.data());
+            for(size_t j = 0; j < n; j++) for(size_t i = 0; i <= j; i++) stacked[j * lds + size_t(c) * n + i] = Ac[j * lda + i];
+            info |= lapack::ungqr<T>(rc, n, n, Ac, lda, tau.data());
+        }
+        if(0 != info) throw std::runtime_error("tsqr: local geqrf/ungqr failed");
+
+        scratch<T> tau(n);
+        if(0 != lapack::geqrf<T>(lds, n, stacked.data(), lds, tau.data())) throw std::runtime_error("tsqr: geqrf failed");
+        for(size_t j = 0; j < n; j++) for(size_t i = 0; i < n; i++) R[j * ldr + i] = i <= j ? stacked[j * lds + i] : T(0);
+        if(0 != lapack::ungqr<T>(lds, n, n, stacked.data(), lds, tau.data())) throw std::runtime_error("tsqr: ungqr failed");
+
+        //== Q_c <- Q_c * Qs[c*n : (c+1)*n, :]
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long c = 0; c < static_cast<long long>(nchunk); c++){
+            const size_t r0 = size_t(c) * m / nchunk;
+            const size_t rc = size_t(c + 1) * m / nchunk - r0;
+            scratch<T> out(rc * n);
+            blas::gemm<T>(CblasNoTrans, CblasNoTrans, rc, n, n, T(1), A + r0, lda, stacked.data() + size_t(c) * n, lds, T(0), out.data(), rc);
+            for(size_t j = 0; j < n; j++) std::copy(out.begin() + j * rc, out.begin() + (j + 1) * rc, A + r0 + j * lda);
+        }
+    }
+
+    //== cholqr2 when the block is well conditioned, tsqr otherwise
+    template<class T> void block_qr(size_t m, size_t n, T* A, size_t lda, T* R, size_t ldr)
+    {
+        assert(m >= n);
+        if(!cholqr2(m, n, A, lda, R, ldr)) tsqr(m, n, A, lda, R, ldr);
+    }
+}
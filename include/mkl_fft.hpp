@@ -1,7 +1,12 @@
 #pragma once
 #include "mkl_basic_operator.h"
 #include "mkl_reshape.hpp"
+#include "mkl_trace.hpp"
 #include <assert.h>
+#include <atomic>
+#include <list>
+#include <map>
+#include <tuple>
 #if defined(HAVE_FFTW) || defined(HAVE_FFTWF)
 #   include "fftw_fft.hpp"
 #endif
@@ -11,6 +16,16 @@
 // mkl 相比于 fftw 后者更灵活, 在没有解决 TODO 的情况下, 我建议直接用 fftw
 // 
 
+//== MEKIL_FFT_VALIDATE=1 checks every execution against the plan (placement, direction, buffers),
+//   on by default in debug builds only.
+#ifndef MEKIL_FFT_VALIDATE
+#   ifdef NDEBUG
+#       define MEKIL_FFT_VALIDATE 0
+#   else
+#       define MEKIL_FFT_VALIDATE 1
+#   endif
+#endif
+
 namespace mekil
 {
     template<class TSpatial>
@@ -103,8 +118,17 @@ namespace mekil
         using spatial_type = typename fft_io_type<T>::spatial_type;
         using fourier_type = typename fft_io_type<T>::fourier_type;
 
+        //== first three lengths of the descriptor (row-major as created), for the trace of raw executions
+        static std::array<uint64_t, 3> traced_shape(DFTI_DESCRIPTOR_HANDLE handle)
+        {
+            MKL_LONG rank = 0, lengths[7] = {0};
+            DftiGetValue(handle, DFTI_DIMENSION, &rank);
+            if(rank > 0 && rank <= 7) DftiGetValue(handle, DFTI_LENGTHS, lengths);
+            return {uint64_t(lengths[0]), uint64_t(lengths[1]), uint64_t(lengths[2])};
+        }
         static void exec_forward(DFTI_DESCRIPTOR_HANDLE handle, void* in, void* out=nullptr)
         {
+            MEKIL_TRACE_SCOPE("fft.exec_forward", 0, traced_shape(handle));
             // if(out == nullptr) out = in;
             // //== transpose for col-major
             // enum DFTI_CONFIG_VALUE precision;
@@ -123,24 +147,29 @@ namespace mekil
                 MKL_CALL(DftiComputeForward(handle, (spatial_type*)in, (fourier_type*)out));
             }
             else{
+#if MEKIL_FFT_VALIDATE
                 MKL_LONG placement = 0;
                 MKL_CALL(DftiGetValue(handle, DFTI_PLACEMENT, &placement));
                 if(placement != DFTI_INPLACE) print_dft_descriptor(handle);
                 assert(placement == DFTI_INPLACE);
+#endif
                 MKL_CALL(DftiComputeForward(handle, (spatial_type*)in));
             }
         }
         static void exec_backward(DFTI_DESCRIPTOR_HANDLE handle, void* in, void* out=nullptr)
         {
+            MEKIL_TRACE_SCOPE("fft.exec_backward", 0, traced_shape(handle));
             // if(out == nullptr) out = in;
             if(nullptr != out){
                 MKL_CALL(DftiComputeBackward(handle, (fourier_type*)in,  (spatial_type*)out));
             }
             else{
+#if MEKIL_FFT_VALIDATE
                 MKL_LONG placement = 0;
                 MKL_CALL(DftiGetValue(handle, DFTI_PLACEMENT, &placement));
                 if(placement != DFTI_INPLACE) print_dft_descriptor(handle);
                 assert(placement == DFTI_INPLACE);
+#endif
                 MKL_CALL(DftiComputeBackward(handle, (fourier_type*)in));
             }
 
@@ -161,6 +190,7 @@ namespace mekil
         using pPlan_t = std::unique_ptr<DFTI_DESCRIPTOR_HANDLE, mkl_fft_plan_deleter>;
         static pPlan_t make_row_major_plan(const std::vector<MKL_LONG>& row_major_dims, bool inplace, real_t<T> normalize_factor, int batch_size)
         {
+            MEKIL_TRACE_SCOPE("fft.make_plan", 0, mkl::trace::extent(row_major_dims, 0), mkl::trace::extent(row_major_dims, 1), mkl::trace::extent(row_major_dims, 2));
             pPlan_t pPlan(new DFTI_DESCRIPTOR_HANDLE, mkl_fft_plan_deleter());
             enum DFTI_CONFIG_VALUE test[2] ={dft_precision, domain};
             if(row_major_dims.size() == 1){
@@ -171,6 +201,12 @@ namespace mekil
             }
             if(batch_size > 1){
                 MKL_CALL(DftiSetValue(*pPlan, DFTI_NUMBER_OF_TRANSFORMS, batch_size));
+                //== back-to-back batches. real layouts differ between directions : see make_directional_plan
+                if(DFTI_COMPLEX == domain){
+                    const MKL_LONG distance = std::accumulate(row_major_dims.begin(), row_major_dims.end(), MKL_LONG(1), std::multiplies<MKL_LONG>());
+                    MKL_CALL(DftiSetValue(*pPlan, DFTI_INPUT_DISTANCE, distance));
+                    MKL_CALL(DftiSetValue(*pPlan, DFTI_OUTPUT_DISTANCE, distance));
+                }
             }
             if(inplace && DFTI_COMPLEX == domain){
                 MKL_CALL(DftiSetValue(*pPlan, DFTI_CONJUGATE_EVEN_STORAGE, DFTI_COMPLEX_COMPLEX));
@@ -203,7 +239,277 @@ namespace mekil
             std::reverse(col_major_dims.begin(), col_major_dims.end());
             return make_row_major_plan(col_major_dims, inplace, normalize_factor, batch_size);
         }
+        //== out-of-place plan for one direction over back-to-back batches.
+        //   strides and distances describe the input and output of that direction, so a real
+        //   multi-dimensional transform needs one forward and one backward plan.
+        //   the fourier side of a real transform is the (n/2+1) half spectrum of the fastest axis.
+        static pPlan_t make_directional_plan(const std::vector<MKL_LONG>& row_major_dims, bool forward, int batch_size = 1, real_t<T> normalize_factor = 0)
+        {
+            const auto [spatial_strides, spatial_distance] = packed_layout(row_major_dims, row_major_dims.back());
+            const auto [fourier_strides, fourier_distance] = packed_layout(row_major_dims, fourier_fastest_size(row_major_dims.back()));
+            return forward ? make_strided_plan(row_major_dims, spatial_strides, spatial_distance, fourier_strides, fourier_distance, batch_size, normalize_factor)
+                           : make_strided_plan(row_major_dims, fourier_strides, fourier_distance, spatial_strides, spatial_distance, batch_size, normalize_factor);
+        }
+        //== directional plan over arbitrary {offset, strides...} and batch distances, in elements of
+        //   the input and output type of that direction (e.g. rows padded in a file mapping).
+        //   the descriptor is the same for both directions, the strides passed in decide which one it serves.
+        static pPlan_t make_strided_plan(const std::vector<MKL_LONG>& row_major_dims,
+                                         const std::vector<MKL_LONG>& in_strides, MKL_LONG in_distance,
+                                         const std::vector<MKL_LONG>& out_strides, MKL_LONG out_distance,
+                                         int batch_size = 1, real_t<T> normalize_factor = 0)
+        {
+            MEKIL_TRACE_SCOPE("fft.make_directional_plan", 0, mkl::trace::extent(row_major_dims, 0), mkl::trace::extent(row_major_dims, 1), mkl::trace::extent(row_major_dims, 2));
+            pPlan_t pPlan(new DFTI_DESCRIPTOR_HANDLE, mkl_fft_plan_deleter());
+            if(row_major_dims.size() == 1){
+                MKL_CALL(DftiCreateDescriptor(pPlan.get(), dft_precision, domain, 1, row_major_dims.front()));
+            }
+            else{
+                MKL_CALL(DftiCreateDescriptor(pPlan.get(), dft_precision, domain, row_major_dims.size(), row_major_dims.data()));
+            }
+            MKL_CALL(DftiSetValue(*pPlan, DFTI_PLACEMENT, DFTI_NOT_INPLACE));
+            if(DFTI_REAL == domain){
+                MKL_CALL(DftiSetValue(*pPlan, DFTI_CONJUGATE_EVEN_STORAGE, DFTI_COMPLEX_COMPLEX));
+            }
+            MKL_CALL(DftiSetValue(*pPlan, DFTI_INPUT_STRIDES, in_strides.data()));
+            MKL_CALL(DftiSetValue(*pPlan, DFTI_OUTPUT_STRIDES, out_strides.data()));
+            if(batch_size > 1){
+                MKL_CALL(DftiSetValue(*pPlan, DFTI_NUMBER_OF_TRANSFORMS, batch_size));
+                MKL_CALL(DftiSetValue(*pPlan, DFTI_INPUT_DISTANCE, in_distance));
+                MKL_CALL(DftiSetValue(*pPlan, DFTI_OUTPUT_DISTANCE, out_distance));
+            }
+            if(0 == normalize_factor){
+                normalize_factor = 1.0;
+                for(MKL_LONG n : row_major_dims) normalize_factor *= n;
+                normalize_factor = 1/normalize_factor;
+            }
+            MKL_CALL(DftiSetValue(*pPlan, DFTI_BACKWARD_SCALE, normalize_factor));
+            MKL_CALL(DftiCommitDescriptor(*pPlan));
+            return pPlan;
+        }
+        static MKL_LONG fourier_fastest_size(MKL_LONG n)
+        {
+            return DFTI_REAL == domain ? n / 2 + 1 : n;
+        }
+        //== {offset, strides...} of a packed row-major array whose fastest axis holds `fastest` elements,
+        //   and the distance between two such arrays
+        static std::pair<std::vector<MKL_LONG>, MKL_LONG> packed_layout(const std::vector<MKL_LONG>& row_major_dims, MKL_LONG fastest)
+        {
+            std::vector<MKL_LONG> strides(row_major_dims.size() + 1, 0);
+            MKL_LONG stride = 1;
+            for(size_t i = row_major_dims.size(); i > 0; i--){
+                strides[i] = stride;
+                stride *= (i == row_major_dims.size() ? fastest : row_major_dims[i - 1]);
+            }
+            return {strides, stride};
+        }
+    };
+    //== committed descriptor together with its configuration, read back once when it is committed.
+    //   executing it queries nothing : the checks of MEKIL_FFT_VALIDATE run on the cached values
+    //   and a failed compute throws instead of printing. buffers are typed by direction,
+    //   T on the spatial side and complex_t<T> on the fourier side.
+    template<class T> class fft_plan
+    {
+    public:
+        using fft_t = mklFFT<T>;
+        using spatial_type = T;
+        using fourier_type = complex_t<T>;
+        enum class direction : int {both, forward_only, backward_only};
+
+        struct layout
+        {
+            DFTI_CONFIG_VALUE domain;
+            bool inplace;
+            direction dir;
+            std::vector<MKL_LONG> lengths;          // row-major
+            std::vector<MKL_LONG> input_strides;    // {offset, strides...}
+            std::vector<MKL_LONG> output_strides;
+            MKL_LONG batch, input_distance, output_distance;
+            real_t<T> forward_scale, backward_scale;
+            size_t spatial_elements, fourier_elements;  // per transform, logical
+        };
+
+        //== same arguments as mklFFT::make_row_major_plan / make_plan / make_directional_plan / make_strided_plan
+        static fft_plan row_major(const std::vector<MKL_LONG>& row_major_dims, bool inplace = false, real_t<T> normalize_factor = 0, int batch_size = 1)
+        {
+            return fft_plan(fft_t::make_row_major_plan(row_major_dims, inplace, normalize_factor, batch_size), direction::both);
+        }
+        static fft_plan col_major(const std::vector<MKL_LONG>& col_major_dims, bool inplace = false, real_t<T> normalize_factor = 0, int batch_size = 1)
+        {
+            return fft_plan(fft_t::make_plan(col_major_dims, inplace, normalize_factor, batch_size), direction::both);
+        }
+        static fft_plan directional(const std::vector<MKL_LONG>& row_major_dims, bool forward, int batch_size = 1, real_t<T> normalize_factor = 0)
+        {
+            return fft_plan(fft_t::make_directional_plan(row_major_dims, forward, batch_size, normalize_factor),
+                            forward ? direction::forward_only : direction::backward_only);
+        }
+        static fft_plan strided(const std::vector<MKL_LONG>& row_major_dims, bool forward,
+                                const std::vector<MKL_LONG>& in_strides, MKL_LONG in_distance,
+                                const std::vector<MKL_LONG>& out_strides, MKL_LONG out_distance,
+                                int batch_size = 1, real_t<T> normalize_factor = 0)
+        {
+            return fft_plan(fft_t::make_strided_plan(row_major_dims, in_strides, in_distance, out_strides, out_distance, batch_size, normalize_factor),
+                            forward ? direction::forward_only : direction::backward_only);
+        }
+
+        void forward(const spatial_type* in, fourier_type* out) const
+        {
+            MEKIL_TRACE_SCOPE("fft.forward", traced_bytes(), mkl::trace::extent(layout_.lengths, 0), mkl::trace::extent(layout_.lengths, 1), mkl::trace::extent(layout_.lengths, 2));
+            check(true, false, in, out);
+            const MKL_LONG status = DftiComputeForward(*plan_, (typename fft_t::spatial_type*)in, (typename fft_t::fourier_type*)out);
+            if(DFTI_NO_ERROR != status) fail("DftiComputeForward", status);
+        }
+        void backward(const fourier_type* in, spatial_type* out) const
+        {
+            MEKIL_TRACE_SCOPE("fft.backward", traced_bytes(), mkl::trace::extent(layout_.lengths, 0), mkl::trace::extent(layout_.lengths, 1), mkl::trace::extent(layout_.lengths, 2));
+            check(false, false, in, out);
+            const MKL_LONG status = DftiComputeBackward(*plan_, (typename fft_t::fourier_type*)in, (typename fft_t::spatial_type*)out);
+            if(DFTI_NO_ERROR != status) fail("DftiComputeBackward", status);
+        }
+        //== in place : real data uses the padded layout of cal_fft_memory_layout
+        void forward(spatial_type* data) const
+        {
+            MEKIL_TRACE_SCOPE("fft.forward", traced_bytes(), mkl::trace::extent(layout_.lengths, 0), mkl::trace::extent(layout_.lengths, 1), mkl::trace::extent(layout_.lengths, 2));
+            check(true, true, data, data);
+            const MKL_LONG status = DftiComputeForward(*plan_, (typename fft_t::spatial_type*)data);
+            if(DFTI_NO_ERROR != status) fail("DftiComputeForward", status);
+        }
+        void backward(spatial_type* data) const
+        {
+            MEKIL_TRACE_SCOPE("fft.backward", traced_bytes(), mkl::trace::extent(layout_.lengths, 0), mkl::trace::extent(layout_.lengths, 1), mkl::trace::extent(layout_.lengths, 2));
+            check(false, true, data, data);
+            const MKL_LONG status = DftiComputeBackward(*plan_, (typename fft_t::fourier_type*)data);
+            if(DFTI_NO_ERROR != status) fail("DftiComputeBackward", status);
+        }
+
+        const layout& info() const {return layout_;}
+        DFTI_DESCRIPTOR_HANDLE handle() const {return *plan_;}
+
+    private:
+        fft_plan(typename fft_t::pPlan_t plan, direction dir) : plan_(std::move(plan))
+        {
+            DFTI_DESCRIPTOR_HANDLE h = *plan_;
+            MKL_LONG rank = 0, placement = 0, batch = 1;
+            MKL_CALL(DftiGetValue(h, DFTI_DIMENSION, &rank));
+            MKL_CALL(DftiGetValue(h, DFTI_PLACEMENT, &placement));
+            MKL_CALL(DftiGetValue(h, DFTI_NUMBER_OF_TRANSFORMS, &batch));
+            layout_.domain = fft_t::domain;
+            layout_.inplace = DFTI_INPLACE == placement;
+            layout_.dir = dir;
+            layout_.batch = batch;
+            layout_.lengths.resize(rank);
+            layout_.input_strides.resize(rank + 1);
+            layout_.output_strides.resize(rank + 1);
+            MKL_CALL(DftiGetValue(h, DFTI_LENGTHS, layout_.lengths.data()));
+            MKL_CALL(DftiGetValue(h, DFTI_INPUT_STRIDES, layout_.input_strides.data()));
+            MKL_CALL(DftiGetValue(h, DFTI_OUTPUT_STRIDES, layout_.output_strides.data()));
+            layout_.input_distance = layout_.output_distance = 0;
+            if(batch > 1){
+                MKL_CALL(DftiGetValue(h, DFTI_INPUT_DISTANCE, &layout_.input_distance));
+                MKL_CALL(DftiGetValue(h, DFTI_OUTPUT_DISTANCE, &layout_.output_distance));
+            }
+            MKL_CALL(DftiGetValue(h, DFTI_FORWARD_SCALE, &layout_.forward_scale));
+            MKL_CALL(DftiGetValue(h, DFTI_BACKWARD_SCALE, &layout_.backward_scale));
+            const MKL_LONG last = layout_.lengths.back();
+            layout_.spatial_elements = std::accumulate(layout_.lengths.begin(), layout_.lengths.end(), size_t(1), std::multiplies<size_t>());
+            layout_.fourier_elements = layout_.spatial_elements / last * fft_t::fourier_fastest_size(last);
+        }
+        uint64_t traced_bytes() const
+        {
+            return uint64_t(layout_.batch) * (layout_.spatial_elements * sizeof(spatial_type) + layout_.fourier_elements * sizeof(fourier_type));
+        }
+        void check([[maybe_unused]] bool forward, [[maybe_unused]] bool inplace, [[maybe_unused]] const void* in, [[maybe_unused]] const void* out) const
+        {
+#if MEKIL_FFT_VALIDATE
+            if(nullptr == in || nullptr == out) throw std::invalid_argument("fft_plan: null buffer");
+            if(inplace != layout_.inplace)
+                throw std::logic_error(std::string("fft_plan: ") + (inplace ? "in-place" : "out-of-place") + " execution of an " +
+                                       (layout_.inplace ? "in-place" : "out-of-place") + " plan");
+            if(!inplace && in == out) throw std::invalid_argument("fft_plan: out-of-place execution with aliased buffers");
+            if(layout_.dir == (forward ? direction::backward_only : direction::forward_only))
+                throw std::logic_error(std::string("fft_plan: ") + (forward ? "forward" : "backward") + " execution of a plan made for the other direction");
+#endif
+        }
+        [[noreturn]] static void fail(const char* what, MKL_LONG status)
+        {
+            throw std::runtime_error(std::string("fft_plan: ") + what + " failed : " + DftiErrorMessage(status));
+        }
+
+        typename fft_t::pPlan_t plan_;
+        layout layout_;
     };
+    //== plans owned by the calling thread, keyed by lengths, kind and batch. a thread that runs many
+    //   small transforms (task workers, pipelined loops) commits each layout once and never shares a
+    //   descriptor with another thread. each thread keeps at most plan_cache_capacity() plans per
+    //   type and drops the least recently used one beyond that, so a returned plan stays valid until
+    //   the calling thread asks for more than capacity other layouts or clears its cache.
+    enum class plan_kind {backward, forward, inplace};
+    namespace detail
+    {
+        inline std::atomic<size_t>& plan_cache_capacity()
+        {
+            static std::atomic<size_t> capacity{16};
+            return capacity;
+        }
+    }
+    inline size_t plan_cache_capacity() {return detail::plan_cache_capacity().load(std::memory_order_relaxed);}
+    //== applies to every thread on its next lookup, at least 1
+    inline void set_plan_cache_capacity(size_t plans) {detail::plan_cache_capacity() = std::max<size_t>(plans, 1);}
+
+    template<class T> class plan_cache
+    {
+    public:
+        using key_type = std::tuple<std::vector<MKL_LONG>, plan_kind, int>;
+
+        template<class Make> const fft_plan<T>& get(key_type key, Make make)
+        {
+            auto it = index_.find(key);
+            if(index_.end() != it){
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return it->second->second;
+            }
+            const size_t capacity = plan_cache_capacity();
+            while(!entries_.empty() && entries_.size() >= capacity){
+                index_.erase(entries_.back().first);
+                entries_.pop_back();
+            }
+            entries_.emplace_front(key, make());
+            index_.emplace(std::move(key), entries_.begin());
+            return entries_.front().second;
+        }
+        size_t size() const {return entries_.size();}
+        void clear()
+        {
+            index_.clear();
+            entries_.clear();
+        }
+
+    private:
+        std::list<std::pair<key_type, fft_plan<T>>> entries_;   // most recently used first
+        std::map<key_type, typename std::list<std::pair<key_type, fft_plan<T>>>::iterator> index_;
+    };
+    template<class T> inline plan_cache<T>& thread_plan_cache()
+    {
+        thread_local plan_cache<T> cache;
+        return cache;
+    }
+    //== destroys the calling thread's plans of every type
+    inline void clear_plan_cache()
+    {
+        thread_plan_cache<float>().clear();
+        thread_plan_cache<double>().clear();
+        thread_plan_cache<std::complex<float>>().clear();
+        thread_plan_cache<std::complex<double>>().clear();
+    }
+    template<class T> inline const fft_plan<T>& cached_plan(const std::vector<MKL_LONG>& row_major_dims, bool forward, int batch_size = 1)
+    {
+        return thread_plan_cache<T>().get({row_major_dims, forward ? plan_kind::forward : plan_kind::backward, batch_size},
+                                          [&]{return fft_plan<T>::directional(row_major_dims, forward, batch_size);});
+    }
+    //== in-place plan of both directions (col_major lengths, x first), same cache as cached_plan
+    template<class T> inline const fft_plan<T>& cached_inplace_plan(const std::vector<MKL_LONG>& col_major_dims)
+    {
+        return thread_plan_cache<T>().get({col_major_dims, plan_kind::inplace, 1}, [&]{return fft_plan<T>::col_major(col_major_dims, true);});
+    }
     //== inplace fft should be padded to the end of fastedst-axis
     // case1 : even-size for fastedst-axis
     // logic shape : (               4, 2)
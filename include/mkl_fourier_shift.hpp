@@ -0,0 +1,207 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_arena.hpp"
+#include "mkl_fft.hpp"
+#include "mkl_parallel.hpp"
+#include "mkl_reshape.hpp"
+#include "mkl_trace.hpp"
+#include <cmath>
+
+//== sub-pixel translation, shear and rotation applied in the Fourier domain.
+//   shapes are {x, y} with x fastest, like the reshape functions. a spectrum is the r2c half spectrum
+//   (x / 2 + 1 columns) or the full c2c spectrum, in the unshifted fft order.
+//
+//   fourier_shift multiplies the spectrum by exp(-2 pi i (fx dx + fy dy)) in one pass : the ramp is
+//   separable, one twiddle vector per axis is built once and each row is multiplied by ry[y] * rx.
+//   on real data the Nyquist bins of even axes take the real part cos(pi d) so the spectrum stays
+//   hermitian and the inverse r2c transform stays the band-limited translation.
+//
+//   fourier_rotate uses the three-pass method : rotation = shear_x(-tan(a/2)) shear_y(sin a) shear_x(-tan(a/2)),
+//   every shear is a per-row (per-column) translation. square images are first rotated by the
+//   nearest multiple of 90 degrees exactly, so the shears stay within 45 degrees; other shapes by the
+//   nearest multiple of 180 degrees, so they stay within 90 degrees and tan(a/2) within [-1, 1].
+namespace mkl
+{
+    namespace detail
+    {
+        //== r[k] = exp(-2 pi i m d / n) for the k-th bin, m = k for k <= n/2, k - n above.
+        //   a recurrence in double, resynchronized every 32 bins and at the negative frequencies.
+        template<class R> inline void phase_ramp(std::complex<R>* r, size_t n, size_t count, double d, bool real_nyquist)
+        {
+            const double w = -2.0 * M_PI * d / double(n);
+            const std::complex<double> step = std::polar(1.0, w);
+            std::complex<double> cur = 1;
+            for(size_t k = 0; k < count; k++){
+                const long long m = k <= n / 2 ? (long long)k : (long long)k - (long long)n;
+                if(0 == k % 32 || k == n / 2 + 1) cur = std::polar(1.0, w * double(m));
+                r[k] = std::complex<R>(cur);
+                if(real_nyquist && 0 == n % 2 && k == n / 2) r[k] = std::complex<R>(R(std::cos(w * double(m))), 0);
+                cur *= step;
+            }
+        }
+        //== s[x] *= t[x], interleaved real arithmetic (std::complex operator* carries inf / nan checks)
+        template<class R> inline void multiply_row(std::complex<R>* s, const std::complex<R>* t, size_t n)
+        {
+            R* __restrict a = reinterpret_cast<R*>(s);
+            const R* __restrict b = reinterpret_cast<const R*>(t);
+            #pragma omp simd
+            for(size_t x = 0; x < n; x++){
+                const R re = a[2 * x] * b[2 * x] - a[2 * x + 1] * b[2 * x + 1];
+                const R im = a[2 * x] * b[2 * x + 1] + a[2 * x + 1] * b[2 * x];
+                a[2 * x] = re;
+                a[2 * x + 1] = im;
+            }
+        }
+        //== t[x] = c * r[x]
+        template<class R> inline void scale_row(std::complex<R>* t, const std::complex<R>* r, std::complex<R> c, size_t n)
+        {
+            R* __restrict a = reinterpret_cast<R*>(t);
+            const R* __restrict b = reinterpret_cast<const R*>(r);
+            const R cr = c.real(), ci = c.imag();
+            #pragma omp simd
+            for(size_t x = 0; x < n; x++){
+                a[2 * x] = cr * b[2 * x] - ci * b[2 * x + 1];
+                a[2 * x + 1] = cr * b[2 * x + 1] + ci * b[2 * x];
+            }
+        }
+
+        //== one pass over count spectra of ny rows : row y of frame f is multiplied by ry[f][y] * rx[f]
+        template<class R> inline void apply_separable_ramps(std::complex<R>* spectrum, size_t columns, size_t ny, size_t pitch, size_t distance, size_t count,
+                         const std::complex<R>* rx, const std::complex<R>* ry)
+        {
+            const size_t rows = count * ny;
+            const int nthreads = mkl::loop_threads(rows * columns);
+            #pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+            {
+                mkl::scratch<std::complex<R>> t(columns);
+                #pragma omp for schedule(static)
+                for(long long r = 0; r < static_cast<long long>(rows); r++){
+                    const size_t f = size_t(r) / ny, y = size_t(r) % ny;
+                    scale_row(t.data(), rx + f * columns, ry[f * ny + y], columns);
+                    multiply_row(spectrum + f * distance + y * pitch, t.data(), columns);
+                }
+            }
+        }
+    }
+
+    //== spectra of `count` frames of logical size shape = {nx, ny}, `distance` elements apart,
+    //   frame f translated by shifts[f] = {dx, dy} pixels. half_spectrum : nx / 2 + 1 columns of an r2c transform.
+    //   pitch : complex elements between rows (0 : the number of columns).
+    template<class R> inline void fourier_shift_batch(std::complex<R>* spectrum, vec2<size_t> shape, size_t distance, const std::vector<vec2<double>>& shifts,
+                     bool half_spectrum = true, size_t pitch = 0)
+    {
+        const auto [nx, ny] = shape;
+        const size_t columns = half_spectrum ? nx / 2 + 1 : nx;
+        if(0 == pitch) pitch = columns;
+        const size_t count = shifts.size();
+        MEKIL_TRACE_SCOPE("fourier.shift", 2 * sizeof(std::complex<R>) * columns * ny * count, nx, ny, count);
+        mkl::scratch<std::complex<R>> rx(columns * count), ry(ny * count);
+        for(size_t f = 0; f < count; f++){
+            detail::phase_ramp(rx.data() + f * columns, nx, columns, shifts[f][0], half_spectrum);
+            detail::phase_ramp(ry.data() + f * ny, ny, ny, shifts[f][1], half_spectrum);
+        }
+        detail::apply_separable_ramps(spectrum, columns, ny, pitch, distance, count, rx.data(), ry.data());
+    }
+    template<class R> inline void fourier_shift(std::complex<R>* spectrum, vec2<size_t> shape, vec2<double> shift, bool half_spectrum = true, size_t pitch = 0)
+    {
+        fourier_shift_batch(spectrum, shape, 0, {shift}, half_spectrum, pitch);
+    }
+
+    //== image row y translated along x by factor * (y - center), through one batched transform over the rows.
+    //   real images use r2c rows, complex images c2c rows. the result is periodic.
+    template<class T> inline void fourier_shear_rows(T* image, vec2<size_t> shape, double factor, double center)
+    {
+        using R = real_t<T>;
+        const auto [nx, ny] = shape;
+        const size_t columns = is_real_v<T> ? nx / 2 + 1 : nx;
+        MEKIL_TRACE_SCOPE("fourier.shear", 2 * (sizeof(T) * nx + sizeof(complex_t<T>) * columns) * ny, nx, ny);
+        mkl::scratch<complex_t<T>> spectrum(columns * ny);
+        mekil::cached_plan<T>({MKL_LONG(nx)}, true, int(ny)).forward(image, spectrum.data());
+        const int nthreads = mkl::loop_threads(columns * ny);
+        #pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+        {
+            mkl::scratch<std::complex<R>> ramp(columns);
+            #pragma omp for schedule(static)
+            for(long long y = 0; y < static_cast<long long>(ny); y++){
+                detail::phase_ramp(ramp.data(), nx, columns, factor * (double(y) - center), is_real_v<T>);
+                detail::multiply_row(spectrum.data() + size_t(y) * columns, ramp.data(), columns);
+            }
+        }
+        mekil::cached_plan<T>({MKL_LONG(nx)}, false, int(ny)).backward(spectrum.data(), image);
+    }
+    //== axis 0 : x += factor * (y - ny / 2), axis 1 : y += factor * (x - nx / 2)
+    template<class T> inline void fourier_shear(T* image, vec2<size_t> shape, double factor, int axis)
+    {
+        const auto [nx, ny] = shape;
+        if(0 == axis){
+            fourier_shear_rows(image, shape, factor, double(ny / 2));
+            return;
+        }
+        //== columns become rows of the transposed image
+        mkl::scratch<T> t(nx * ny);
+        transpose<T, true>(image, t.data(), {int(ny), int(nx)});
+        fourier_shear_rows(t.data(), {ny, nx}, factor, double(nx / 2));
+        transpose<T, true>(t.data(), image, {int(nx), int(ny)});
+    }
+    //== exact rotation by quarter turns of a square image about (n / 2, n / 2), same convention as fourier_rotate
+    template<class T> inline void rotate_quarter_turns(T* image, size_t n, int quarter_turns)
+    {
+        const int q = ((quarter_turns % 4) + 4) % 4;
+        if(0 == q) return;
+        mkl::scratch<T> src(n * n);
+        std::copy(image, image + n * n, src.data());
+        const size_t c = n / 2;
+        const int nthreads = mkl::loop_threads(n * n);
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long y = 0; y < static_cast<long long>(n); y++){
+            for(size_t x = 0; x < n; x++){
+                //== output(p) = input(R^-1 (p - c) + c), modulo n
+                const long long dx = (long long)x - (long long)c, dy = y - (long long)c;
+                long long sx = dx, sy = dy;
+                if(1 == q){ sx = dy;  sy = -dx; }
+                if(2 == q){ sx = -dx; sy = -dy; }
+                if(3 == q){ sx = -dy; sy = dx; }
+                const size_t ix = size_t(((sx + (long long)c) % (long long)n + (long long)n) % (long long)n);
+                const size_t iy = size_t(((sy + (long long)c) % (long long)n + (long long)n) % (long long)n);
+                image[size_t(y) * n + x] = src.data()[iy * n + ix];
+            }
+        }
+    }
+    //== exact rotation by 180 degrees of any shape about (nx / 2, ny / 2) : output(p) = input(2 c - p), modulo the shape
+    template<class T> inline void rotate_half_turn(T* image, vec2<size_t> shape)
+    {
+        const auto [nx, ny] = shape;
+        mkl::scratch<T> src(nx * ny);
+        std::copy(image, image + nx * ny, src.data());
+        const int nthreads = mkl::loop_threads(nx * ny);
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long y = 0; y < static_cast<long long>(ny); y++){
+            const size_t iy = (2 * (ny / 2) + ny - size_t(y)) % ny;
+            const T* in = src.data() + iy * nx;
+            T* out = image + size_t(y) * nx;
+            for(size_t x = 0; x < nx; x++) out[x] = in[(2 * (nx / 2) + nx - x) % nx];
+        }
+    }
+    //== rotation by `angle` radians about c = (nx / 2, ny / 2) : output(p) = input(R(-angle) (p - c) + c),
+    //   R(a) = [[cos a, -sin a], [sin a, cos a]] in (x, y) pixel coordinates. periodic boundaries, band-limited interpolation.
+    template<class T> inline void fourier_rotate(T* image, vec2<size_t> shape, double angle)
+    {
+        const auto [nx, ny] = shape;
+        MEKIL_TRACE_SCOPE("fourier.rotate", 6 * sizeof(T) * nx * ny, nx, ny);
+        if(nx == ny){
+            const long long q = std::llround(angle / (M_PI / 2));
+            rotate_quarter_turns(image, nx, int(q % 4));
+            angle -= double(q) * (M_PI / 2);
+        }
+        else{
+            const long long h = std::llround(angle / M_PI);
+            if(0 != h % 2) rotate_half_turn(image, shape);
+            angle -= double(h) * M_PI;
+        }
+        if(0 == angle) return;
+        const double a = -std::tan(angle / 2), b = std::sin(angle);
+        fourier_shear(image, shape, a, 0);
+        fourier_shear(image, shape, b, 1);
+        fourier_shear(image, shape, a, 0);
+    }
+}
@@ -0,0 +1,247 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_arena.hpp"
+#include "mkl_fft.hpp"
+#include "mkl_parallel.hpp"
+#include "mkl_trace.hpp"
+#include <cmath>
+#include <stdexcept>
+
+//== r2c half spectra of real images : x / 2 + 1 columns of the logical real shape {nx, ny} (x fastest),
+//   rows in the unshifted fft order. the missing columns are the hermitian mirror X(-k) = conj(X(k)),
+//   so an even filter (gain(-f) = gain(f)) applied to the stored half is the full-spectrum filter and
+//   the inverse r2c transform stays real : every element-wise pass touches half the data of a c2c layout.
+//
+//   frequencies are in cycles per unit of the sample pitch : column x holds fx = x / (nx px),
+//   row y holds fy = m / (ny py) with m = y for y < (ny + 1) / 2, y - ny above (numpy.fft.fftfreq).
+//
+//   filters are functors double(fx, fy) evaluated on the fly row by row, nothing of the spectrum size is stored.
+//
+//       mkl::half_spectrum<float> s({nx, ny});
+//       s.forward(image);
+//       s.view().apply(mkl::filter::butterworth{0.1, 4});
+//       s.backward(image);
+namespace mkl
+{
+    namespace filter
+    {
+        //== 1 for r_min <= |f| <= r_max, 0 elsewhere (inside = false : the complement)
+        struct radial_mask
+        {
+            double r_min = 0, r_max = 0;
+            bool inside = true;
+            double operator()(double fx, double fy) const
+            {
+                const double r2 = fx * fx + fy * fy;
+                return (r2 >= r_min * r_min && r2 <= r_max * r_max) == inside ? 1.0 : 0.0;
+            }
+        };
+        //== 1 inside the ellipse of semi-axes (ax, ay) rotated by `angle` radians, 0 outside (inside = false : the complement)
+        struct elliptical_mask
+        {
+            double ax = 0, ay = 0, angle = 0;
+            bool inside = true;
+            double operator()(double fx, double fy) const
+            {
+                const double c = std::cos(angle), s = std::sin(angle);
+                const double u = (c * fx + s * fy) / ax, v = (c * fy - s * fx) / ay;
+                return (u * u + v * v <= 1) == inside ? 1.0 : 0.0;
+            }
+        };
+        //== exp(-|f|^2 / (2 sigma^2)), highpass : 1 - that
+        struct gaussian
+        {
+            double sigma = 0;
+            bool highpass = false;
+            double operator()(double fx, double fy) const
+            {
+                const double g = std::exp(-(fx * fx + fy * fy) / (2 * sigma * sigma));
+                return highpass ? 1 - g : g;
+            }
+        };
+        //== 1 / (1 + (|f| / cutoff)^(2 order)), highpass : 1 / (1 + (cutoff / |f|)^(2 order))
+        struct butterworth
+        {
+            double cutoff = 0;
+            int order = 2;
+            bool highpass = false;
+            double operator()(double fx, double fy) const
+            {
+                const double q = (fx * fx + fy * fy) / (cutoff * cutoff);
+                if(highpass) return q > 0 ? 1 / (1 + std::pow(q, -order)) : 0.0;
+                return 1 / (1 + std::pow(q, order));
+            }
+        };
+    }
+
+    //== non-owning view over a half spectrum. pitch : complex elements between rows (0 : x / 2 + 1).
+    template<class R> class half_spectrum_view
+    {
+    public:
+        using value_type = std::complex<R>;
+
+        half_spectrum_view(value_type* data, vec2<size_t> shape, size_t pitch = 0, vec2<double> sample_pitch = {1, 1})
+            : data_(data), shape_(shape), pitch_(pitch ? pitch : shape[0] / 2 + 1), sample_pitch_(sample_pitch)
+        {
+            if(pitch_ < columns()) throw std::invalid_argument("half_spectrum_view : pitch is smaller than x / 2 + 1");
+        }
+
+        value_type* data() const {return data_;}
+        value_type* row(size_t y) const {return data_ + y * pitch_;}
+        value_type& operator()(size_t x, size_t y) const {return data_[y * pitch_ + x];}
+        //== logical real shape, stored columns, rows
+        vec2<size_t> shape() const {return shape_;}
+        size_t columns() const {return shape_[0] / 2 + 1;}
+        size_t rows() const {return shape_[1];}
+        size_t pitch() const {return pitch_;}
+        vec2<double> sample_pitch() const {return sample_pitch_;}
+
+        double fx(size_t x) const {return double(x) / (double(shape_[0]) * sample_pitch_[0]);}
+        double fy(size_t y) const
+        {
+            const long long m = y < (shape_[1] + 1) / 2 ? (long long)y : (long long)y - (long long)shape_[1];
+            return double(m) / (double(shape_[1]) * sample_pitch_[1]);
+        }
+        vec2<double> frequency(size_t x, size_t y) const {return {fx(x), fy(y)};}
+        //== how many bins of the full spectrum column x stands for : 1 for x = 0 and the Nyquist column of an even x, else 2
+        size_t multiplicity(size_t x) const {return 0 == x || 2 * x == shape_[0] ? 1 : 2;}
+
+        //== f(fx, fy, value&) for every stored bin, rows distributed over threads
+        template<class F> void for_each(F f) const
+        {
+            const size_t nx = columns(), ny = rows();
+            const int nthreads = mkl::loop_threads(nx * ny);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long y = 0; y < static_cast<long long>(ny); y++){
+                const double v = fy(size_t(y));
+                value_type* p = row(size_t(y));
+                for(size_t x = 0; x < nx; x++) f(fx(x), v, p[x]);
+            }
+        }
+        //== value *= gain(fx, fy) in one pass, the gains are never stored
+        template<class F> void apply(F gain) const
+        {
+            MEKIL_TRACE_SCOPE("half_spectrum.apply", 2 * sizeof(value_type) * columns() * rows(), shape_[0], shape_[1]);
+            const size_t nx = columns(), ny = rows();
+            const double step = 1 / (double(shape_[0]) * sample_pitch_[0]);
+            const int nthreads = mkl::loop_threads(nx * ny);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long y = 0; y < static_cast<long long>(ny); y++){
+                const double v = fy(size_t(y));
+                R* p = reinterpret_cast<R*>(row(size_t(y)));
+                for(size_t x = 0; x < nx; x++){
+                    const R g = R(gain(step * double(x), v));
+                    p[2 * x] *= g;
+                    p[2 * x + 1] *= g;
+                }
+            }
+        }
+        void scale(R a) const
+        {
+            const size_t nx = columns(), ny = rows();
+            const int nthreads = mkl::loop_threads(nx * ny);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long y = 0; y < static_cast<long long>(ny); y++){
+                R* p = reinterpret_cast<R*>(row(size_t(y)));
+                #pragma omp simd
+                for(size_t x = 0; x < 2 * nx; x++) p[x] *= a;
+            }
+        }
+        //== this *= other (conjugate : this *= conj(other)), same logical shape; the product of two
+        //   hermitian spectra is hermitian, so this is the full-spectrum product (convolution / correlation)
+        void multiply(const half_spectrum_view& other, bool conjugate = false) const
+        {
+            if(other.shape_ != shape_) throw std::invalid_argument("half_spectrum_view::multiply : shapes differ");
+            MEKIL_TRACE_SCOPE("half_spectrum.multiply", 3 * sizeof(value_type) * columns() * rows(), shape_[0], shape_[1]);
+            const size_t nx = columns(), ny = rows();
+            const R sign = conjugate ? R(-1) : R(1);
+            const int nthreads = mkl::loop_threads(nx * ny);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long y = 0; y < static_cast<long long>(ny); y++){
+                R* __restrict a = reinterpret_cast<R*>(row(size_t(y)));
+                const R* __restrict b = reinterpret_cast<const R*>(other.row(size_t(y)));
+                #pragma omp simd
+                for(size_t x = 0; x < nx; x++){
+                    const R br = b[2 * x], bi = sign * b[2 * x + 1];
+                    const R re = a[2 * x] * br - a[2 * x + 1] * bi;
+                    const R im = a[2 * x] * bi + a[2 * x + 1] * br;
+                    a[2 * x] = re;
+                    a[2 * x + 1] = im;
+                }
+            }
+        }
+        //== sum of |X|^2 over the full spectrum (Parseval : nx * ny * sum of the squared image)
+        double energy() const
+        {
+            const size_t nx = columns(), ny = rows();
+            double sum = 0;
+            const int nthreads = mkl::loop_threads(nx * ny);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1) reduction(+:sum)
+            for(long long y = 0; y < static_cast<long long>(ny); y++){
+                const value_type* p = row(size_t(y));
+                for(size_t x = 0; x < nx; x++) sum += double(multiplicity(x)) * double(std::norm(p[x]));
+            }
+            return sum;
+        }
+        //== the full nx * ny c2c spectrum, rows of nx elements
+        void to_full(value_type* out) const
+        {
+            const auto [nx, ny] = shape_;
+            const size_t half = columns();
+            const int nthreads = mkl::loop_threads(nx * ny);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long y = 0; y < static_cast<long long>(ny); y++){
+                const value_type* p = row(size_t(y));
+                const value_type* mirror = row((ny - size_t(y)) % ny);
+                value_type* o = out + size_t(y) * nx;
+                std::copy(p, p + half, o);
+                for(size_t x = half; x < nx; x++) o[x] = std::conj(mirror[nx - x]);
+            }
+        }
+
+    private:
+        value_type* data_;
+        vec2<size_t> shape_;
+        size_t pitch_;
+        vec2<double> sample_pitch_;
+    };
+
+    //== owning half spectrum with the r2c / c2r transforms of its logical shape (plans from mekil::cached_plan)
+    template<class R> class half_spectrum
+    {
+    public:
+        explicit half_spectrum(vec2<size_t> shape, vec2<double> sample_pitch = {1, 1})
+            : storage_((shape[0] / 2 + 1) * shape[1]), view_(storage_.data(), shape, 0, sample_pitch) {}
+        half_spectrum(const half_spectrum& other)
+            : storage_(other.storage_), view_(storage_.data(), other.view_.shape(), 0, other.view_.sample_pitch()) {}
+        half_spectrum(half_spectrum&& other) = default;
+        half_spectrum& operator=(half_spectrum other)
+        {
+            std::swap(storage_, other.storage_);
+            std::swap(view_, other.view_);
+            return *this;
+        }
+
+        const half_spectrum_view<R>& view() const {return view_;}
+        std::complex<R>* data() {return storage_.data();}
+        const std::complex<R>* data() const {return storage_.data();}
+        size_t size() const {return storage_.size();}
+
+        //== spectrum of image (nx * ny reals, x fastest)
+        void forward(const R* image)
+        {
+            const auto [nx, ny] = view_.shape();
+            mekil::cached_plan<R>({MKL_LONG(ny), MKL_LONG(nx)}, true).forward(image, storage_.data());
+        }
+        //== normalized inverse into image, the spectrum is left unspecified (c2r may overwrite its input)
+        void backward(R* image)
+        {
+            const auto [nx, ny] = view_.shape();
+            mekil::cached_plan<R>({MKL_LONG(ny), MKL_LONG(nx)}, false).backward(storage_.data(), image);
+        }
+
+    private:
+        aligned_vector<std::complex<R>> storage_;
+        half_spectrum_view<R> view_;
+    };
+}
@@ -1,16 +1,37 @@
 #pragma once
 #include "mkl_basic_operator.h"
 #include "mkl_vec.hpp"
+#include "mkl_parallel.hpp"
+#include "mkl_arena.hpp"
 namespace mkl
 {
+    //== columns are split into strips of `integral_strip_bytes`, the running column sum of a strip
+    //   stays in L1 while the strip is walked top to bottom, strips are independent -> one per thread.
+    constexpr size_t integral_strip_bytes = 2048;
+
     template <typename T> void integral_y(vec2<size_t> shape, T* image)
     {
-        using Tmkl = mkl_t<T>;
         const auto [ysize, xsize] = shape;
-        T* a = image;
-        T* b = image + xsize;
-        for(size_t y = 0; y < ysize-1; y++, a+=xsize, b +=xsize)
-            mkl::vec::self_add(xsize, a, b);
+        if(0 == ysize || 0 == xsize) return;
+        constexpr size_t strip = std::max<size_t>(1, integral_strip_bytes / sizeof(T));
+        const long long nstrip = static_cast<long long>((xsize + strip - 1) / strip);
+        const int nthreads = mkl::loop_threads(ysize * xsize);
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long s = 0; s < nstrip; s++){
+            const size_t x0 = size_t(s) * strip;
+            const size_t w  = std::min(strip, xsize - x0);
+            T acc[strip];
+            T* p = image + x0;
+            for(size_t x = 0; x < w; x++) acc[x] = p[x];
+            for(size_t y = 1; y < ysize; y++){
+                p += xsize;
+                #pragma omp simd
+                for(size_t x = 0; x < w; x++){
+                    acc[x] += p[x];
+                    p[x] = acc[x];
+                }
+            }
+        }
     }
     template <typename T> void integral_x(vec2<size_t> shape, T* image)
     {
@@ -19,7 +40,64 @@ namespace mkl
         auto line_op = [xsize](T* p){
             for(size_t x = 1; x < xsize; x++) p[x] += p[x - 1];
         };
-        #pragma omp for
-        for(size_t y = 0; y < ysize; y++) line_op(image + y * xsize);
+        const int nthreads = mkl::loop_threads(ysize * xsize);
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long y = 0; y < static_cast<long long>(ysize); y++) line_op(image + size_t(y) * xsize);
+    }
+
+    //== summed-area table in one sweep : equal to integral_x + integral_y.
+    //   rows are split into blocks, every block is integrated locally in a single fused pass
+    //   (row prefix-sum + previous row), then the bottom rows of the preceding blocks are
+    //   carried into the following blocks. with one thread this is exactly one pass.
+    template <typename T> void integral_xy(vec2<size_t> shape, T* image)
+    {
+        const auto [ysize, xsize] = shape;
+        if(0 == ysize || 0 == xsize) return;
+        auto block_op = [xsize](T* p, size_t rows){
+            T running = T(0);
+            for(size_t x = 0; x < xsize; x++){
+                running += p[x];
+                p[x] = running;
+            }
+            for(size_t y = 1; y < rows; y++){
+                const T* prev = p;
+                p += xsize;
+                running = T(0);
+                for(size_t x = 0; x < xsize; x++){
+                    running += p[x];
+                    p[x] = running + prev[x];
+                }
+            }
+        };
+        int nblock = static_cast<int>(std::min<size_t>(mkl::loop_threads(ysize * xsize), ysize));
+        if(1 == nblock){
+            block_op(image, ysize);
+            return;
+        }
+        const size_t rows_per_block = (ysize + nblock - 1) / nblock;
+        nblock = static_cast<int>((ysize + rows_per_block - 1) / rows_per_block);
+        auto block_begin = [&](int b){ return size_t(b) * rows_per_block; };
+        auto block_end   = [&](int b){ return std::min(ysize, block_begin(b) + rows_per_block); };
+
+        mkl::scratch<T> carry(size_t(nblock) * xsize);
+        #pragma omp parallel num_threads(nblock)
+        {
+            #pragma omp for schedule(static)
+            for(int b = 0; b < nblock; b++){
+                block_op(image + block_begin(b) * xsize, block_end(b) - block_begin(b));
+            }
+            //== carry[b] = sum of the bottom rows of blocks [0, b)
+            #pragma omp single
+            {
+                std::fill(carry.begin(), carry.begin() + xsize, T(0));
+                for(int b = 1; b < nblock; b++){
+                    mkl::vec::add(xsize, carry.data() + (b - 1) * xsize, image + (block_end(b - 1) - 1) * xsize, carry.data() + b * xsize);
+                }
+            }
+            #pragma omp for schedule(static)
+            for(long long y = static_cast<long long>(rows_per_block); y < static_cast<long long>(ysize); y++){
+                mkl::vec::self_add(xsize, carry.data() + (size_t(y) / rows_per_block) * xsize, image + size_t(y) * xsize);
+            }
+        }
     }
-}
\ No newline at end of file
+}
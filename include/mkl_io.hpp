@@ -0,0 +1,561 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_arena.hpp"
+#include "mkl_fft.hpp"
+#include "mkl_parallel.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+//== memory-mapped raw / .npy / .npz arrays (POSIX, little-endian hosts).
+//   a mapped array is a row-major view straight into the page cache : shape plus a row pitch
+//   (elements between two rows of the fastest axis), so padded files are described without a copy.
+//   the first transform pass can read from the mapping :
+//     - forward_plan(view, rank) builds a strided plan whose input is the mapping itself,
+//     - load_padded(view, out) fills a cal_fft_memory_layout buffer in one parallel pass,
+//     - create_raw(path, shape, padded_width<T>(n)) makes an fft-ready padded file to map and fill.
+//   mappings are advised sequential, and as huge pages from 2 MiB on.
+//   .npz members must be stored (np.savez, not np.savez_compressed).
+namespace mkl::io
+{
+    enum class access
+    {
+        read_only,
+        read_write,     // writes go to the file
+        copy_on_write,  // writes stay private to the mapping (e.g. in-place transforms of input data)
+    };
+
+    class mapped_file
+    {
+    public:
+        mapped_file() = default;
+        mapped_file(const std::string& path, access mode) : mode_(mode)
+        {
+            const int fd = ::open(path.c_str(), access::read_write == mode ? O_RDWR : O_RDONLY);
+            if(fd < 0) throw std::runtime_error("mapped_file: cannot open " + path);
+            struct stat st;
+            if(0 != ::fstat(fd, &st)){
+                ::close(fd);
+                throw std::runtime_error("mapped_file: cannot stat " + path);
+            }
+            map(fd, size_t(st.st_size), path);
+        }
+        //== new file of `bytes` bytes (truncated if it exists), mapped read-write
+        static mapped_file create(const std::string& path, size_t bytes)
+        {
+            const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if(fd < 0) throw std::runtime_error("mapped_file: cannot create " + path);
+            if(0 != ::ftruncate(fd, off_t(bytes))){
+                ::close(fd);
+                throw std::runtime_error("mapped_file: cannot resize " + path);
+            }
+            mapped_file f;
+            f.mode_ = access::read_write;
+            f.map(fd, bytes, path);
+            return f;
+        }
+        ~mapped_file() {unmap();}
+        mapped_file(mapped_file&& o) noexcept
+            : data_(std::exchange(o.data_, nullptr)), size_(std::exchange(o.size_, 0)), mode_(o.mode_), path_(std::move(o.path_)) {}
+        mapped_file& operator=(mapped_file&& o) noexcept
+        {
+            if(this != &o){
+                unmap();
+                data_ = std::exchange(o.data_, nullptr);
+                size_ = std::exchange(o.size_, 0);
+                mode_ = o.mode_;
+                path_ = std::move(o.path_);
+            }
+            return *this;
+        }
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        char* data() const {return data_;}
+        size_t size() const {return size_;}
+        access mode() const {return mode_;}
+        //== the path the file was opened or created with
+        const std::string& path() const {return path_;}
+        //== write dirty pages back to the file
+        void flush() const
+        {
+            if(data_ && access::read_write == mode_ && 0 != ::msync(data_, size_, MS_SYNC)) throw std::runtime_error("mapped_file: msync failed");
+        }
+
+    private:
+        void map(int fd, size_t bytes, const std::string& path)
+        {
+            path_ = path;
+            size_ = bytes;
+            if(0 == bytes){
+                ::close(fd);
+                return;
+            }
+            const int prot = access::read_only == mode_ ? PROT_READ : PROT_READ | PROT_WRITE;
+            void* p = ::mmap(nullptr, bytes, prot, access::copy_on_write == mode_ ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+            ::close(fd);
+            if(MAP_FAILED == p) throw std::runtime_error("mapped_file: mmap failed for " + path);
+            data_ = static_cast<char*>(p);
+            ::madvise(data_, size_, MADV_SEQUENTIAL);
+            if(access::read_write != mode_) ::madvise(data_, size_, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+            if(size_ >= memory::huge_page_bytes) ::madvise(data_, size_, MADV_HUGEPAGE);
+#endif
+        }
+        void unmap()
+        {
+            if(data_) ::munmap(data_, size_);
+            data_ = nullptr;
+            size_ = 0;
+        }
+
+        char* data_ = nullptr;
+        size_t size_ = 0;
+        access mode_ = access::read_only;
+        std::string path_;
+    };
+
+    //== row-major array whose rows (fastest axis) start every `row_pitch` elements
+    template<class T> struct array_view
+    {
+        T* data = nullptr;
+        std::vector<size_t> shape;
+        size_t row_pitch = 0;
+
+        size_t width() const {return shape.empty() ? 0 : shape.back();}
+        size_t rows() const
+        {
+            size_t r = 1;
+            for(size_t i = 0; i + 1 < shape.size(); i++) r *= shape[i];
+            return r;
+        }
+        T* row(size_t r) const {return data + r * row_pitch;}
+        operator array_view<const T>() const {return {data, shape, row_pitch};}
+    };
+
+    //== numpy descriptor of the element types of the library
+    template<class T> inline const char* npy_descr()
+    {
+        if constexpr(is_s<T>) return "<f4";
+        else if constexpr(is_d<T>) return "<f8";
+        else if constexpr(is_c<T>) return "<c8";
+        else if constexpr(is_z<T>) return "<c16";
+        else unreachable_constexpr_if();
+    }
+
+    struct npy_header
+    {
+        std::string descr;
+        bool fortran_order = false;
+        std::vector<size_t> shape;
+        size_t data_offset = 0;     // from the start of the .npy stream
+    };
+    namespace detail
+    {
+        inline uint64_t read_le(const char* p, int bytes)
+        {
+            uint64_t v = 0;
+            for(int i = bytes - 1; i >= 0; i--) v = (v << 8) | uint8_t(p[i]);
+            return v;
+        }
+        inline void write_le(char* p, uint64_t v, int bytes)
+        {
+            for(int i = 0; i < bytes; i++, v >>= 8) p[i] = char(v & 0xff);
+        }
+        //== value of 'key' in the header dict, up to the next ',' or ')' for tuples
+        inline std::string dict_value(const std::string& dict, const std::string& key)
+        {
+            const size_t k = dict.find("'" + key + "'");
+            if(std::string::npos == k) throw std::runtime_error("npy: header has no " + key);
+            size_t b = dict.find(':', k) + 1;
+            while(b < dict.size() && ' ' == dict[b]) b++;
+            const size_t e = '(' == dict[b] ? dict.find(')', b) + 1 : dict.find_first_of(",}", b);
+            return dict.substr(b, e - b);
+        }
+        inline uint32_t crc32(const char* p, size_t n, uint32_t crc = 0)
+        {
+            static const auto table = []{
+                std::array<uint32_t, 256> t;
+                for(uint32_t i = 0; i < 256; i++){
+                    uint32_t c = i;
+                    for(int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    t[i] = c;
+                }
+                return t;
+            }();
+            crc = ~crc;
+            for(size_t i = 0; i < n; i++) crc = table[(crc ^ uint8_t(p[i])) & 0xff] ^ (crc >> 8);
+            return ~crc;
+        }
+    }
+
+    //== parse the header of a .npy stream of `bytes` bytes
+    inline npy_header parse_npy_header(const char* p, size_t bytes)
+    {
+        if(bytes < 10 || 0 != std::memcmp(p, "\x93NUMPY", 6)) throw std::runtime_error("npy: bad magic");
+        const int major = uint8_t(p[6]);
+        const size_t prefix = 1 == major ? 10 : 12;
+        if(bytes < prefix) throw std::runtime_error("npy: truncated header");
+        const size_t len = detail::read_le(p + 8, 1 == major ? 2 : 4);
+        if(prefix + len > bytes) throw std::runtime_error("npy: truncated header");
+        const std::string dict(p + prefix, len);
+
+        npy_header h;
+        h.data_offset = prefix + len;
+        h.descr = detail::dict_value(dict, "descr");
+        h.descr = h.descr.substr(1, h.descr.size() - 2);
+        h.fortran_order = "True" == detail::dict_value(dict, "fortran_order");
+        const std::string shape = detail::dict_value(dict, "shape");
+        for(size_t i = 1; i < shape.size();){
+            const size_t e = shape.find_first_of(",)", i);
+            const std::string item = shape.substr(i, e - i);
+            if(item.find_first_not_of(' ') != std::string::npos) h.shape.push_back(std::stoull(item));
+            i = e + 1;
+        }
+        return h;
+    }
+    //== .npy header (version 1.0, or 2.0 beyond 64 KiB) padded so the data is 64-byte aligned
+    //   relative to the start of the stream
+    inline std::string make_npy_header(const char* descr, const std::vector<size_t>& shape)
+    {
+        std::string dims;
+        for(size_t i = 0; i < shape.size(); i++) dims += (i ? ", " : "") + std::to_string(shape[i]);
+        if(1 == shape.size()) dims += ",";
+        std::string dict = std::string("{'descr': '") + descr + "', 'fortran_order': False, 'shape': (" + dims + "), }";
+        const bool v2 = dict.size() + 11 > 65535;
+        const size_t prefix = v2 ? 12 : 10;
+        const size_t total = (prefix + dict.size() + 1 + memory::alignment - 1) / memory::alignment * memory::alignment;
+        dict.append(total - prefix - dict.size() - 1, ' ');
+        dict += '\n';
+        std::string header(prefix, '\0');
+        std::memcpy(header.data(), "\x93NUMPY", 6);
+        header[6] = v2 ? 2 : 1;
+        header[7] = 0;
+        detail::write_le(header.data() + 8, dict.size(), v2 ? 4 : 2);
+        return header + dict;
+    }
+
+    //== a mapping and the typed view into it
+    template<class T> class mapped_array
+    {
+    public:
+        mapped_array(mapped_file file, array_view<T> view) : file_(std::move(file)), view_(std::move(view)) {}
+
+        array_view<const T> view() const {return view_;}
+        //== writable view, not for read-only mappings
+        array_view<T> mutable_view()
+        {
+            if(access::read_only == file_.mode()) throw std::logic_error("mapped_array: the mapping is read-only");
+            return view_;
+        }
+        const std::vector<size_t>& shape() const {return view_.shape;}
+        size_t row_pitch() const {return view_.row_pitch;}
+        const mapped_file& file() const {return file_;}
+        void flush() const {file_.flush();}
+
+    private:
+        mapped_file file_;
+        array_view<T> view_;
+    };
+
+    namespace detail
+    {
+        template<class T> array_view<T> make_view(const mapped_file& f, size_t offset, std::vector<size_t> shape, size_t row_pitch, const std::string& what)
+        {
+            array_view<T> v{reinterpret_cast<T*>(f.data() + offset), std::move(shape), 0};
+            v.row_pitch = row_pitch ? row_pitch : v.width();
+            if(v.row_pitch < v.width()) throw std::invalid_argument(what + ": row pitch is smaller than the row width");
+            const size_t need = v.rows() && v.width() ? ((v.rows() - 1) * v.row_pitch + v.width()) * sizeof(T) : 0;
+            if(offset + need > f.size()) throw std::runtime_error(what + ": file is smaller than the array");
+            return v;
+        }
+        template<class T> array_view<T> npy_view(const mapped_file& f, size_t offset, size_t bytes, const std::string& what)
+        {
+            const npy_header h = parse_npy_header(f.data() + offset, bytes);
+            if(h.descr != npy_descr<T>()) throw std::runtime_error(what + ": dtype " + h.descr + " is not " + npy_descr<T>());
+            std::vector<size_t> shape = h.shape;
+            //== a fortran-ordered array is exposed as its row-major transpose
+            if(h.fortran_order) std::reverse(shape.begin(), shape.end());
+            return make_view<T>(f, offset + h.data_offset, std::move(shape), 0, what);
+        }
+
+        //== {offset, bytes} of a stored member of a zip archive
+        inline std::pair<size_t, size_t> zip_member(const mapped_file& f, const std::string& name)
+        {
+            const char* p = f.data();
+            const size_t n = f.size();
+            size_t eocd = std::string::npos;
+            for(size_t i = n >= 22 ? n - 22 : 0; i + 22 <= n; i--){
+                if(0x06054b50 == read_le(p + i, 4)){ eocd = i; break; }
+                if(0 == i || n - i > 22 + 65535) break;
+            }
+            if(std::string::npos == eocd) throw std::runtime_error("npz: no end of central directory");
+            uint64_t entries = read_le(p + eocd + 10, 2), cd = read_le(p + eocd + 16, 4);
+            if((0xffff == entries || 0xffffffff == cd) && eocd >= 20 && 0x07064b50 == read_le(p + eocd - 20, 4)){
+                const size_t z = read_le(p + eocd - 20 + 8, 8);
+                if(z + 56 > n || 0x06064b50 != read_le(p + z, 4)) throw std::runtime_error("npz: bad zip64 directory");
+                entries = read_le(p + z + 32, 8);
+                cd = read_le(p + z + 48, 8);
+            }
+            for(uint64_t e = 0; e < entries; e++){
+                if(cd + 46 > n || 0x02014b50 != read_le(p + cd, 4)) throw std::runtime_error("npz: bad central directory");
+                const int method = int(read_le(p + cd + 10, 2));
+                uint64_t csize = read_le(p + cd + 20, 4), usize = read_le(p + cd + 24, 4), local = read_le(p + cd + 42, 4);
+                const size_t nlen = read_le(p + cd + 28, 2), elen = read_le(p + cd + 30, 2), clen = read_le(p + cd + 32, 2);
+                const std::string member(p + cd + 46, nlen);
+                //== zip64 extra field : the 0xffffffff fields follow in order usize, csize, offset
+                for(size_t x = cd + 46 + nlen; x + 4 <= cd + 46 + nlen + elen;){
+                    const size_t tag = read_le(p + x, 2), len = read_le(p + x + 2, 2);
+                    if(1 == tag){
+                        size_t y = x + 4;
+                        if(0xffffffff == usize){ usize = read_le(p + y, 8); y += 8; }
+                        if(0xffffffff == csize){ csize = read_le(p + y, 8); y += 8; }
+                        if(0xffffffff == local){ local = read_le(p + y, 8); y += 8; }
+                    }
+                    x += 4 + len;
+                }
+                cd += 46 + nlen + elen + clen;
+                if(member != name && member != name + ".npy") continue;
+                if(0 != method || csize != usize) throw std::runtime_error("npz: member " + name + " is compressed, save it with np.savez");
+                if(local + 30 > n || 0x04034b50 != read_le(p + local, 4)) throw std::runtime_error("npz: bad local header");
+                const size_t data = local + 30 + read_le(p + local + 26, 2) + read_le(p + local + 28, 2);
+                if(data + usize > n) throw std::runtime_error("npz: truncated member " + name);
+                return {data, usize};
+            }
+            throw std::runtime_error("npz: no member " + name);
+        }
+    }
+
+    //== `shape` row-major, `header_bytes` skipped at the start, rows every `row_pitch` elements (0 : packed)
+    template<class T> mapped_array<T> map_raw(const std::string& path, std::vector<size_t> shape, access mode = access::read_only,
+                                              size_t header_bytes = 0, size_t row_pitch = 0)
+    {
+        mapped_file f(path, mode);
+        auto v = detail::make_view<T>(f, header_bytes, std::move(shape), row_pitch, "map_raw " + path);
+        return mapped_array<T>(std::move(f), std::move(v));
+    }
+    template<class T> mapped_array<T> map_npy(const std::string& path, access mode = access::read_only)
+    {
+        mapped_file f(path, mode);
+        auto v = detail::npy_view<T>(f, 0, f.size(), "map_npy " + path);
+        return mapped_array<T>(std::move(f), std::move(v));
+    }
+    //== member `name` (with or without .npy) of an uncompressed .npz archive.
+    //   numpy does not align members : the data may only be aligned to one byte.
+    template<class T> mapped_array<T> map_npz(const std::string& path, const std::string& name, access mode = access::read_only)
+    {
+        mapped_file f(path, mode);
+        const auto [offset, bytes] = detail::zip_member(f, name);
+        auto v = detail::npy_view<T>(f, offset, bytes, "map_npz " + path + ":" + name);
+        return mapped_array<T>(std::move(f), std::move(v));
+    }
+
+    //== new raw file of rows padded to `row_pitch` elements (0 : packed), mapped read-write.
+    //   padded_width<T>(n) gives the in-place fft layout of cal_fft_memory_layout.
+    template<class T> mapped_array<T> create_raw(const std::string& path, std::vector<size_t> shape, size_t row_pitch = 0)
+    {
+        array_view<T> v{nullptr, std::move(shape), 0};
+        v.row_pitch = row_pitch ? row_pitch : v.width();
+        auto f = mapped_file::create(path, v.rows() * v.row_pitch * sizeof(T));
+        v = detail::make_view<T>(f, 0, std::move(v.shape), v.row_pitch, "create_raw " + path);
+        return mapped_array<T>(std::move(f), std::move(v));
+    }
+    //== new .npy file mapped read-write, the data starts 64-byte aligned
+    template<class T> mapped_array<T> create_npy(const std::string& path, std::vector<size_t> shape)
+    {
+        const std::string header = make_npy_header(npy_descr<T>(), shape);
+        size_t n = 1;
+        for(size_t s : shape) n *= s;
+        auto f = mapped_file::create(path, header.size() + n * sizeof(T));
+        std::memcpy(f.data(), header.data(), header.size());
+        auto v = detail::make_view<T>(f, header.size(), std::move(shape), 0, "create_npy " + path);
+        return mapped_array<T>(std::move(f), std::move(v));
+    }
+
+    template<class T> size_t padded_width(size_t n)
+    {
+        return is_real_v<T> ? 2 * (n / 2 + 1) : n;
+    }
+    //== row by row copy between views of the same shape, padding of `to` is left untouched
+    template<class T> void copy_rows(array_view<const T> from, array_view<T> to)
+    {
+        if(from.shape != to.shape) throw std::invalid_argument("copy_rows: shapes differ");
+        MEKIL_TRACE_SCOPE("io.copy_rows", 2 * sizeof(T) * from.rows() * from.width(), from.rows(), from.width());
+        const size_t rows = from.rows(), bytes = from.width() * sizeof(T);
+        const int nthreads = mkl::loop_threads(rows * from.width());
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long r = 0; r < (long long)rows; r++) std::memcpy(to.row(r), from.row(r), bytes);
+    }
+    //== fill `out`, laid out as cal_fft_memory_layout (fastest axis padded to padded_width<T>),
+    //   in one pass over the mapping
+    template<class T> void load_padded(array_view<const T> from, T* out)
+    {
+        copy_rows<T>(from, array_view<T>{out, from.shape, padded_width<T>(from.width())});
+    }
+
+    template<class T> void write_raw(const std::string& path, array_view<const T> v)
+    {
+        auto out = create_raw<T>(path, v.shape);
+        copy_rows<T>(v, out.mutable_view());
+    }
+    template<class T> void write_npy(const std::string& path, array_view<const T> v)
+    {
+        auto out = create_npy<T>(path, v.shape);
+        copy_rows<T>(v, out.mutable_view());
+    }
+
+    //== one array of an .npz archive
+    struct npz_entry
+    {
+        std::string name;
+        const char* descr;
+        size_t element_size;
+        array_view<const char> bytes;     // row_pitch and width in elements of element_size bytes
+        template<class T> npz_entry(std::string member, array_view<const T> v)
+            : name(std::move(member)), descr(npy_descr<T>()), element_size(sizeof(T)),
+              bytes{reinterpret_cast<const char*>(v.data), v.shape, v.row_pitch} {}
+    };
+    //== uncompressed archive readable by np.load. member data is 64-byte aligned in the file
+    //   (padding extra field), so map_npz hands out aligned views of these archives.
+    inline void write_npz(const std::string& path, const std::vector<npz_entry>& entries)
+    {
+        using detail::write_le;
+        constexpr uint64_t u32 = 0xffffffff;
+        struct layout {std::string file, header; size_t local, data, bytes; bool zip64;};
+        std::vector<layout> members;
+        size_t offset = 0;
+        for(const auto& e : entries){
+            layout m;
+            m.file = e.name + ".npy";
+            m.header = make_npy_header(e.descr, e.bytes.shape);
+            m.bytes = m.header.size() + e.bytes.rows() * e.bytes.width() * e.element_size;
+            m.zip64 = m.bytes >= u32 || offset >= u32;
+            m.local = offset;
+            const size_t fixed = 30 + m.file.size() + (m.zip64 ? 20 : 0) + 4;
+            m.data = (offset + fixed + memory::alignment - 1) / memory::alignment * memory::alignment;
+            offset = m.data + m.bytes;
+            members.push_back(std::move(m));
+        }
+        size_t central = 0;
+        for(const auto& m : members) central += 46 + m.file.size() + (m.zip64 ? 28 : 0);
+        const bool zip64 = offset >= u32 || central >= u32 || members.size() >= 0xffff;
+        auto f = mapped_file::create(path, offset + central + (zip64 ? 56 + 20 : 0) + 22);
+        char* p = f.data();
+
+        for(size_t i = 0; i < members.size(); i++){
+            const auto& m = members[i];
+            const auto& e = entries[i];
+            char* header = p + m.data;
+            std::memcpy(header, m.header.data(), m.header.size());
+            copy_rows<char>(array_view<const char>{e.bytes.data, {e.bytes.rows(), e.bytes.width() * e.element_size}, e.bytes.row_pitch * e.element_size},
+                            array_view<char>{header + m.header.size(), {e.bytes.rows(), e.bytes.width() * e.element_size}, e.bytes.width() * e.element_size});
+            const uint32_t crc = detail::crc32(header, m.bytes);
+
+            char* l = p + m.local;
+            const size_t extra = m.data - m.local - 30 - m.file.size();
+            write_le(l, 0x04034b50, 4);
+            write_le(l + 4, m.zip64 ? 45 : 20, 2);
+            write_le(l + 14, crc, 4);
+            write_le(l + 18, m.zip64 ? u32 : m.bytes, 4);
+            write_le(l + 22, m.zip64 ? u32 : m.bytes, 4);
+            write_le(l + 26, m.file.size(), 2);
+            write_le(l + 28, extra, 2);
+            std::memcpy(l + 30, m.file.data(), m.file.size());
+            char* x = l + 30 + m.file.size();
+            if(m.zip64){
+                write_le(x, 1, 2);
+                write_le(x + 2, 16, 2);
+                write_le(x + 4, m.bytes, 8);
+                write_le(x + 12, m.bytes, 8);
+                x += 20;
+            }
+            write_le(x, 0xd935, 2);     // alignment padding
+            write_le(x + 2, extra - (x + 4 - l - 30 - m.file.size()), 2);
+        }
+        char* c = p + offset;
+        for(size_t i = 0; i < members.size(); i++){
+            const auto& m = members[i];
+            write_le(c, 0x02014b50, 4);
+            write_le(c + 4, m.zip64 ? 45 : 20, 2);
+            write_le(c + 6, m.zip64 ? 45 : 20, 2);
+            std::memcpy(c + 16, p + m.local + 14, 4);   // crc
+            write_le(c + 20, m.zip64 ? u32 : m.bytes, 4);
+            write_le(c + 24, m.zip64 ? u32 : m.bytes, 4);
+            write_le(c + 28, m.file.size(), 2);
+            write_le(c + 30, m.zip64 ? 28 : 0, 2);
+            write_le(c + 42, m.zip64 ? u32 : m.local, 4);
+            std::memcpy(c + 46, m.file.data(), m.file.size());
+            c += 46 + m.file.size();
+            if(m.zip64){
+                write_le(c, 1, 2);
+                write_le(c + 2, 24, 2);
+                write_le(c + 4, m.bytes, 8);
+                write_le(c + 12, m.bytes, 8);
+                write_le(c + 20, m.local, 8);
+                c += 28;
+            }
+        }
+        if(zip64){
+            write_le(c, 0x06064b50, 4);
+            write_le(c + 4, 44, 8);
+            write_le(c + 12, 45, 2);
+            write_le(c + 14, 45, 2);
+            write_le(c + 24, members.size(), 8);
+            write_le(c + 32, members.size(), 8);
+            write_le(c + 40, central, 8);
+            write_le(c + 48, offset, 8);
+            write_le(c + 56, 0x07064b50, 4);
+            write_le(c + 64, offset + central, 8);
+            write_le(c + 72, 1, 4);
+            c += 76;
+        }
+        write_le(c, 0x06054b50, 4);
+        write_le(c + 8, zip64 ? 0xffff : members.size(), 2);
+        write_le(c + 10, zip64 ? 0xffff : members.size(), 2);
+        write_le(c + 12, zip64 ? u32 : central, 4);
+        write_le(c + 16, zip64 ? u32 : offset, 4);
+        f.flush();
+    }
+
+    //== transform of the last `rank` axes, the leading axes are batched
+    struct fft_geometry
+    {
+        std::vector<MKL_LONG> dims;
+        std::vector<MKL_LONG> strides;  // {offset, strides...}
+        MKL_LONG distance;
+        int batch;
+    };
+    template<class T> fft_geometry geometry(const array_view<T>& v, size_t rank)
+    {
+        if(0 == rank || rank > v.shape.size()) throw std::invalid_argument("geometry: rank must be in [1, ndim]");
+        fft_geometry g;
+        g.dims.assign(v.shape.end() - rank, v.shape.end());
+        g.strides.assign(rank + 1, 0);
+        MKL_LONG stride = 1;
+        for(size_t i = rank; i > 0; i--){
+            g.strides[i] = stride;
+            stride *= (i == rank ? MKL_LONG(v.row_pitch) : g.dims[i - 1]);
+        }
+        g.distance = stride;
+        g.batch = 1;
+        for(size_t i = 0; i + rank < v.shape.size(); i++) g.batch *= int(v.shape[i]);
+        return g;
+    }
+    //== forward plan reading straight from the view (e.g. a mapping),
+    //   writing packed half (real) or full (complex) spectra back to back
+    template<class T> mekil::fft_plan<std::remove_const_t<T>> forward_plan(const array_view<T>& v, size_t rank, real_t<std::remove_const_t<T>> normalize_factor = 0)
+    {
+        using fft_t = mekil::mklFFT<std::remove_const_t<T>>;
+        const fft_geometry g = geometry(v, rank);
+        const auto [out_strides, out_distance] = fft_t::packed_layout(g.dims, fft_t::fourier_fastest_size(g.dims.back()));
+        return mekil::fft_plan<std::remove_const_t<T>>::strided(g.dims, true, g.strides, g.distance, out_strides, out_distance, g.batch, normalize_factor);
+    }
+}
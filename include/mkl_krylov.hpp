@@ -0,0 +1,430 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_arena.hpp"
+#include "mkl_blas.hpp"
+#include "mkl_block_qr.hpp"
+#include "mkl_lapack.hpp"
+#include "mkl_operator.hpp"
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+//== Krylov-Schur eigensolver (Stewart 2001).
+//   hermitian operators : thick-restart Lanczos with full re-orthogonalization,
+//   general operators   : Krylov-Schur restart of Arnoldi, equivalent to implicit restarts.
+//   the Krylov basis V is column-major (ld = n) so every projection is a single cblas gemv
+//   (classical Gram-Schmidt, applied twice) and every restart a single gemm.
+//   block_size b > 1 expands b vectors per step : the operator is applied to a whole block,
+//   the projections become gemm, the start block is orthonormalized by cholqr2 / tsqr and every new
+//   block column by column, deflating the columns that add no direction.
+//
+//   the operator is any callable `op(const T* x, T* y)` computing y = A x,
+//   or one of the operator classes of mkl_operator.hpp (dense, CSR/BSR, callback).
+namespace mkl::krylov
+{
+    enum class which
+    {
+        largest_magnitude,
+        smallest_magnitude,
+        largest_real,       // largest algebraic for hermitian operators
+        smallest_real,
+    };
+    struct options
+    {
+        int nev = 1;            // number of wanted eigenpairs
+        int ncv = 0;            // basis size, 0 : max(2 * nev + 1, 20) + 4 * (block_size - 1), clipped to n
+        int max_restarts = 300;
+        double tol = 0;         // relative residual, 0 : machine epsilon of the value type
+        which target = which::largest_magnitude;
+        unsigned seed = 0;      // start vector when none is given
+        int block_size = 1;     // > 1 : block Krylov, b products per step through apply_block
+    };
+    template<class TValue, class TVector> struct eigen_result
+    {
+        std::vector<TValue> values;     // nev values, most wanted first
+        std::vector<TVector> vectors;   // n x nev, column-major, unit norm
+        size_t n = 0;
+        int converged = 0;
+        int restarts = 0;
+        size_t matvecs = 0;
+    };
+
+    template<class T> inline real_t<T> priority(which target, const T& lambda)
+    {
+        switch(target){
+            case which::largest_magnitude:  return std::abs(lambda);
+            case which::smallest_magnitude: return -std::abs(lambda);
+            case which::largest_real:       return std::real(lambda);
+            case which::smallest_real:      return -std::real(lambda);
+        }
+        return 0;
+    }
+
+    template<class T, bool is_hermitian> class krylov_schur
+    {
+    public:
+        using real_type = real_t<T>;
+        using value_type = std::conditional_t<is_hermitian, real_type, complex_t<T>>;
+        using vector_type = std::conditional_t<is_hermitian, T, complex_t<T>>;
+        using result_type = eigen_result<value_type, vector_type>;
+
+        krylov_schur(size_t n, const options& opt) : n_(n), opt_(opt), b_(std::max(1, opt.block_size))
+        {
+            if(opt_.nev < 1 || size_t(opt_.nev) >= n_) throw std::invalid_argument("krylov: 0 < nev < n is required");
+            m_ = opt_.ncv > 0 ? opt_.ncv : std::max(2 * opt_.nev + 1, 20) + 4 * (b_ - 1);
+            m_ = std::max(m_, opt_.nev + b_ + 1);
+            //== the basis grows by whole blocks up to m + b - 1 columns, plus the residual block
+            if(size_t(m_ + 2 * b_ - 1) > n_) m_ = int(n_) - 2 * b_ + 1;
+            if(m_ < opt_.nev + b_ + 1) throw std::invalid_argument("krylov: operator too small for nev and block_size");
+            cap_ = m_ + b_ - 1;
+            ldh_ = cap_ + b_;
+            tol_ = opt_.tol > 0 ? real_type(opt_.tol) : std::numeric_limits<real_type>::epsilon();
+            V_.assign(n_ * ldh_, T(0));
+            H_.assign(size_t(ldh_) * cap_, T(0));
+            Q_.assign(size_t(cap_) * cap_, T(0));
+        }
+
+        template<class Op> result_type solve(Op&& op, const T* v0 = nullptr)
+        {
+            result_type result;
+            result.n = n_;
+            init_start_block(v0);
+            int k = 0;
+            for(int restart = 0; restart <= opt_.max_restarts; restart++){
+                int j = k;
+                for(; j < m_; j += b_) expand(op, j, result.matvecs);
+                int nconv = 0;
+                const int keep = schur_restart(j, nconv, restart == opt_.max_restarts);
+                result.restarts = restart;
+                result.converged = nconv;
+                if(keep < 0) break;
+                k = keep;
+            }
+            extract(result);
+            return result;
+        }
+
+    private:
+        T* col(int j) {return V_.data() + size_t(j) * n_;}
+        T& H(int i, int j) {return H_[size_t(j) * ldh_ + i];}
+
+        void random_vector(T* v, unsigned seed)
+        {
+            std::mt19937 gen(seed);
+            std::uniform_real_distribution<real_type> dis(-1, 1);
+            for(size_t i = 0; i < n_; i++){
+                if constexpr(is_complex_v<T>) v[i] = T(dis(gen), dis(gen));
+                else v[i] = dis(gen);
+            }
+        }
+        void init_start_block(const T* v0)
+        {
+            if(v0) std::copy(v0, v0 + n_, col(0));
+            else random_vector(col(0), opt_.seed);
+            const real_type norm = blas::nrm2<T>(n_, col(0));
+            if(!(norm > 0)) throw std::invalid_argument("krylov: start vector is zero");
+            blas::scal<T>(n_, T(1 / norm), col(0));
+            for(int i = 1; i < b_; i++) random_vector(col(i), opt_.seed + 104729u * unsigned(i));
+            if(b_ > 1){
+                aligned_vector<T> R(size_t(b_) * b_);
+                block_qr<T>(n_, b_, col(0), n_, R.data(), b_);
+            }
+        }
+        //== W -= V[:, first:first+k] (V[:, first:first+k]^H W), twice (CGS2), projections accumulated
+        //   into C (k x ncol, ld k). gemv for single vectors, gemm for blocks.
+        void orthogonalize(int k, T* W, int ncol, T* C, int first = 0)
+        {
+            aligned_vector<T> c(size_t(k) * ncol);
+            std::fill(C, C + size_t(k) * ncol, T(0));
+            if(0 == k) return;
+            const T* V = col(first);
+            for(int pass = 0; pass < 2; pass++){
+                if(1 == ncol){
+                    blas::gemv<T>(blas::adjoint<T>, n_, k, T(1), V, n_, W, 1, T(0), c.data(), 1);
+                    blas::gemv<T>(CblasNoTrans, n_, k, T(-1), V, n_, c.data(), 1, T(1), W, 1);
+                }
+                else{
+                    blas::gemm<T>(blas::adjoint<T>, CblasNoTrans, k, ncol, n_, T(1), V, n_, W, n_, T(0), c.data(), k);
+                    blas::gemm<T>(CblasNoTrans, CblasNoTrans, n_, ncol, k, T(-1), V, n_, c.data(), k, T(1), W, n_);
+                }
+                for(size_t i = 0; i < c.size(); i++) C[i] += c[i];
+            }
+        }
+        //== V[:, j+b : j+2b] = A V[:, j : j+b] orthonormalized against V[:, 0 : j+b].
+        //   the block is projected out of the basis with gemm (CGS2), then its columns are orthonormalized
+        //   one at a time against the columns before them, so A V = V H + residual holds exactly :
+        //   a column whose remainder falls below sqrt(eps) of its norm has no new direction (the Krylov
+        //   space is (nearly) invariant), it is replaced by a random direction orthogonal to the basis
+        //   and the following columns are orthogonalized against that replacement.
+        template<class Op> void expand(Op& op, int j, size_t& matvecs)
+        {
+            const int b = b_;
+            T* W = col(j + b);
+            mkl::apply_block<T>(op, col(j), b, n_, W, n_);
+            matvecs += b;
+            aligned_vector<real_type> wnorm(b);
+            for(int i = 0; i < b; i++) wnorm[i] = blas::nrm2<T>(n_, W + size_t(i) * n_);
+
+            aligned_vector<T> C(size_t(j + b) * b);
+            orthogonalize(j + b, W, b, C.data());
+            for(int c = 0; c < b; c++) for(int i = 0; i < j + b; i++) H(i, j + c) = C[size_t(c) * (j + b) + i];
+
+            const real_type rank_tol = std::sqrt(std::numeric_limits<real_type>::epsilon());
+            aligned_vector<T> R(size_t(b) * b, T(0)), c(size_t(j + 2 * b));
+            for(int i = 0; i < b; i++){
+                T* w = W + size_t(i) * n_;
+                const real_type before = blas::nrm2<T>(n_, w);
+                orthogonalize(i, w, 1, R.data() + size_t(i) * b, j + b);
+                real_type norm = blas::nrm2<T>(n_, w);
+                //== most of the column cancelled inside the block : one more pass over the whole basis
+                if(norm < real_type(0.7) * before){
+                    orthogonalize(j + b + i, w, 1, c.data());
+                    for(int r = 0; r < j + b; r++) H(r, j + i) += c[r];
+                    for(int r = 0; r < i; r++) R[size_t(i) * b + r] += c[j + b + r];
+                    norm = blas::nrm2<T>(n_, w);
+                }
+                if(norm > rank_tol * wnorm[i]){
+                    R[size_t(i) * b + i] = norm;
+                    blas::scal<T>(n_, T(1 / norm), w);
+                    continue;
+                }
+                //== (nearly) invariant subspace : continue with a random direction orthogonal to the basis
+                for(unsigned attempt = 1; attempt < 4; attempt++){
+                    random_vector(w, opt_.seed + 7919u * unsigned(j + i + attempt));
+                    const real_type tnorm = blas::nrm2<T>(n_, w);
+                    orthogonalize(j + b + i, w, 1, c.data());
+                    if(blas::nrm2<T>(n_, w) > real_type(0.5) * tnorm) break;
+                }
+                blas::scal<T>(n_, T(1 / blas::nrm2<T>(n_, w)), w);
+                R[size_t(i) * b + i] = T(0);
+            }
+            for(int cc = 0; cc < b; cc++) for(int i = 0; i <= cc; i++) H(j + b + i, j + cc) = R[size_t(cc) * b + i];
+        }
+        //== Schur form of H[0:mc, 0:mc] sorted by priority, convergence test, restart to `keep` vectors.
+        //   the residual block couples through Hr = H[mc : mc+b, 0 : mc], the residual of a Ritz
+        //   vector V y is ||Hr y||. returns -1 when done.
+        int schur_restart(int mc, int& nconv, bool last)
+        {
+            const int m = mc, b = b_;
+            const T* Hr = &H(m, 0);
+            aligned_vector<T> S(size_t(m) * m);
+            for(int j = 0; j < m; j++) for(int i = 0; i < m; i++) S[size_t(j) * m + i] = H(i, j);
+
+            aligned_vector<value_type> ritz(m);
+            aligned_vector<real_type> residual(m);
+            int p = 0;
+            if constexpr(is_hermitian){
+                aligned_vector<real_type> w(m);
+                if(0 != lapack::heev<T>('V', m, S.data(), m, w.data())) throw std::runtime_error("krylov: heev failed");
+                aligned_vector<int> order(m);
+                std::iota(order.begin(), order.end(), 0);
+                std::stable_sort(order.begin(), order.end(), [&](int a, int b){
+                    return priority(opt_.target, w[a]) > priority(opt_.target, w[b]);
+                });
+                for(int j = 0; j < m; j++){
+                    ritz[j] = w[order[j]];
+                    std::copy(S.begin() + size_t(order[j]) * m, S.begin() + size_t(order[j] + 1) * m, Q_.begin() + size_t(j) * m);
+                }
+                aligned_vector<T> Z(size_t(b) * m);
+                blas::gemm<T>(CblasNoTrans, CblasNoTrans, b, m, m, T(1), Hr, ldh_, Q_.data(), m, T(0), Z.data(), b);
+                for(int j = 0; j < m; j++) residual[j] = blas::nrm2<T>(b, Z.data() + size_t(j) * b);
+                nconv = count_converged(ritz, residual);
+                if(nconv >= opt_.nev || last){
+                    mc_ = m;
+                    ritz_.assign(ritz.begin(), ritz.begin() + opt_.nev);
+                    Y_.assign(Q_.begin(), Q_.begin() + size_t(opt_.nev) * m);
+                    return -1;
+                }
+                p = keep_size(nconv);
+            }
+            else{
+                aligned_vector<complex_t<T>> w(m);
+                if(0 != lapack::gees<T>(m, S.data(), m, w.data(), Q_.data(), m)) throw std::runtime_error("krylov: gees failed");
+                //== select the `keep` most wanted eigenvalues, conjugate pairs are never split
+                aligned_vector<int> order(m);
+                std::iota(order.begin(), order.end(), 0);
+                std::stable_sort(order.begin(), order.end(), [&](int a, int b){
+                    return priority(opt_.target, w[a]) > priority(opt_.target, w[b]);
+                });
+                const int wanted = last ? opt_.nev : std::max(opt_.nev, keep_size(0));
+                aligned_vector<lapack_logical> select(m, 0);
+                for(int j = 0; j < wanted; j++) select[order[j]] = 1;
+                if constexpr(is_real_v<T>){
+                    for(int i = 0; i + 1 < m; i++){
+                        if(w[i].imag() != 0 && w[i + 1] == std::conj(w[i]) && (select[i] || select[i + 1])){
+                            select[i] = select[i + 1] = 1;
+                            i++;
+                        }
+                    }
+                }
+                lapack_int msel = 0;
+                if(0 != lapack::trsen<T>(select.data(), m, S.data(), m, Q_.data(), m, w.data(), &msel)) throw std::runtime_error("krylov: trsen failed");
+                p = msel;
+
+                //== Ritz pairs of the leading block and their residuals ||Hr Q[:, 0:msel] y||
+                aligned_vector<T> Tp(size_t(msel) * msel), Y(size_t(msel) * msel);
+                for(int j = 0; j < msel; j++) for(int i = 0; i < msel; i++) Tp[size_t(j) * msel + i] = S[size_t(j) * m + i];
+                if(0 != lapack::trevc<T>(msel, Tp.data(), msel, Y.data(), msel)) throw std::runtime_error("krylov: trevc failed");
+                aligned_vector<complex_t<T>> Yc(size_t(msel) * msel);
+                complex_vectors(msel, w.data(), Y.data(), Yc.data());
+                aligned_vector<T> B(size_t(b) * msel);
+                blas::gemm<T>(CblasNoTrans, CblasNoTrans, b, msel, m, T(1), Hr, ldh_, Q_.data(), m, T(0), B.data(), b);
+                aligned_vector<real_type> res(msel);
+                for(int j = 0; j < msel; j++){
+                    real_type r2 = 0;
+                    for(int r = 0; r < b; r++){
+                        complex_t<T> s = 0;
+                        for(int i = 0; i < msel; i++) s += complex_t<T>(B[size_t(i) * b + r]) * Yc[size_t(j) * msel + i];
+                        r2 += std::norm(s);
+                    }
+                    res[j] = std::sqrt(r2);
+                }
+                aligned_vector<int> lead(msel);
+                std::iota(lead.begin(), lead.end(), 0);
+                std::stable_sort(lead.begin(), lead.end(), [&](int a, int b){
+                    return priority(opt_.target, w[a]) > priority(opt_.target, w[b]);
+                });
+                for(int j = 0; j < msel; j++){
+                    ritz[j] = w[lead[j]];
+                    residual[j] = res[lead[j]];
+                }
+                nconv = count_converged(ritz, residual);
+                if(nconv >= opt_.nev || last){
+                    mc_ = m;
+                    ritz_.assign(ritz.begin(), ritz.begin() + opt_.nev);
+                    //== eigenvectors in the basis V[:, 0:m] : Q[:, 0:msel] * y
+                    Yc_.assign(size_t(opt_.nev) * m, complex_t<T>(0));
+                    for(int j = 0; j < opt_.nev; j++){
+                        for(int r = 0; r < m; r++){
+                            complex_t<T> s = 0;
+                            for(int i = 0; i < msel; i++) s += complex_t<T>(Q_[size_t(i) * m + r]) * Yc[size_t(lead[j]) * msel + i];
+                            Yc_[size_t(j) * m + r] = s;
+                        }
+                    }
+                    return -1;
+                }
+                //== keep the reordered Schur block for the restart
+                schur_.assign(size_t(p) * p, T(0));
+                for(int j = 0; j < p; j++) for(int i = 0; i < p; i++) schur_[size_t(j) * p + i] = S[size_t(j) * m + i];
+            }
+
+            //== coupling of the kept vectors with the residual block : Hr Q[:, 0:p]
+            aligned_vector<T> coupling(size_t(b) * p);
+            blas::gemm<T>(CblasNoTrans, CblasNoTrans, b, p, m, T(1), Hr, ldh_, Q_.data(), m, T(0), coupling.data(), b);
+
+            //== V[:, 0:p] = V[:, 0:m] Q[:, 0:p], V[:, p:p+b] = V[:, m:m+b]
+            aligned_vector<T> work(n_ * size_t(p));
+            blas::gemm<T>(CblasNoTrans, CblasNoTrans, n_, p, m, T(1), V_.data(), n_, Q_.data(), m, T(0), work.data(), n_);
+            std::copy(work.begin(), work.end(), V_.begin());
+            std::copy(col(m), col(m + b), col(p));
+
+            //== H = [ diag(ritz) or Schur block ; Hr Q[:, 0:p] ]
+            std::fill(H_.begin(), H_.end(), T(0));
+            for(int j = 0; j < p; j++){
+                if constexpr(is_hermitian) H(j, j) = T(ritz[j]);
+                else for(int i = 0; i <= j + 1 && i < p; i++) H(i, j) = schur_[size_t(j) * p + i];
+                for(int r = 0; r < b; r++) H(p + r, j) = coupling[size_t(j) * b + r];
+            }
+            return p;
+        }
+        //== at least one block of new directions per restart; general operators keep one more
+        //   column of room so a conjugate pair appended by the selection still fits
+        int keep_size(int nconv) const
+        {
+            const int room = is_hermitian ? b_ : b_ + 1;
+            const int keep = std::max(opt_.nev + nconv, (opt_.nev + m_) / 2);
+            return std::max(1, std::min(keep, m_ - room));
+        }
+        int count_converged(const aligned_vector<value_type>& ritz, const aligned_vector<real_type>& residual) const
+        {
+            const real_type eps23 = std::pow(std::numeric_limits<real_type>::epsilon(), real_type(2) / 3);
+            int nconv = 0;
+            for(int j = 0; j < opt_.nev; j++){
+                if(residual[j] <= tol_ * std::max(std::abs(ritz[j]), eps23)) nconv++;
+            }
+            return nconv;
+        }
+        //== trevc output -> complex columns (real types keep conjugate pairs in two columns)
+        static void complex_vectors(int n, const complex_t<T>* w, const T* Y, complex_t<T>* Yc)
+        {
+            for(int j = 0; j < n; j++){
+                if constexpr(is_real_v<T>){
+                    if(w[j].imag() != 0 && j + 1 < n){
+                        for(int i = 0; i < n; i++){
+                            const complex_t<T> v(Y[size_t(j) * n + i], Y[size_t(j + 1) * n + i]);
+                            Yc[size_t(j) * n + i] = v;
+                            Yc[size_t(j + 1) * n + i] = std::conj(v);
+                        }
+                        j++;
+                        continue;
+                    }
+                }
+                for(int i = 0; i < n; i++) Yc[size_t(j) * n + i] = Y[size_t(j) * n + i];
+            }
+        }
+        void extract(result_type& result)
+        {
+            const int nev = opt_.nev;
+            result.values.assign(ritz_.begin(), ritz_.end());
+            result.vectors.assign(n_ * nev, vector_type(0));
+            if constexpr(is_hermitian){
+                blas::gemm<T>(CblasNoTrans, CblasNoTrans, n_, nev, mc_, T(1), V_.data(), n_, Y_.data(), mc_, T(0), result.vectors.data(), n_);
+            }
+            else if constexpr(is_complex_v<T>){
+                blas::gemm<T>(CblasNoTrans, CblasNoTrans, n_, nev, mc_, T(1), V_.data(), n_, Yc_.data(), mc_, T(0), result.vectors.data(), n_);
+            }
+            else{
+                //== real basis times complex coefficients : real and imaginary parts separately
+                aligned_vector<T> re(size_t(mc_) * nev), im(size_t(mc_) * nev), xr(n_ * nev), xi(n_ * nev);
+                for(size_t i = 0; i < re.size(); i++){
+                    re[i] = Yc_[i].real();
+                    im[i] = Yc_[i].imag();
+                }
+                blas::gemm<T>(CblasNoTrans, CblasNoTrans, n_, nev, mc_, T(1), V_.data(), n_, re.data(), mc_, T(0), xr.data(), n_);
+                blas::gemm<T>(CblasNoTrans, CblasNoTrans, n_, nev, mc_, T(1), V_.data(), n_, im.data(), mc_, T(0), xi.data(), n_);
+                for(size_t i = 0; i < xr.size(); i++) result.vectors[i] = vector_type(xr[i], xi[i]);
+            }
+            for(int j = 0; j < nev; j++){
+                vector_type* x = result.vectors.data() + size_t(j) * n_;
+                const real_type norm = blas::nrm2<vector_type>(n_, x);
+                if(norm > 0) blas::scal<vector_type>(n_, vector_type(1 / norm), x);
+            }
+        }
+
+        size_t n_;
+        options opt_;
+        int b_;
+        int m_;     // basis size that triggers a restart
+        int cap_;   // largest basis size, m + b - 1
+        int ldh_;   // leading dimension of H, cap + b
+        int mc_ = 0;
+        real_type tol_;
+        aligned_vector<T> V_, H_, Q_, Y_, schur_;
+        aligned_vector<complex_t<T>> Yc_;
+        aligned_vector<value_type> ritz_;
+    };
+
+    //== eigenpairs of a hermitian (real symmetric) operator
+    template<class T, class Op> eigen_result<real_t<T>, T> eigsh(Op&& op, size_t n, const options& opt = {}, const T* v0 = nullptr)
+    {
+        return krylov_schur<T, true>(n, opt).solve(op, v0);
+    }
+    //== eigenpairs of a general operator, values and vectors are complex
+    template<class T, class Op> eigen_result<complex_t<T>, complex_t<T>> eigs(Op&& op, size_t n, const options& opt = {}, const T* v0 = nullptr)
+    {
+        return krylov_schur<T, false>(n, opt).solve(op, v0);
+    }
+    //== operator objects carry their own size and value type
+    template<class Op, class T = typename std::decay_t<Op>::value_type>
+    eigen_result<real_t<T>, T> eigsh(const Op& op, const options& opt = {}, const T* v0 = nullptr)
+    {
+        assert(op.rows() == op.cols());
+        return krylov_schur<T, true>(op.rows(), opt).solve(op, v0);
+    }
+    template<class Op, class T = typename std::decay_t<Op>::value_type>
+    eigen_result<complex_t<T>, complex_t<T>> eigs(const Op& op, const options& opt = {}, const T* v0 = nullptr)
+    {
+        assert(op.rows() == op.cols());
+        return krylov_schur<T, false>(op.rows(), opt).solve(op, v0);
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_arena.hpp"
+
+//== typed column-major LAPACKE wrappers, every routine returns the LAPACK info code.
+namespace mkl::lapack
+{
+    template<class T> inline mkl_t<T>* cast(T* p) {return reinterpret_cast<mkl_t<T>*>(p);}
+    template<class T> inline const mkl_t<T>* cast(const T* p) {return reinterpret_cast<const mkl_t<T>*>(p);}
+
+    //== Schur factorization A = Q T Q^H, eigenvalues returned as complex numbers
+    template<class T> inline lapack_int gees(lapack_int n, T* a, lapack_int lda, complex_t<T>* w, T* vs, lapack_int ldvs)
+    {
+        lapack_int sdim = 0;
+        if constexpr(is_real_v<T>){
+            mkl::scratch<T> wr(n), wi(n);
+            lapack_int info = 0;
+            if constexpr(is_s<T>) info = LAPACKE_sgees(LAPACK_COL_MAJOR, 'V', 'N', nullptr, n, a, lda, &sdim, wr.data(), wi.data(), vs, ldvs);
+            else                  info = LAPACKE_dgees(LAPACK_COL_MAJOR, 'V', 'N', nullptr, n, a, lda, &sdim, wr.data(), wi.data(), vs, ldvs);
+            for(lapack_int i = 0; i < n; i++) w[i] = complex_t<T>(wr[i], wi[i]);
+            return info;
+        }
+        else if constexpr(is_c<T>) return LAPACKE_cgees(LAPACK_COL_MAJOR, 'V', 'N', nullptr, n, cast(a), lda, &sdim, cast(w), cast(vs), ldvs);
+        else if constexpr(is_z<T>) return LAPACKE_zgees(LAPACK_COL_MAJOR, 'V', 'N', nullptr, n, cast(a), lda, &sdim, cast(w), cast(vs), ldvs);
+        else unreachable_constexpr_if();
+    }
+    //== reorder the Schur form so the selected eigenvalues lead, m returns the size of the leading block
+    template<class T> inline lapack_int trsen(const lapack_logical* select, lapack_int n, T* t, lapack_int ldt, T* q, lapack_int ldq, complex_t<T>* w, lapack_int* m)
+    {
+        if constexpr(is_real_v<T>){
+            mkl::scratch<T> wr(n), wi(n);
+            lapack_int info = 0;
+            if constexpr(is_s<T>) info = LAPACKE_strsen(LAPACK_COL_MAJOR, 'N', 'V', select, n, t, ldt, q, ldq, wr.data(), wi.data(), m, nullptr, nullptr);
+            else                  info = LAPACKE_dtrsen(LAPACK_COL_MAJOR, 'N', 'V', select, n, t, ldt, q, ldq, wr.data(), wi.data(), m, nullptr, nullptr);
+            for(lapack_int i = 0; i < n; i++) w[i] = complex_t<T>(wr[i], wi[i]);
+            return info;
+        }
+        else if constexpr(is_c<T>) return LAPACKE_ctrsen(LAPACK_COL_MAJOR, 'N', 'V', select, n, cast(t), ldt, cast(q), ldq, cast(w), m, nullptr, nullptr);
+        else if constexpr(is_z<T>) return LAPACKE_ztrsen(LAPACK_COL_MAJOR, 'N', 'V', select, n, cast(t), ldt, cast(q), ldq, cast(w), m, nullptr, nullptr);
+        else unreachable_constexpr_if();
+    }
+    //== all right eigenvectors of an upper (quasi-)triangular matrix.
+    //   real types store a complex pair as two columns (re, im) like LAPACK does.
+    template<class T> inline lapack_int trevc(lapack_int n, T* t, lapack_int ldt, T* vr, lapack_int ldvr)
+    {
+        lapack_int m = 0;
+        if constexpr(is_s<T>)      return LAPACKE_strevc(LAPACK_COL_MAJOR, 'R', 'A', nullptr, n, t, ldt, nullptr, 1, vr, ldvr, n, &m);
+        else if constexpr(is_d<T>) return LAPACKE_dtrevc(LAPACK_COL_MAJOR, 'R', 'A', nullptr, n, t, ldt, nullptr, 1, vr, ldvr, n, &m);
+        else if constexpr(is_c<T>) return LAPACKE_ctrevc(LAPACK_COL_MAJOR, 'R', 'A', nullptr, n, cast(t), ldt, nullptr, 1, cast(vr), ldvr, n, &m);
+        else if constexpr(is_z<T>) return LAPACKE_ztrevc(LAPACK_COL_MAJOR, 'R', 'A', nullptr, n, cast(t), ldt, nullptr, 1, cast(vr), ldvr, n, &m);
+        else unreachable_constexpr_if();
+    }
+    //== symmetric / hermitian eigen decomposition (upper triangle), ascending eigenvalues
+    template<class T> inline lapack_int heev(char jobz, lapack_int n, T* a, lapack_int lda, real_t<T>* w)
+    {
+        if constexpr(is_s<T>)      return LAPACKE_ssyev(LAPACK_COL_MAJOR, jobz, 'U', n, a, lda, w);
+        else if constexpr(is_d<T>) return LAPACKE_dsyev(LAPACK_COL_MAJOR, jobz, 'U', n, a, lda, w);
+        else if constexpr(is_c<T>) return LAPACKE_cheev(LAPACK_COL_MAJOR, jobz, 'U', n, cast(a), lda, w);
+        else if constexpr(is_z<T>) return LAPACKE_zheev(LAPACK_COL_MAJOR, jobz, 'U', n, cast(a), lda, w);
+        else unreachable_constexpr_if();
+    }
+    template<class T> inline lapack_int geqrf(lapack_int m, lapack_int n, T* a, lapack_int lda, T* tau)
+    {
+        if constexpr(is_s<T>)      return LAPACKE_sgeqrf(LAPACK_COL_MAJOR, m, n, a, lda, tau);
+        else if constexpr(is_d<T>) return LAPACKE_dgeqrf(LAPACK_COL_MAJOR, m, n, a, lda, tau);
+        else if constexpr(is_c<T>) return LAPACKE_cgeqrf(LAPACK_COL_MAJOR, m, n, cast(a), lda, cast(tau));
+        else if constexpr(is_z<T>) return LAPACKE_zgeqrf(LAPACK_COL_MAJOR, m, n, cast(a), lda, cast(tau));
+        else unreachable_constexpr_if();
+    }
+    //== explicit Q of geqrf (orgqr / ungqr)
+    template<class T> inline lapack_int ungqr(lapack_int m, lapack_int n, lapack_int k, T* a, lapack_int lda, const T* tau)
+    {
+        if constexpr(is_s<T>)      return LAPACKE_sorgqr(LAPACK_COL_MAJOR, m, n, k, a, lda, tau);
+        else if constexpr(is_d<T>) return LAPACKE_dorgqr(LAPACK_COL_MAJOR, m, n, k, a, lda, tau);
+        else if constexpr(is_c<T>) return LAPACKE_cungqr(LAPACK_COL_MAJOR, m, n, k, cast(a), lda, cast(tau));
+        else if constexpr(is_z<T>) return LAPACKE_zungqr(LAPACK_COL_MAJOR, m, n, k, cast(a), lda, cast(tau));
+        else unreachable_constexpr_if();
+    }
+    template<class T> inline lapack_int gesvd(char jobu, char jobvt, lapack_int m, lapack_int n, T* a, lapack_int lda,
+        real_t<T>* s, T* u, lapack_int ldu, T* vt, lapack_int ldvt)
+    {
+        mkl::scratch<real_t<T>> superb(std::max<lapack_int>(1, std::min(m, n)));
+        if constexpr(is_s<T>)      return LAPACKE_sgesvd(LAPACK_COL_MAJOR, jobu, jobvt, m, n, a, lda, s, u, ldu, vt, ldvt, superb.data());
+        else if constexpr(is_d<T>) return LAPACKE_dgesvd(LAPACK_COL_MAJOR, jobu, jobvt, m, n, a, lda, s, u, ldu, vt, ldvt, superb.data());
+        else if constexpr(is_c<T>) return LAPACKE_cgesvd(LAPACK_COL_MAJOR, jobu, jobvt, m, n, cast(a), lda, s, cast(u), ldu, cast(vt), ldvt, superb.data());
+        else if constexpr(is_z<T>) return LAPACKE_zgesvd(LAPACK_COL_MAJOR, jobu, jobvt, m, n, cast(a), lda, s, cast(u), ldu, cast(vt), ldvt, superb.data());
+        else unreachable_constexpr_if();
+    }
+    template<class T> inline lapack_int potrf(char uplo, lapack_int n, T* a, lapack_int lda)
+    {
+        if constexpr(is_s<T>)      return LAPACKE_spotrf(LAPACK_COL_MAJOR, uplo, n, a, lda);
+        else if constexpr(is_d<T>) return LAPACKE_dpotrf(LAPACK_COL_MAJOR, uplo, n, a, lda);
+        else if constexpr(is_c<T>) return LAPACKE_cpotrf(LAPACK_COL_MAJOR, uplo, n, cast(a), lda);
+        else if constexpr(is_z<T>) return LAPACKE_zpotrf(LAPACK_COL_MAJOR, uplo, n, cast(a), lda);
+        else unreachable_constexpr_if();
+    }
+}
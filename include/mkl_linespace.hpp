@@ -1,20 +1,22 @@
 #pragma once
 #include "mkl_basic_operator.h"
 #include "mkl_reshape.hpp"
+#include "mkl_parallel.hpp"
+#include "mkl_arena.hpp"
 
 namespace mkl
 {
     template<class T> void linespace(T*p, size_t num, real_t<T> start, real_t<T> step) 
     {
         if constexpr(is_real_v<T>){
-            std::vector<T> idx(num);
+            mkl::scratch<T> idx(num);
             std::iota(idx.begin(), idx.end(), T(0));
             VEC_REPEAT_CODE(T, LinearFrac,static_cast<MKL_INT>(num),
                     idx.data(), idx.data(), 
                     T(step), T(start), T(0), T(1), p);
         }
         else{
-            std::vector<real_t<T>> buf(num);
+            mkl::scratch<real_t<T>> buf(num);
             linespace<real_t<T>>(buf.data(), num, start, step);
             for(auto n : buf) {
                 *p = n; p++;
@@ -24,15 +26,15 @@ namespace mkl
     }
 
     template<class T, size_t N=2> void linespace_nd(T* p/* p should be equal or larger than sum(num) */, 
-        vec<size_t, N> num, vec<real_t<T>, N> start, vec<real_t<T>, N> step) 
+        ::vec<size_t, N> num, ::vec<real_t<T>, N> start, ::vec<real_t<T>, N> step) 
     {
         for(size_t i = 0; i < N; i++){
             linespace(p, num[i], start[i], step[i]);
             p += num.at(i);
         }
     }
-    template <size_t N> vec<size_t, N> prefix_product(const vec<size_t, N>& shape) {
-        vec<size_t, N> pref;
+    template <size_t N> ::vec<size_t, N> prefix_product(const ::vec<size_t, N>& shape) {
+        ::vec<size_t, N> pref;
         size_t cur = 1;
         for (size_t i = 0; i < N; ++i) {
             pref[i] = cur;
@@ -40,54 +42,152 @@ namespace mkl
         }
         return pref;
     }
-    template<class TVec, size_t N=2> void meshgrid_nd(TVec* pVec/* p should be equal or larger than product(num) */, 
-        vec<size_t, N> num, vec<real_t<TVec>, N> start, vec<real_t<TVec>, N> step) 
+    //== lazy N-d grid, axis 0 is the fastest one (same order as meshgrid_nd).
+    //   coordinate(d, i) = start[d] + step[d] * ((i < wrap[d] ? i : i - num[d]) - origin[d])
+    //   wrap[d] == num[d] gives a plain linear axis, wrap[d] < num[d] gives the unshifted fft ordering,
+    //   origin keeps the integer part of a shifted axis exact.
+    //   fused kernels can evaluate coordinates on the fly instead of materializing N*product(num) values.
+    template<class T, size_t N> struct grid_nd
     {
-        using T = real_t<TVec>;
-        T* p = reinterpret_cast<T*>(pVec);
-        if constexpr(N == 1){
-            linespace(p, num.front(), start.front(), step.front());
-            return;
+        ::vec<size_t, N> num;
+        ::vec<T, N> start;
+        ::vec<T, N> step;
+        ::vec<size_t, N> wrap;
+        ::vec<long long, N> origin;
+
+        size_t size() const {return product(num);}
+        T coordinate(size_t axis, size_t i) const
+        {
+            const long long k = i < wrap[axis] ? static_cast<long long>(i) : static_cast<long long>(i) - static_cast<long long>(num[axis]);
+            return start[axis] + step[axis] * T(k - origin[axis]);
         }
-        else{
-            std::vector<T> lines(sum(num));
-            linespace_nd(lines.data(), num, start, step);
+        ::vec<T, N> operator()(const ::vec<size_t, N>& idx) const
+        {
+            ::vec<T, N> coord;
+            for(size_t d = 0; d < N; d++) coord[d] = coordinate(d, idx[d]);
+            return coord;
+        }
+        ::vec<size_t, N> unravel(size_t linear) const
+        {
+            ::vec<size_t, N> idx;
+            for(size_t d = 0; d < N; d++){
+                idx[d] = linear % num[d];
+                linear /= num[d];
+            }
+            return idx;
+        }
+        ::vec<T, N> at(size_t linear) const {return (*this)(unravel(linear));}
 
-            std::array<const T*, N> axis_ptrs;
+        //== f(row, idx_of_row_start, coord_of_row_start) for every run along axis 0,
+        //   rows are distributed over threads, the index is advanced like an odometer inside a thread.
+        template<class F> void for_each_row(F f) const
+        {
+            const size_t rows = num[0] ? size() / num[0] : 0;
+            const int nthreads = mkl::loop_threads(size() * N);
+            #pragma omp parallel num_threads(nthreads) if(nthreads > 1)
             {
-                size_t axis_offset = 0;
-                for (size_t d = 0; d < N; ++d) {
-                    axis_ptrs[d] = lines.data() + axis_offset;
-                    axis_offset += num[d];
+                size_t nt = 1, tid = 0;
+#ifdef _OPENMP
+                nt = size_t(omp_get_num_threads());
+                tid = size_t(omp_get_thread_num());
+#endif
+                const size_t chunk = (rows + nt - 1) / nt;
+                const size_t r0 = std::min(rows, tid * chunk);
+                const size_t r1 = std::min(rows, r0 + chunk);
+                if(r0 < r1){
+                    ::vec<size_t, N> idx = unravel(r0 * num[0]);
+                    ::vec<T, N> coord = (*this)(idx);
+                    for(size_t r = r0; r < r1; r++){
+                        f(r, idx, coord);
+                        for(size_t d = 1; d < N; d++){
+                            if(++idx[d] < num[d]){
+                                coord[d] = coordinate(d, idx[d]);
+                                break;
+                            }
+                            idx[d] = 0;
+                            coord[d] = coordinate(d, 0);
+                        }
+                    }
                 }
             }
-
-            vec<size_t, N> idx{};
-            size_t total = product(num);
-            for (size_t linear = 0; linear < total; ++linear) {
-                size_t t = linear;
-                for (int d = 0; d < N; d++) {
-                    idx[d] = t % num[d];
-                    t /= num[d];
+        }
+        //== f(linear, coord) for every grid point
+        template<class F> void for_each(F f) const
+        {
+            for_each_row([&](size_t row, const ::vec<size_t, N>&, ::vec<T, N> coord){
+                const size_t base = row * num[0];
+                for(size_t x = 0; x < num[0]; x++){
+                    coord[0] = coordinate(0, x);
+                    f(base + x, coord);
                 }
+            });
+        }
+    };
+    template<class T, size_t N> grid_nd<T, N> make_grid(::vec<size_t, N> num, ::vec<T, N> start, ::vec<T, N> step)
+    {
+        return grid_nd<T, N>{num, start, step, num, ::vec<long long, N>{}};
+    }
+    //== frequency grid of an fft with sample pitch `pitch` (numpy.fft.fftfreq per axis, times `scale`).
+    //   shifted = true matches fftshift : index i holds frequency (i - num/2) / (num * pitch).
+    template<class T, size_t N> grid_nd<T, N> make_kspace_grid(::vec<size_t, N> num, ::vec<T, N> pitch, bool shifted = true, T scale = 1)
+    {
+        grid_nd<T, N> grid;
+        grid.num = num;
+        for(size_t d = 0; d < N; d++){
+            grid.step[d]   = scale / (T(num[d]) * pitch[d]);
+            grid.start[d]  = T(0);
+            grid.wrap[d]   = shifted ? num[d] : (num[d] + 1) / 2;
+            grid.origin[d] = shifted ? static_cast<long long>(num[d] / 2) : 0;
+        }
+        return grid;
+    }
 
-                for (size_t d = 0; d < N; ++d) {
-                    *p++ = axis_ptrs[d][idx[d]];
+    //== write the interleaved coordinates of `grid` to p : p[linear * N + d]
+    template<class TVec, size_t N> void materialize(TVec* pVec, const grid_nd<real_t<TVec>, N>& grid)
+    {
+        using T = real_t<TVec>;
+        static_assert(sizeof(TVec) == N * sizeof(T) || sizeof(TVec) == sizeof(T));
+        T* p = reinterpret_cast<T*>(pVec);
+        const size_t xsize = grid.num[0];
+        if(0 == xsize) return;
+        //== axis 0 is the same for every row: evaluate it once, then each row is
+        //   a strided copy of it plus a broadcast of the row constants.
+        mkl::scratch<T> axis0(xsize);
+        for(size_t x = 0; x < xsize; x++) axis0[x] = grid.coordinate(0, x);
+        grid.for_each_row([&](size_t row, const ::vec<size_t, N>&, const ::vec<T, N>& coord){
+            T* q = p + row * xsize * N;
+            if constexpr(N == 1){
+                std::copy(axis0.begin(), axis0.end(), q);
+            }
+            else{
+                for(size_t x = 0; x < xsize; x++, q += N){
+                    q[0] = axis0[x];
+                    for(size_t d = 1; d < N; d++) q[d] = coord[d];
                 }
             }
+        });
+    }
+
+    template<class TVec, size_t N=2> void meshgrid_nd(TVec* pVec/* p should be equal or larger than product(num) */, 
+        ::vec<size_t, N> num, ::vec<real_t<TVec>, N> start, ::vec<real_t<TVec>, N> step) 
+    {
+        using T = real_t<TVec>;
+        if constexpr(N == 1){
+            linespace(reinterpret_cast<T*>(pVec), num.front(), start.front(), step.front());
+        }
+        else{
+            materialize(pVec, make_grid<T, N>(num, start, step));
         }
     }
-//     template<class T, size_t N = 2> void kspace(T* p, vec<size_t, N> num, vec<real_t<T>, N> start, vec<real_t<T>, N> step, real_t<T> n = 1)
-//     {
-//         vec<real_t<T>, N> pitch = step * num;
-        
-//         if constexpr(is_real_v<T>){
-//             meshgrid_nd<T>(p, num, start, step);
-//         }
-//         else{
-//             static_assert(sizeof(T) == sizeof(real_t<T>) * N);
-//             using vT = typename T::value_type;
-//             meshgrid_nd<vT>(reinterpret_cast<vT*>(p), num, start, step);
-//         }
-//     }
-}
\ No newline at end of file
+    //== 1d fft frequencies, see make_kspace_grid
+    template<class T> void fftfreq(T* p, size_t num, T pitch = 1, bool shifted = false)
+    {
+        materialize(p, make_kspace_grid<T, 1>({num}, {pitch}, shifted));
+    }
+    //== N-d k-space grid with the layout of meshgrid_nd. TVec may also be complex<T> for 2d (kx + i*ky).
+    template<class TVec, size_t N = 2> void kspace(TVec* p, ::vec<size_t, N> num, ::vec<real_t<TVec>, N> pitch, bool shifted = true, real_t<TVec> scale = 1)
+    {
+        static_assert(N == 1 || sizeof(TVec) == sizeof(real_t<TVec>) * N);
+        materialize(p, make_kspace_grid<real_t<TVec>, N>(num, pitch, shifted, scale));
+    }
+}
@@ -0,0 +1,215 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_intergral.hpp"
+
+namespace mkl
+{
+    //== summed-area tables of float images lose precision quickly when accumulated in float,
+    //   so the tables below are always kept in (at least) double.
+    template<class T> struct accumulate_type
+    {
+        using type = std::conditional_t<is_complex_v<T>, std::complex<double>, double>;
+    };
+    template<class T> using accumulate_t = typename accumulate_type<T>::type;
+
+    //== integral image with a zero guard row/column : sat(y, x) = sum(image[0:y, 0:x]).
+    //   every box sum is answered in O(1) with 4 lookups.
+    //   compensated = true keeps a Kahan error term for the row and the column accumulation,
+    //   which matters when TAcc has the same width as the input (double images).
+    template<class T, class TAcc = accumulate_t<T>>
+    class integral_image
+    {
+    public:
+        using value_type = T;
+        using accumulate_type = TAcc;
+
+        integral_image(vec2<size_t> shape, const T* image, bool with_squares = is_real_v<T>, bool compensated = false)
+            : ysize_(shape[0]), xsize_(shape[1]), stride_(shape[1] + 1), with_squares_(with_squares)
+        {
+            static_assert(is_real_v<TAcc> || is_complex_v<TAcc>);
+            sat_.assign((ysize_ + 1) * stride_, TAcc(0));
+            build(image, sat_.data(), [](T v){ return TAcc(v); }, compensated);
+            if(with_squares_){
+                sat_sq_.assign((ysize_ + 1) * stride_, TAcc(0));
+                build(image, sat_sq_.data(), [](T v){ return TAcc(std::norm(v)); }, compensated);
+            }
+        }
+        vec2<size_t> shape() const {return {ysize_, xsize_};}
+        const TAcc* data() const {return sat_.data();}
+        const TAcc* data_squares() const {return sat_sq_.data();}
+        size_t stride() const {return stride_;}
+
+        //== half-open box [y0, y1) x [x0, x1)
+        TAcc box_sum(size_t y0, size_t x0, size_t y1, size_t x1) const
+        {
+            return corner_sum(sat_.data(), y0, x0, y1, x1);
+        }
+        TAcc box_sum_squares(size_t y0, size_t x0, size_t y1, size_t x1) const
+        {
+            assert(with_squares_);
+            return corner_sum(sat_sq_.data(), y0, x0, y1, x1);
+        }
+
+        //== centered (2*ry+1) x (2*rx+1) window, clipped at the image border.
+        //   out has the shape of the image.
+        template<class TOut> void box_sum(vec2<size_t> radius, TOut* out) const
+        {
+            centered_op(radius, out, [](const TAcc& s, const TAcc&, real_t<TAcc>){ return s; }, false);
+        }
+        template<class TOut> void box_mean(vec2<size_t> radius, TOut* out) const
+        {
+            centered_op(radius, out, [](const TAcc& s, const TAcc&, real_t<TAcc> inv_n){ return s * inv_n; }, false);
+        }
+        //== population variance E[|x|^2] - |E[x]|^2 in the window
+        template<class TOut> void box_variance(vec2<size_t> radius, TOut* out) const
+        {
+            assert(with_squares_);
+            centered_op(radius, out, [](const TAcc& s, const TAcc& sq, real_t<TAcc> inv_n){
+                const real_t<TAcc> mean_sq = std::norm(s * inv_n);
+                return std::max(real_t<TAcc>(0), std::real(sq) * inv_n - mean_sq);
+            }, true);
+        }
+        template<class TOut> void box_std(vec2<size_t> radius, TOut* out) const
+        {
+            assert(with_squares_);
+            centered_op(radius, out, [](const TAcc& s, const TAcc& sq, real_t<TAcc> inv_n){
+                const real_t<TAcc> mean_sq = std::norm(s * inv_n);
+                return std::sqrt(std::max(real_t<TAcc>(0), std::real(sq) * inv_n - mean_sq));
+            }, true);
+        }
+
+        //== denominator of the normalized cross correlation with a (wy, wx) template, "valid" mode:
+        //   out(y, x) = sqrt(sum(|I - mean(I)|^2)) over image[y:y+wy, x:x+wx],
+        //   out shape is (ysize - wy + 1, xsize - wx + 1).
+        template<class TOut> void ncc_denominator(vec2<size_t> window, TOut* out) const
+        {
+            assert(with_squares_);
+            const auto [wy, wx] = window;
+            assert(0 < wy && wy <= ysize_ && 0 < wx && wx <= xsize_);
+            const size_t out_y = ysize_ - wy + 1;
+            const size_t out_x = xsize_ - wx + 1;
+            const real_t<TAcc> inv_n = real_t<TAcc>(1) / real_t<TAcc>(wy * wx);
+            const TAcc* S  = sat_.data();
+            const TAcc* SQ = sat_sq_.data();
+            const int nthreads = mkl::loop_threads(out_y * out_x);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long y = 0; y < static_cast<long long>(out_y); y++){
+                const TAcc* s0  = S  + size_t(y) * stride_;
+                const TAcc* s1  = S  + (size_t(y) + wy) * stride_;
+                const TAcc* q0  = SQ + size_t(y) * stride_;
+                const TAcc* q1  = SQ + (size_t(y) + wy) * stride_;
+                TOut* o = out + size_t(y) * out_x;
+                #pragma omp simd
+                for(size_t x = 0; x < out_x; x++){
+                    const TAcc s  = s1[x + wx] - s1[x] - s0[x + wx] + s0[x];
+                    const TAcc sq = q1[x + wx] - q1[x] - q0[x + wx] + q0[x];
+                    o[x] = TOut(std::sqrt(std::max(real_t<TAcc>(0), std::real(sq) - std::norm(s) * inv_n)));
+                }
+            }
+        }
+
+    private:
+        TAcc corner_sum(const TAcc* S, size_t y0, size_t x0, size_t y1, size_t x1) const
+        {
+            assert(y0 <= y1 && y1 <= ysize_ && x0 <= x1 && x1 <= xsize_);
+            return S[y1 * stride_ + x1] - S[y1 * stride_ + x0] - S[y0 * stride_ + x1] + S[y0 * stride_ + x0];
+        }
+        template<class Convert> void build(const T* image, TAcc* S, Convert convert, bool compensated)
+        {
+            //== copy into the padded table (row 0 and column 0 stay zero)
+            const int nthreads = mkl::loop_threads(ysize_ * xsize_);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long y = 0; y < static_cast<long long>(ysize_); y++){
+                const T* src = image + size_t(y) * xsize_;
+                TAcc* dst = S + (size_t(y) + 1) * stride_ + 1;
+                if(!compensated){
+                    for(size_t x = 0; x < xsize_; x++) dst[x] = convert(src[x]);
+                    continue;
+                }
+                //== Kahan row prefix-sum
+                TAcc running(0), c(0);
+                for(size_t x = 0; x < xsize_; x++){
+                    const TAcc v = convert(src[x]) - c;
+                    const TAcc t = running + v;
+                    c = (t - running) - v;
+                    running = t;
+                    dst[x] = running;
+                }
+            }
+            if(!compensated){
+                mkl::integral_xy<TAcc>({ysize_ + 1, stride_}, S);
+                return;
+            }
+            //== Kahan column accumulation over column strips
+            constexpr size_t strip = std::max<size_t>(1, integral_strip_bytes / sizeof(TAcc));
+            const long long nstrip = static_cast<long long>((stride_ + strip - 1) / strip);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long s = 0; s < nstrip; s++){
+                const size_t x0 = size_t(s) * strip;
+                const size_t w  = std::min(strip, stride_ - x0);
+                TAcc acc[strip], c[strip];
+                std::fill(acc, acc + w, TAcc(0));
+                std::fill(c, c + w, TAcc(0));
+                TAcc* p = S + x0;
+                for(size_t y = 1; y <= ysize_; y++){
+                    p += stride_;
+                    for(size_t x = 0; x < w; x++){
+                        const TAcc v = p[x] - c[x];
+                        const TAcc t = acc[x] + v;
+                        c[x] = (t - acc[x]) - v;
+                        acc[x] = t;
+                        p[x] = t;
+                    }
+                }
+            }
+        }
+        template<class TOut, class Op> void centered_op(vec2<size_t> radius, TOut* out, Op op, bool need_squares) const
+        {
+            const auto [ry, rx] = radius;
+            const TAcc* S  = sat_.data();
+            const TAcc* SQ = need_squares ? sat_sq_.data() : sat_.data();
+            const size_t xsize = xsize_;
+            const size_t stride = stride_;
+            const int nthreads = mkl::loop_threads(ysize_ * xsize_);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long yy = 0; yy < static_cast<long long>(ysize_); yy++){
+                const size_t y = size_t(yy);
+                const size_t y0 = y > ry ? y - ry : 0;
+                const size_t y1 = std::min(ysize_, y + ry + 1);
+                const TAcc* s0 = S  + y0 * stride;
+                const TAcc* s1 = S  + y1 * stride;
+                const TAcc* q0 = SQ + y0 * stride;
+                const TAcc* q1 = SQ + y1 * stride;
+                const real_t<TAcc> rows = real_t<TAcc>(y1 - y0);
+                TOut* o = out + y * xsize;
+                auto pixel = [&](size_t x0, size_t x1){
+                    const TAcc s  = s1[x1] - s1[x0] - s0[x1] + s0[x0];
+                    const TAcc sq = q1[x1] - q1[x0] - q0[x1] + q0[x0];
+                    return TOut(op(s, sq, real_t<TAcc>(1) / (rows * real_t<TAcc>(x1 - x0))));
+                };
+                //== border columns with clipped windows, interior with the full window
+                const size_t interior_begin = std::min(rx, xsize);
+                const size_t interior_end   = xsize > rx ? std::max(interior_begin, xsize - rx) : interior_begin;
+                for(size_t x = 0; x < interior_begin; x++){
+                    o[x] = pixel(0, std::min(xsize, x + rx + 1));
+                }
+                const real_t<TAcc> inv_n = real_t<TAcc>(1) / (rows * real_t<TAcc>(2 * rx + 1));
+                #pragma omp simd
+                for(size_t x = interior_begin; x < interior_end; x++){
+                    const size_t x0 = x - rx, x1 = x + rx + 1;
+                    const TAcc s  = s1[x1] - s1[x0] - s0[x1] + s0[x0];
+                    const TAcc sq = q1[x1] - q1[x0] - q0[x1] + q0[x0];
+                    o[x] = TOut(op(s, sq, inv_n));
+                }
+                for(size_t x = interior_end; x < xsize; x++){
+                    o[x] = pixel(x > rx ? x - rx : 0, xsize);
+                }
+            }
+        }
+
+        size_t ysize_, xsize_, stride_;
+        bool with_squares_;
+        std::vector<TAcc> sat_;
+        std::vector<TAcc> sat_sq_;
+    };
+}
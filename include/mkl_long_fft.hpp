@@ -0,0 +1,276 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_arena.hpp"
+#include "mkl_fft.hpp"
+#include "mkl_parallel.hpp"
+#include "mkl_trace.hpp"
+#include <cmath>
+#include <map>
+#include <optional>
+#include <tuple>
+
+//== very long complex 1D transforms (2^24 points and more) as 2D problems, n = n1 * n2 :
+//   viewed as an n1 x n2 row-major matrix, X[k1 + n1 k2] = sum_n2 w_n2^(n2 k2) w_n^(n2 k1) sum_n1 x[n1 n2 + n2] w_n1^(n1 k1).
+//
+//   four_step : strided n1-point column transforms, twiddle fused with a blocked transpose,
+//               strided n2-point column transforms. one transpose, strided FFT access.
+//   six_step  : transpose, n1-point row transforms, twiddle fused with a blocked transpose,
+//               n2-point row transforms, transpose. three transposes, unit-stride FFT access.
+//   direct    : one MKL descriptor of length n.
+//   automatic picks six_step from long_fft_threshold bytes on when n has a divisor near sqrt(n).
+//
+//   threads work on blocks of rows (columns) with a sequential batched descriptor each, the
+//   scratch is first touched by the threads that later transform it so it spreads across NUMA nodes
+//   (with pin_threads in the execution policy). inverse transforms are normalized by 1/n, the scale
+//   is folded into the twiddles. one object per thread : it owns its scratch.
+namespace mekil
+{
+    enum class long_fft_algorithm
+    {
+        automatic,
+        direct,
+        four_step,
+        six_step,
+    };
+    inline const char* long_fft_algorithm_name(long_fft_algorithm a)
+    {
+        switch(a){
+            case long_fft_algorithm::automatic: return "automatic";
+            case long_fft_algorithm::direct:    return "direct";
+            case long_fft_algorithm::four_step: return "four_step";
+            case long_fft_algorithm::six_step:  return "six_step";
+        }
+        return "unknown";
+    }
+    //== bytes of data from which automatic leaves the direct transform (about a last-level cache)
+    inline size_t& long_fft_threshold()
+    {
+        static size_t bytes = size_t(32) << 20;
+        return bytes;
+    }
+
+    template<class T> class long_fft
+    {
+    public:
+        static_assert(is_complex_v<T>, "long_fft is complex to complex");
+        using plan_t = fft_plan<T>;
+        using real_type = real_t<T>;
+
+        //== divisor of n closest to sqrt(n) from below, 1 for primes
+        static size_t split(size_t n)
+        {
+            for(size_t d = size_t(std::sqrt(double(n))); d > 1; d--) if(0 == n % d) return d;
+            return 1;
+        }
+        static long_fft_algorithm select(size_t n)
+        {
+            const size_t n1 = split(n);
+            if(n * sizeof(T) < long_fft_threshold() || n1 < 16 || n / n1 > 64 * n1) return long_fft_algorithm::direct;
+            return long_fft_algorithm::six_step;
+        }
+
+        //== block_bytes : data per sequential batched call, about the L2 cache of one core
+        explicit long_fft(size_t n, long_fft_algorithm algorithm = long_fft_algorithm::automatic, size_t block_bytes = size_t(256) << 10)
+            : n_(n), algorithm_(long_fft_algorithm::automatic == algorithm ? select(n) : algorithm), block_bytes_(block_bytes)
+        {
+            if(0 == n_) throw std::invalid_argument("long_fft: empty transform");
+            n1_ = split(n_);
+            n2_ = n_ / n1_;
+            if(long_fft_algorithm::direct != algorithm_ && 1 == n1_) algorithm_ = long_fft_algorithm::direct;
+            if(long_fft_algorithm::direct == algorithm_) return;
+            make_twiddles();
+            scratch_.resize(n_);
+            first_touch(scratch_.data(), n2_, n1_);
+        }
+
+        size_t size() const {return n_;}
+        long_fft_algorithm algorithm() const {return algorithm_;}
+        //== n = rows() * cols() for the four- and six-step algorithms
+        size_t rows() const {return n1_;}
+        size_t cols() const {return n2_;}
+
+        //== `in` may alias `out`
+        void forward(const T* in, T* out) {execute(in, out, true);}
+        void backward(const T* in, T* out) {execute(in, out, false);}
+
+    private:
+        static constexpr size_t tile = 32;
+
+        void execute(const T* in, T* out, bool forward)
+        {
+            MEKIL_TRACE_SCOPE(forward ? "long_fft.forward" : "long_fft.backward", 2 * n_ * sizeof(T), n_, n1_, n2_);
+            switch(algorithm_){
+                case long_fft_algorithm::direct:    return direct(in, out, forward);
+                case long_fft_algorithm::four_step: return four_step(in, out, forward);
+                default:                            return six_step(in, out, forward);
+            }
+        }
+
+        void direct(const T* in, T* out, bool forward)
+        {
+            if(in == out){
+                if(!inplace_) inplace_.emplace(plan_t::row_major({MKL_LONG(n_)}, true));
+                forward ? inplace_->forward(out) : inplace_->backward(out);
+                return;
+            }
+            auto& plan = forward ? direct_forward_ : direct_backward_;
+            if(!plan) plan.emplace(plan_t::directional({MKL_LONG(n_)}, forward));
+            forward ? plan->forward(in, out) : plan->backward(in, out);
+        }
+
+        //== columns of x (n1 x n2), twiddle-transpose to (n2 x n1), columns again : natural order
+        void four_step(const T* in, T* out, bool forward)
+        {
+            T* w = scratch_.data();
+            if(in == out){
+                columns(in, w, n1_, n2_, forward);
+                transpose<true>(w, n1_, n2_, out, forward);
+                columns(out, w, n2_, n1_, forward);
+                std::copy(w, w + n_, out);
+                return;
+            }
+            columns(in, out, n1_, n2_, forward);
+            transpose<true>(out, n1_, n2_, w, forward);
+            columns(w, out, n2_, n1_, forward);
+        }
+        //== x (n1 x n2) -> (n2 x n1), rows, twiddle-transpose to (n1 x n2), rows, transpose : natural order
+        void six_step(const T* in, T* out, bool forward)
+        {
+            T* w = scratch_.data();
+            const T* src = in;
+            if(in == out){
+                std::copy(in, in + n_, w);
+                transpose<false>(w, n1_, n2_, out, forward);
+                rows(out, n2_, n1_, forward);
+                transpose<true>(out, n2_, n1_, w, forward);
+                rows(w, n1_, n2_, forward);
+                transpose<false>(w, n1_, n2_, out, forward);
+                return;
+            }
+            transpose<false>(src, n1_, n2_, out, forward);
+            rows(out, n2_, n1_, forward);
+            transpose<true>(out, n2_, n1_, w, forward);
+            rows(w, n1_, n2_, forward);
+            transpose<false>(w, n1_, n2_, out, forward);
+        }
+
+        //== in-place transforms of `count` rows of `length` points
+        void rows(T* data, size_t count, size_t length, bool forward)
+        {
+            const size_t block = std::clamp<size_t>(block_bytes_ / (length * sizeof(T)), 1, count);
+            const size_t blocks = (count + block - 1) / block;
+            const int nthreads = blocks > 1 ? mkl::loop_threads(count * length) : 1;
+            if(1 == nthreads){
+                const plan_t& p = row_plan(length, count);
+                forward ? p.forward(data) : p.backward(data);
+                return;
+            }
+            const plan_t& full = row_plan(length, block);
+            const plan_t& rest = row_plan(length, count - (blocks - 1) * block);
+            #pragma omp parallel for schedule(static) num_threads(nthreads)
+            for(long long b = 0; b < (long long)blocks; b++){
+                const plan_t& p = size_t(b) + 1 == blocks ? rest : full;
+                T* x = data + b * block * length;
+                forward ? p.forward(x) : p.backward(x);
+            }
+        }
+        //== out (length x count) = transforms of the `count` columns of in (length x count)
+        void columns(const T* in, T* out, size_t length, size_t count, bool forward)
+        {
+            const size_t block = std::clamp<size_t>(block_bytes_ / (length * sizeof(T)), 1, count);
+            const size_t blocks = (count + block - 1) / block;
+            const int nthreads = blocks > 1 ? mkl::loop_threads(count * length) : 1;
+            if(1 == nthreads){
+                const plan_t& p = column_plan(length, count, count, forward);
+                forward ? p.forward(in, out) : p.backward(in, out);
+                return;
+            }
+            const plan_t& full = column_plan(length, count, block, forward);
+            const plan_t& rest = column_plan(length, count, count - (blocks - 1) * block, forward);
+            #pragma omp parallel for schedule(static) num_threads(nthreads)
+            for(long long b = 0; b < (long long)blocks; b++){
+                const plan_t& p = size_t(b) + 1 == blocks ? rest : full;
+                const size_t c0 = b * block;
+                forward ? p.forward(in + c0, out + c0) : p.backward(in + c0, out + c0);
+            }
+        }
+        //== dst (cols x rows) = src (rows x cols)^T, times w_n^(r c) when twiddled.
+        //   threads own strips of destination rows, the rows they transform next.
+        template<bool twiddled> void transpose(const T* src, size_t rows, size_t cols, T* dst, bool forward) const
+        {
+            const size_t strips = (cols + tile - 1) / tile;
+            const int nthreads = mkl::loop_threads(rows * cols);
+            const real_type scale = forward ? real_type(1) : real_type(1) / real_type(n_);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long s = 0; s < (long long)strips; s++){
+                const size_t c0 = s * tile, c1 = std::min(cols, c0 + tile);
+                for(size_t r0 = 0; r0 < rows; r0 += tile){
+                    const size_t r1 = std::min(rows, r0 + tile);
+                    for(size_t c = c0; c < c1; c++){
+                        T* d = dst + c * rows;
+                        if constexpr(twiddled){
+                            size_t e = (c * r0) % n_;
+                            for(size_t r = r0; r < r1; r++){
+                                const T w = coarse_[e >> shift_] * fine_[e & mask_];
+                                d[r] = src[r * cols + c] * (forward ? w : std::conj(w) * scale);
+                                e += c;
+                                if(e >= n_) e -= n_;
+                            }
+                        }
+                        else{
+                            for(size_t r = r0; r < r1; r++) d[r] = src[r * cols + c];
+                        }
+                    }
+                }
+            }
+        }
+        //== w_n^e = coarse[e >> shift] * fine[e & mask], both tables about sqrt(n) long, built in double
+        void make_twiddles()
+        {
+            shift_ = 0;
+            while((size_t(1) << (2 * shift_)) < n_) shift_++;
+            mask_ = (size_t(1) << shift_) - 1;
+            fine_.resize(mask_ + 1);
+            coarse_.resize((n_ >> shift_) + 1);
+            const double step = -2 * M_PI / double(n_);
+            for(size_t r = 0; r < fine_.size(); r++) fine_[r] = T(std::cos(step * double(r)), std::sin(step * double(r)));
+            for(size_t q = 0; q < coarse_.size(); q++){
+                const double a = step * double((q << shift_) % n_);
+                coarse_[q] = T(std::cos(a), std::sin(a));
+            }
+        }
+        //== touch the scratch with the partition of the passes that fill it
+        void first_touch(T* data, size_t count, size_t length)
+        {
+            const int nthreads = mkl::loop_threads(count * length);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long r = 0; r < (long long)count; r++) std::fill(data + r * length, data + (r + 1) * length, T(0));
+        }
+
+        const plan_t& row_plan(size_t length, size_t batch)
+        {
+            const auto key = std::make_tuple(length, batch, size_t(0), true);
+            auto it = plans_.find(key);
+            if(it == plans_.end()) it = plans_.emplace(key, plan_t::row_major({MKL_LONG(length)}, true, 1, int(batch))).first;
+            return it->second;
+        }
+        const plan_t& column_plan(size_t length, size_t stride, size_t batch, bool forward)
+        {
+            const auto key = std::make_tuple(length, batch, stride, forward);
+            auto it = plans_.find(key);
+            if(it == plans_.end()){
+                const std::vector<MKL_LONG> strides{0, MKL_LONG(stride)};
+                it = plans_.emplace(key, plan_t::strided({MKL_LONG(length)}, forward, strides, 1, strides, 1, int(batch), 1)).first;
+            }
+            return it->second;
+        }
+
+        size_t n_, n1_ = 1, n2_ = 1;
+        long_fft_algorithm algorithm_;
+        size_t block_bytes_;
+        size_t shift_ = 0, mask_ = 0;
+        mkl::aligned_vector<T> fine_, coarse_, scratch_;
+        std::map<std::tuple<size_t, size_t, size_t, bool>, plan_t> plans_;
+        std::optional<plan_t> inplace_, direct_forward_, direct_backward_;
+    };
+}
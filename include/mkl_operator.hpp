@@ -0,0 +1,206 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_blas.hpp"
+#include <stdexcept>
+
+//== linear operators y = A x for the iterative solvers (mkl_krylov.hpp).
+//   every operator exposes value_type, rows(), cols(), apply(x, y) and operator()(x, y),
+//   so the solvers only ever see products and A is never formed.
+//   vectors are contiguous, blocks of vectors are column-major.
+namespace mkl
+{
+    inline void check_sparse(sparse_status_t status, const char* what)
+    {
+        if(SPARSE_STATUS_SUCCESS != status) throw std::runtime_error(std::string("mkl sparse: ") + what + " failed with status " + std::to_string(int(status)));
+    }
+    inline matrix_descr general_descr()
+    {
+        matrix_descr descr;
+        descr.type = SPARSE_MATRIX_TYPE_GENERAL;
+        descr.mode = SPARSE_FILL_MODE_FULL;
+        descr.diag = SPARSE_DIAG_NON_UNIT;
+        return descr;
+    }
+    //== only the `mode` triangle of the stored matrix is read, the other one is implied
+    template<class T> matrix_descr hermitian_descr(sparse_fill_mode_t mode = SPARSE_FILL_MODE_UPPER)
+    {
+        matrix_descr descr;
+        descr.type = is_complex_v<T> ? SPARSE_MATRIX_TYPE_HERMITIAN : SPARSE_MATRIX_TYPE_SYMMETRIC;
+        descr.mode = mode;
+        descr.diag = SPARSE_DIAG_NON_UNIT;
+        return descr;
+    }
+
+    //== dense matrix, not owned
+    template<class T> class dense_operator
+    {
+    public:
+        using value_type = T;
+        dense_operator(size_t rows, size_t cols, const T* A, size_t ld, CBLAS_LAYOUT layout = CblasColMajor)
+            : rows_(rows), cols_(cols), A_(A), ld_(ld), layout_(layout) {}
+        size_t rows() const {return rows_;}
+        size_t cols() const {return cols_;}
+        void apply(const T* x, T* y, T alpha = T(1), T beta = T(0)) const
+        {
+            //== a row-major matrix is the transpose of a column-major one with the same ld
+            if(CblasColMajor == layout_) blas::gemv<T>(CblasNoTrans, rows_, cols_, alpha, A_, ld_, x, 1, beta, y, 1);
+            else                         blas::gemv<T>(CblasTrans,   cols_, rows_, alpha, A_, ld_, x, 1, beta, y, 1);
+        }
+        //== Y[:, 0:ncol] = A X[:, 0:ncol]
+        void apply_block(const T* X, size_t ncol, size_t ldx, T* Y, size_t ldy, T alpha = T(1), T beta = T(0)) const
+        {
+            if(CblasColMajor == layout_) blas::gemm<T>(CblasNoTrans, CblasNoTrans, rows_, ncol, cols_, alpha, A_, ld_, X, ldx, beta, Y, ldy);
+            else                         blas::gemm<T>(CblasTrans,   CblasNoTrans, rows_, ncol, cols_, alpha, A_, ld_, X, ldx, beta, Y, ldy);
+        }
+        void operator()(const T* x, T* y) const {apply(x, y);}
+
+    private:
+        size_t rows_, cols_;
+        const T* A_;
+        size_t ld_;
+        CBLAS_LAYOUT layout_;
+    };
+
+    //== CSR / BSR matrix through the MKL inspector-executor sparse BLAS.
+    //   the index and value arrays are not copied and must outlive the operator.
+    //   expected_calls is forwarded to mkl_sparse_set_mv_hint before mkl_sparse_optimize,
+    //   an eigensolve typically needs a few hundred products.
+    template<class T> class sparse_operator
+    {
+    public:
+        using value_type = T;
+
+        static sparse_operator csr(MKL_INT rows, MKL_INT cols, const MKL_INT* row_ptr, const MKL_INT* col_idx, const T* values,
+            matrix_descr descr = general_descr(), MKL_INT expected_calls = 1000, sparse_index_base_t base = SPARSE_INDEX_BASE_ZERO)
+        {
+            sparse_operator op(rows, cols, descr);
+            auto rs = const_cast<MKL_INT*>(row_ptr);
+            auto ci = const_cast<MKL_INT*>(col_idx);
+            auto v  = const_cast<mkl_t<T>*>(reinterpret_cast<const mkl_t<T>*>(values));
+            if constexpr(is_s<T>)      check_sparse(mkl_sparse_s_create_csr(&op.handle_, base, rows, cols, rs, rs + 1, ci, v), "create_csr");
+            else if constexpr(is_d<T>) check_sparse(mkl_sparse_d_create_csr(&op.handle_, base, rows, cols, rs, rs + 1, ci, v), "create_csr");
+            else if constexpr(is_c<T>) check_sparse(mkl_sparse_c_create_csr(&op.handle_, base, rows, cols, rs, rs + 1, ci, v), "create_csr");
+            else if constexpr(is_z<T>) check_sparse(mkl_sparse_z_create_csr(&op.handle_, base, rows, cols, rs, rs + 1, ci, v), "create_csr");
+            else unreachable_constexpr_if();
+            op.optimize(expected_calls);
+            return op;
+        }
+        //== block_rows x block_cols blocks of block_size x block_size values each
+        static sparse_operator bsr(MKL_INT block_rows, MKL_INT block_cols, MKL_INT block_size, const MKL_INT* row_ptr, const MKL_INT* col_idx, const T* values,
+            sparse_layout_t block_layout = SPARSE_LAYOUT_ROW_MAJOR, matrix_descr descr = general_descr(), MKL_INT expected_calls = 1000,
+            sparse_index_base_t base = SPARSE_INDEX_BASE_ZERO)
+        {
+            sparse_operator op(size_t(block_rows) * block_size, size_t(block_cols) * block_size, descr);
+            auto rs = const_cast<MKL_INT*>(row_ptr);
+            auto ci = const_cast<MKL_INT*>(col_idx);
+            auto v  = const_cast<mkl_t<T>*>(reinterpret_cast<const mkl_t<T>*>(values));
+            if constexpr(is_s<T>)      check_sparse(mkl_sparse_s_create_bsr(&op.handle_, base, block_layout, block_rows, block_cols, block_size, rs, rs + 1, ci, v), "create_bsr");
+            else if constexpr(is_d<T>) check_sparse(mkl_sparse_d_create_bsr(&op.handle_, base, block_layout, block_rows, block_cols, block_size, rs, rs + 1, ci, v), "create_bsr");
+            else if constexpr(is_c<T>) check_sparse(mkl_sparse_c_create_bsr(&op.handle_, base, block_layout, block_rows, block_cols, block_size, rs, rs + 1, ci, v), "create_bsr");
+            else if constexpr(is_z<T>) check_sparse(mkl_sparse_z_create_bsr(&op.handle_, base, block_layout, block_rows, block_cols, block_size, rs, rs + 1, ci, v), "create_bsr");
+            else unreachable_constexpr_if();
+            op.optimize(expected_calls);
+            return op;
+        }
+        sparse_operator(sparse_operator&& other) noexcept
+            : rows_(other.rows_), cols_(other.cols_), descr_(other.descr_), handle_(other.handle_)
+        {
+            other.handle_ = nullptr;
+        }
+        sparse_operator& operator=(sparse_operator&& other) noexcept
+        {
+            std::swap(rows_, other.rows_);
+            std::swap(cols_, other.cols_);
+            std::swap(descr_, other.descr_);
+            std::swap(handle_, other.handle_);
+            return *this;
+        }
+        sparse_operator(const sparse_operator&) = delete;
+        sparse_operator& operator=(const sparse_operator&) = delete;
+        ~sparse_operator()
+        {
+            if(handle_) mkl_sparse_destroy(handle_);
+        }
+        size_t rows() const {return rows_;}
+        size_t cols() const {return cols_;}
+        sparse_matrix_t handle() const {return handle_;}
+
+        void apply(const T* x, T* y, T alpha = T(1), T beta = T(0)) const
+        {
+            const auto a = *reinterpret_cast<const mkl_t<T>*>(&alpha);
+            const auto b = *reinterpret_cast<const mkl_t<T>*>(&beta);
+            const auto px = reinterpret_cast<const mkl_t<T>*>(x);
+            const auto py = reinterpret_cast<mkl_t<T>*>(y);
+            constexpr auto op = SPARSE_OPERATION_NON_TRANSPOSE;
+            if constexpr(is_s<T>)      check_sparse(mkl_sparse_s_mv(op, a, handle_, descr_, px, b, py), "mv");
+            else if constexpr(is_d<T>) check_sparse(mkl_sparse_d_mv(op, a, handle_, descr_, px, b, py), "mv");
+            else if constexpr(is_c<T>) check_sparse(mkl_sparse_c_mv(op, a, handle_, descr_, px, b, py), "mv");
+            else if constexpr(is_z<T>) check_sparse(mkl_sparse_z_mv(op, a, handle_, descr_, px, b, py), "mv");
+            else unreachable_constexpr_if();
+        }
+        void apply_block(const T* X, size_t ncol, size_t ldx, T* Y, size_t ldy, T alpha = T(1), T beta = T(0)) const
+        {
+            const auto a = *reinterpret_cast<const mkl_t<T>*>(&alpha);
+            const auto b = *reinterpret_cast<const mkl_t<T>*>(&beta);
+            const auto px = reinterpret_cast<const mkl_t<T>*>(X);
+            const auto py = reinterpret_cast<mkl_t<T>*>(Y);
+            constexpr auto op = SPARSE_OPERATION_NON_TRANSPOSE;
+            constexpr auto layout = SPARSE_LAYOUT_COLUMN_MAJOR;
+            if constexpr(is_s<T>)      check_sparse(mkl_sparse_s_mm(op, a, handle_, descr_, layout, px, ncol, ldx, b, py, ldy), "mm");
+            else if constexpr(is_d<T>) check_sparse(mkl_sparse_d_mm(op, a, handle_, descr_, layout, px, ncol, ldx, b, py, ldy), "mm");
+            else if constexpr(is_c<T>) check_sparse(mkl_sparse_c_mm(op, a, handle_, descr_, layout, px, ncol, ldx, b, py, ldy), "mm");
+            else if constexpr(is_z<T>) check_sparse(mkl_sparse_z_mm(op, a, handle_, descr_, layout, px, ncol, ldx, b, py, ldy), "mm");
+            else unreachable_constexpr_if();
+        }
+        void operator()(const T* x, T* y) const {apply(x, y);}
+
+    private:
+        sparse_operator(size_t rows, size_t cols, matrix_descr descr) : rows_(rows), cols_(cols), descr_(descr) {}
+        void optimize(MKL_INT expected_calls)
+        {
+            check_sparse(mkl_sparse_set_mv_hint(handle_, SPARSE_OPERATION_NON_TRANSPOSE, descr_, expected_calls), "set_mv_hint");
+            check_sparse(mkl_sparse_set_memory_hint(handle_, SPARSE_MEMORY_AGGRESSIVE), "set_memory_hint");
+            check_sparse(mkl_sparse_optimize(handle_), "optimize");
+        }
+
+        size_t rows_, cols_;
+        matrix_descr descr_;
+        sparse_matrix_t handle_ = nullptr;
+    };
+
+    //== user callback f(const T* x, T* y), square n x n
+    template<class T, class F> class callback_operator
+    {
+    public:
+        using value_type = T;
+        callback_operator(size_t n, F f) : n_(n), f_(std::move(f)) {}
+        size_t rows() const {return n_;}
+        size_t cols() const {return n_;}
+        void apply(const T* x, T* y) const {f_(x, y);}
+        void apply_block(const T* X, size_t ncol, size_t ldx, T* Y, size_t ldy) const
+        {
+            for(size_t j = 0; j < ncol; j++) f_(X + j * ldx, Y + j * ldy);
+        }
+        void operator()(const T* x, T* y) const {apply(x, y);}
+
+    private:
+        size_t n_;
+        F f_;
+    };
+    template<class T, class F> callback_operator<T, std::decay_t<F>> make_operator(size_t n, F&& f)
+    {
+        return callback_operator<T, std::decay_t<F>>(n, std::forward<F>(f));
+    }
+
+    //== Y[:, 0:ncol] = A X[:, 0:ncol] for any operator : one blocked product when the operator
+    //   has apply_block (gemm / sparse mm), otherwise one product per column
+    template<class Op, class T, class = void> struct has_apply_block : std::false_type {};
+    template<class Op, class T> struct has_apply_block<Op, T, std::void_t<decltype(std::declval<const Op&>().apply_block(
+        std::declval<const T*>(), size_t(), size_t(), std::declval<T*>(), size_t()))>> : std::true_type {};
+
+    template<class T, class Op> void apply_block(const Op& op, const T* X, size_t ncol, size_t ldx, T* Y, size_t ldy)
+    {
+        if constexpr(has_apply_block<Op, T>::value) op.apply_block(X, ncol, ldx, Y, ldy);
+        else for(size_t j = 0; j < ncol; j++) op(X + j * ldx, Y + j * ldy);
+    }
+}
@@ -0,0 +1,330 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_arena.hpp"
+#include "mkl_fft.hpp"
+#include "mkl_io.hpp"
+#include "mkl_reshape.hpp"
+#include "mkl_trace.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+//== multi-dimensional FFT of arrays larger than RAM, on memory-mapped or file-backed storage.
+//   every pass streams the array through at most `memory_budget` bytes of buffers :
+//     - batched 1D transforms of the fastest axis, slab of rows by slab of rows,
+//     - a blocked transpose (M, n) -> (n, M) into a second file, which rotates the next axis last.
+//   after one transform and one rotation per axis the array is back in its own order.
+//   the next slab / tile is read on a second thread while the current one is transformed
+//   (set prefetch = false to read synchronously). that thread is started once per calling thread
+//   and serves every pass of every transform.
+//   intermediate results go to an unlinked scratch file as large as the data, in `scratch_directory` :
+//   the mapped_array overloads default it to the directory of the file they write, the view overloads
+//   require it (temp_directory_path() is usually a tmpfs, i.e. RAM, which is what this code avoids).
+//   arrays are packed row-major (row_pitch == width). inverse transforms are normalized by 1/N.
+namespace mkl::out_of_core
+{
+    struct options
+    {
+        size_t memory_budget = size_t(1) << 30;    // bytes of slab / tile buffers
+        bool prefetch = true;
+        std::string scratch_directory;              // empty : the output file's directory (mapped_array overloads only)
+    };
+
+    namespace detail
+    {
+        //== mapped file of `bytes` bytes with no name : it disappears with the mapping
+        inline io::mapped_file scratch_file(size_t bytes, const options& opt)
+        {
+            static std::atomic<int> counter{0};
+            if(opt.scratch_directory.empty()) throw std::invalid_argument("out_of_core: options::scratch_directory is required for array views");
+            const std::filesystem::path dir(opt.scratch_directory);
+            const std::string path = (dir / ("mekil_ooc_" + std::to_string(::getpid()) + "_" + std::to_string(counter++))).string();
+            auto f = io::mapped_file::create(path, bytes);
+            ::unlink(path.c_str());
+            return f;
+        }
+        //== opt with the scratch directory defaulted to the directory of `file`
+        inline options beside(const io::mapped_file& file, options opt)
+        {
+            if(opt.scratch_directory.empty()){
+                const auto dir = std::filesystem::path(file.path()).parent_path();
+                opt.scratch_directory = dir.empty() ? std::string(".") : dir.string();
+            }
+            return opt;
+        }
+        inline void will_need(const void* p, size_t bytes)
+        {
+            const size_t page = size_t(::sysconf(_SC_PAGESIZE));
+            const uintptr_t begin = reinterpret_cast<uintptr_t>(p) / page * page;
+            if(bytes) ::madvise(reinterpret_cast<void*>(begin), reinterpret_cast<uintptr_t>(p) + bytes - begin, MADV_WILLNEED);
+        }
+
+        //== one background thread running one job at a time : submit() hands it a job, wait() blocks
+        //   until that job is done and rethrows what it threw
+        class prefetcher
+        {
+        public:
+            prefetcher() : thread_([this]{ run(); }) {}
+            ~prefetcher()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stop_ = true;
+                }
+                cv_.notify_all();
+                thread_.join();
+            }
+            prefetcher(const prefetcher&) = delete;
+            prefetcher& operator=(const prefetcher&) = delete;
+
+            void submit(std::function<void()> job)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    job_ = std::move(job);
+                }
+                cv_.notify_all();
+            }
+            void wait()
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]{ return !job_; });
+                if(auto e = std::exchange(error_, nullptr)) std::rethrow_exception(e);
+            }
+            //== the calling thread's prefetcher, started on first use
+            static prefetcher& local()
+            {
+                thread_local prefetcher p;
+                return p;
+            }
+
+        private:
+            void run()
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                while(true){
+                    cv_.wait(lock, [this]{ return stop_ || job_; });
+                    if(!job_) return;
+                    lock.unlock();
+                    std::exception_ptr error;
+                    try{
+                        job_();
+                    }
+                    catch(...){
+                        error = std::current_exception();
+                    }
+                    lock.lock();
+                    error_ = error;
+                    job_ = nullptr;
+                    cv_.notify_all();
+                }
+            }
+
+            std::mutex mutex_;
+            std::condition_variable cv_;
+            std::function<void()> job_;
+            std::exception_ptr error_;
+            bool stop_ = false;
+            std::thread thread_;    // last : starts once the members above exist
+        };
+
+        //== load(i, slot) fills buffer `slot` with block i, work(i, slot) consumes it.
+        //   block i + 1 is loaded on the prefetch thread while block i is worked on.
+        template<class Load, class Work> void pipelined(size_t count, bool prefetch, Load&& load, Work&& work)
+        {
+            if(0 == count) return;
+            load(size_t(0), 0);
+            prefetcher* loader = prefetch && count > 1 ? &prefetcher::local() : nullptr;
+            for(size_t i = 0; i < count; i++){
+                if(i + 1 < count && loader) loader->submit([&, i]{ load(i + 1, int((i + 1) % 2)); });
+                try{
+                    work(i, int(i % 2));
+                }
+                catch(...){
+                    //== the load in flight writes the other buffer : let it finish before unwinding
+                    if(i + 1 < count && loader){
+                        try{ loader->wait(); } catch(...){}
+                    }
+                    throw;
+                }
+                if(i + 1 < count){
+                    if(loader) loader->wait();
+                    else load(i + 1, int((i + 1) % 2));
+                }
+            }
+        }
+
+        //== 1D transforms of the `rows` rows of length n, from `src` to `dst` (which may alias).
+        //   TIn / TOut pick the kind : c2c, r2c (n -> n/2+1) or c2r (n/2+1 -> n).
+        template<class TIn, class TOut> void fft_rows(const TIn* src, TOut* dst, size_t rows, size_t n, bool forward, const options& opt)
+        {
+            using spatial_type = std::conditional_t<is_real_v<TIn>, TIn, TOut>;
+            using plan_t = mekil::fft_plan<spatial_type>;
+            const size_t in_width  = is_real_v<TOut> ? n / 2 + 1 : n;
+            const size_t out_width = is_real_v<TIn>  ? n / 2 + 1 : n;
+            const size_t row_bytes = 2 * in_width * sizeof(TIn) + out_width * sizeof(TOut);
+            const size_t slab = std::clamp<size_t>(opt.memory_budget / row_bytes, 1, rows);
+            const size_t count = (rows + slab - 1) / slab;
+            MEKIL_TRACE_SCOPE("ooc.fft_rows", rows * (in_width * sizeof(TIn) + out_width * sizeof(TOut)), rows, n);
+
+            aligned_vector<TIn> in[2] = {aligned_vector<TIn>(slab * in_width), aligned_vector<TIn>(count > 1 ? slab * in_width : 0)};
+            aligned_vector<TOut> out(slab * out_width);
+            std::map<size_t, plan_t> plans;
+            auto rows_of = [&](size_t i){ return std::min(slab, rows - i * slab); };
+            pipelined(count, opt.prefetch,
+                [&](size_t i, int slot){
+                    const TIn* p = src + i * slab * in_width;
+                    std::memcpy(in[slot].data(), p, rows_of(i) * in_width * sizeof(TIn));
+                    if(i + 2 < count) will_need(p + 2 * slab * in_width, rows_of(i + 2) * in_width * sizeof(TIn));
+                },
+                [&](size_t i, int slot){
+                    const size_t nr = rows_of(i);
+                    auto it = plans.find(nr);
+                    if(it == plans.end()) it = plans.emplace(nr, plan_t::directional({MKL_LONG(n)}, forward, int(nr))).first;
+                    if constexpr(is_real_v<TIn>) it->second.forward(in[slot].data(), out.data());
+                    else if constexpr(is_real_v<TOut>) it->second.backward(in[slot].data(), out.data());
+                    else if(forward) it->second.forward(in[slot].data(), out.data());
+                    else it->second.backward(in[slot].data(), out.data());
+                    std::memcpy(dst + i * slab * out_width, out.data(), nr * out_width * sizeof(TOut));
+                });
+        }
+
+        //== dst (n, M) = src (M, n)^T through square-ish tiles
+        template<class T> void rotate(const T* src, T* dst, size_t M, size_t n, const options& opt)
+        {
+            const size_t elements = std::max<size_t>(opt.memory_budget / (3 * sizeof(T)), 1);
+            const size_t tc = std::clamp<size_t>(size_t(std::sqrt(double(elements))), 1, n);
+            const size_t tr = std::clamp<size_t>(elements / tc, 1, M);
+            const size_t row_tiles = (M + tr - 1) / tr, col_tiles = (n + tc - 1) / tc;
+            MEKIL_TRACE_SCOPE("ooc.rotate", 2 * M * n * sizeof(T), M, n);
+
+            aligned_vector<T> in[2] = {aligned_vector<T>(tr * tc), aligned_vector<T>(row_tiles * col_tiles > 1 ? tr * tc : 0)};
+            aligned_vector<T> out(tr * tc);
+            auto tile = [&](size_t i){
+                const size_t r0 = (i / col_tiles) * tr, c0 = (i % col_tiles) * tc;
+                return std::array<size_t, 4>{r0, c0, std::min(tr, M - r0), std::min(tc, n - c0)};
+            };
+            pipelined(row_tiles * col_tiles, opt.prefetch,
+                [&](size_t i, int slot){
+                    const auto [r0, c0, nr, nc] = tile(i);
+                    for(size_t r = 0; r < nr; r++) std::memcpy(in[slot].data() + r * nc, src + (r0 + r) * n + c0, nc * sizeof(T));
+                },
+                [&](size_t i, int slot){
+                    const auto [r0, c0, nr, nc] = tile(i);
+                    transpose<T, true>(in[slot].data(), out.data(), {int(nr), int(nc)});
+                    for(size_t c = 0; c < nc; c++) std::memcpy(dst + (c0 + c) * M + r0, out.data() + c * nr, nr * sizeof(T));
+                });
+        }
+
+        template<class T> void require_packed(const io::array_view<T>& v, size_t min_rank, const char* what)
+        {
+            if(v.shape.size() < min_rank || v.row_pitch != v.width()) throw std::invalid_argument(std::string(what) + ": packed arrays of rank >= " + std::to_string(min_rank) + " only");
+        }
+        inline size_t product(const std::vector<size_t>& shape)
+        {
+            size_t n = 1;
+            for(size_t s : shape) n *= s;
+            return n;
+        }
+    }
+
+    //== in-place complex transform of every axis of `data` (e.g. a read-write io::mapped_array)
+    template<class T> void fft(io::array_view<T> data, bool forward, const options& opt = {})
+    {
+        static_assert(is_complex_v<T>, "out_of_core::fft is complex to complex, use rfft / irfft for real data");
+        detail::require_packed(data, 1, "out_of_core::fft");
+        std::vector<size_t> shape = data.shape;
+        const size_t d = shape.size(), N = detail::product(shape);
+        auto scratch = detail::scratch_file(N * sizeof(T), opt);
+        T* buffers[2] = {data.data, reinterpret_cast<T*>(scratch.data())};
+        //== d rotations end where they started when the first pass already moves to the scratch for odd d
+        int cur = 0;
+        for(size_t axis = 0; axis < d; axis++){
+            const size_t n = shape.back(), M = N / n;
+            const int to = (0 == axis && 1 == d % 2) ? 1 - cur : cur;
+            detail::fft_rows<T, T>(buffers[cur], buffers[to], M, n, forward, opt);
+            cur = to;
+            detail::rotate<T>(buffers[cur], buffers[1 - cur], M, n, opt);
+            cur = 1 - cur;
+            std::rotate(shape.begin(), shape.end() - 1, shape.end());
+        }
+    }
+
+    //== forward transform of real `input` (shape (..., n)) into `output` of shape (..., n/2+1)
+    template<class T> void rfft(io::array_view<const T> input, io::array_view<complex_t<T>> output, const options& opt = {})
+    {
+        static_assert(is_real_v<T>);
+        using complex_type = complex_t<T>;
+        detail::require_packed(input, 1, "out_of_core::rfft");
+        detail::require_packed(output, 1, "out_of_core::rfft");
+        std::vector<size_t> shape = input.shape;
+        shape.back() = shape.back() / 2 + 1;
+        if(output.shape != shape) throw std::invalid_argument("out_of_core::rfft: output must have the shape of the half spectrum");
+        const size_t d = shape.size(), N = detail::product(shape);
+        auto scratch = detail::scratch_file(N * sizeof(complex_type), opt);
+        complex_type* buffers[2] = {output.data, reinterpret_cast<complex_type*>(scratch.data())};
+
+        //== r2c of the fastest axis into the buffer the d rotations bring back to `output`
+        int cur = d % 2;
+        detail::fft_rows<T, complex_type>(input.data, buffers[cur], N / shape.back(), input.shape.back(), true, opt);
+        for(size_t axis = 0; axis < d; axis++){
+            const size_t n = shape.back(), M = N / n;
+            if(axis > 0) detail::fft_rows<complex_type, complex_type>(buffers[cur], buffers[cur], M, n, true, opt);
+            detail::rotate<complex_type>(buffers[cur], buffers[1 - cur], M, n, opt);
+            cur = 1 - cur;
+            std::rotate(shape.begin(), shape.end() - 1, shape.end());
+        }
+    }
+
+    //== inverse of rfft : half spectrum `input` (shape (..., n/2+1)) to real `output` (shape (..., n))
+    template<class T> void irfft(io::array_view<const complex_t<T>> input, io::array_view<T> output, const options& opt = {})
+    {
+        static_assert(is_real_v<T>);
+        using complex_type = complex_t<T>;
+        detail::require_packed(input, 1, "out_of_core::irfft");
+        detail::require_packed(output, 1, "out_of_core::irfft");
+        std::vector<size_t> shape = output.shape;
+        shape.back() = shape.back() / 2 + 1;
+        if(input.shape != shape) throw std::invalid_argument("out_of_core::irfft: input must have the shape of the half spectrum");
+        const size_t d = shape.size(), N = detail::product(shape);
+        //== the input stays untouched : rotations alternate between two scratch halves
+        auto scratch = detail::scratch_file(2 * N * sizeof(complex_type), opt);
+        complex_type* buffers[2] = {reinterpret_cast<complex_type*>(scratch.data()), reinterpret_cast<complex_type*>(scratch.data()) + N};
+
+        //== bring every other axis last in turn (c2c), the half axis comes back last for the c2r pass
+        const complex_type* from = input.data;
+        int cur = 0;
+        for(size_t axis = 0; axis < d; axis++){
+            const size_t n = shape.back(), M = N / n;
+            detail::rotate<complex_type>(from, buffers[cur], M, n, opt);
+            std::rotate(shape.begin(), shape.end() - 1, shape.end());
+            if(axis + 1 < d){
+                detail::fft_rows<complex_type, complex_type>(buffers[cur], buffers[cur], N / shape.back(), shape.back(), false, opt);
+                from = buffers[cur];
+                cur = 1 - cur;
+            }
+        }
+        detail::fft_rows<complex_type, T>(buffers[cur], output.data, N / shape.back(), output.shape.back(), false, opt);
+    }
+
+    //== the same transforms on mapped files, with the scratch file next to the file written
+    template<class T> void fft(io::mapped_array<T>& data, bool forward, const options& opt = {})
+    {
+        fft(data.mutable_view(), forward, detail::beside(data.file(), opt));
+    }
+    template<class T> void rfft(const io::mapped_array<T>& input, io::mapped_array<complex_t<T>>& output, const options& opt = {})
+    {
+        rfft<T>(input.view(), output.mutable_view(), detail::beside(output.file(), opt));
+    }
+    template<class T> void irfft(const io::mapped_array<complex_t<T>>& input, io::mapped_array<T>& output, const options& opt = {})
+    {
+        irfft<T>(input.view(), output.mutable_view(), detail::beside(output.file(), opt));
+    }
+}
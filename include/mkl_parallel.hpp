@@ -0,0 +1,116 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#ifdef _OPENMP
+#   include <omp.h>
+#endif
+#if defined(__linux__)
+#   include <sched.h>
+#endif
+
+//== threading control shared by every hand-written loop of the library.
+//   mkl_internal : our loops run serial, MKL keeps its own thread pool busy.
+//   outer_loop   : our loops open OpenMP regions, MKL calls made inside them run sequential
+//                  (MKL detects the enclosing region when dynamic adjustment is on).
+//   sequential   : everything runs on the calling thread.
+namespace mkl
+{
+    enum class parallel_mode
+    {
+        mkl_internal,
+        outer_loop,
+        sequential,
+    };
+    struct execution_policy
+    {
+        int num_threads = 0;            // 0 : runtime default (OMP_NUM_THREADS / core count)
+        parallel_mode mode = parallel_mode::outer_loop;
+        bool pin_threads = false;       // bind OpenMP thread i to the i-th allowed cpu
+        size_t grain = size_t(1) << 16; // minimal number of elements before a loop goes parallel
+    };
+    inline execution_policy& current_execution_policy()
+    {
+        static execution_policy policy;
+        return policy;
+    }
+    inline int max_threads()
+    {
+        const auto& policy = current_execution_policy();
+        if(parallel_mode::sequential == policy.mode) return 1;
+        if(policy.num_threads > 0) return policy.num_threads;
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+    //== set on the workers of a task_scheduler (mkl_task.hpp) : a task is the unit of parallelism,
+    //   library loops inside it run on the worker thread
+    inline bool& in_task_worker()
+    {
+        thread_local bool inside = false;
+        return inside;
+    }
+    //== number of threads a hand-written loop over `work` elements should use.
+    //   nested regions and task workers stay serial so callers that already parallelize are not oversubscribed.
+    inline int loop_threads(size_t work)
+    {
+#ifdef _OPENMP
+        const auto& policy = current_execution_policy();
+        if(parallel_mode::outer_loop != policy.mode || work < policy.grain || omp_in_parallel() || in_task_worker()) return 1;
+        return max_threads();
+#else
+        return 1;
+#endif
+    }
+    inline void pin_threads(int num_threads)
+    {
+#if defined(_OPENMP) && defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if(0 != sched_getaffinity(0, sizeof(allowed), &allowed)) return;
+        std::vector<int> cpus;
+        for(int i = 0; i < CPU_SETSIZE; i++) if(CPU_ISSET(i, &allowed)) cpus.push_back(i);
+        if(cpus.empty()) return;
+        #pragma omp parallel num_threads(num_threads)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus.at(omp_get_thread_num() % cpus.size()), &set);
+            sched_setaffinity(0, sizeof(set), &set);
+        }
+#else
+        (void)num_threads;
+#endif
+    }
+    inline void set_execution_policy(const execution_policy& policy)
+    {
+        current_execution_policy() = policy;
+        const int n = max_threads();
+        switch(policy.mode){
+            case parallel_mode::mkl_internal:
+                mkl_set_dynamic(0);
+                mkl_set_num_threads(n);
+                break;
+            case parallel_mode::outer_loop:
+                mkl_set_dynamic(1);
+                mkl_set_num_threads(n);
+                break;
+            case parallel_mode::sequential:
+                mkl_set_num_threads(1);
+                break;
+        }
+#ifdef _OPENMP
+        if(policy.num_threads > 0) omp_set_num_threads(policy.num_threads);
+#endif
+        if(policy.pin_threads) pin_threads(n);
+    }
+    //== MKL thread count for the calling thread only, restored on scope exit
+    struct scoped_mkl_threads
+    {
+        int previous;
+        explicit scoped_mkl_threads(int n) : previous(mkl_set_num_threads_local(n)) {}
+        ~scoped_mkl_threads() {mkl_set_num_threads_local(previous);}
+        scoped_mkl_threads(const scoped_mkl_threads&) = delete;
+        scoped_mkl_threads& operator=(const scoped_mkl_threads&) = delete;
+    };
+}
@@ -0,0 +1,274 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_arena.hpp"
+#include "mkl_blas.hpp"
+#include "mkl_block_qr.hpp"
+#include "mkl_fft.hpp"
+#include "mkl_lapack.hpp"
+#include "mkl_parallel.hpp"
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <stdexcept>
+
+//== randomized range finder and truncated SVD (Halko, Martinsson & Tropp 2011).
+//   Y = A Omega with l = rank + oversample random columns, q power iterations
+//   Y = A (A^H Y) with a QR between every product, then the SVD of the small l x n matrix Q^H A.
+//   every product with A is one gemm per row block, so MKL threads all the heavy work.
+//
+//   a matrix source exposes rows(), cols(), multiply (Y = A X), multiply_adjoint (Z = A^H Y)
+//   and for_each_row_block(f) with f(row0, nrows, const T* rows_row_major).
+//   dense_source wraps a column-major matrix in memory,
+//   row_block_source streams a row-major matrix (e.g. a memory-mapped file) block by block.
+namespace mkl::randomized
+{
+    enum class sketch
+    {
+        gaussian,   // dense N(0, 1) test matrix, one gemm
+        srft,       // subsampled randomized Fourier transform : random phases, DFT of every row, l sampled frequencies
+    };
+    struct options
+    {
+        size_t rank = 1;
+        size_t oversample = 10;
+        int power_iterations = 2;
+        sketch kind = sketch::gaussian;
+        unsigned seed = 0;
+    };
+    template<class T> struct svd_result
+    {
+        std::vector<T> U;               // m x rank, column-major
+        std::vector<real_t<T>> s;       // descending
+        std::vector<T> V;               // n x rank, column-major : A ~ U diag(s) V^H
+        size_t m = 0, n = 0, rank = 0;
+    };
+
+    //== A is m x n column-major with leading dimension lda
+    template<class T> class dense_source
+    {
+    public:
+        using value_type = T;
+
+        dense_source(size_t m, size_t n, const T* A, size_t lda, size_t block_rows = 1024)
+            : m_(m), n_(n), lda_(lda), block_rows_(std::max<size_t>(1, block_rows)), A_(A) {}
+        size_t rows() const {return m_;}
+        size_t cols() const {return n_;}
+
+        //== Y (m x l, ld m) = A X (n x l, ld n)
+        void multiply(const T* X, size_t l, T* Y) const
+        {
+            blas::gemm<T>(CblasNoTrans, CblasNoTrans, m_, l, n_, T(1), A_, lda_, X, n_, T(0), Y, m_);
+        }
+        //== Z (n x l, ld n) = A^H Y (m x l, ld m)
+        void multiply_adjoint(const T* Y, size_t l, T* Z) const
+        {
+            blas::gemm<T>(blas::adjoint<T>, CblasNoTrans, n_, l, m_, T(1), A_, lda_, Y, m_, T(0), Z, n_);
+        }
+        template<class F> void for_each_row_block(F&& f) const
+        {
+            scratch<T> block(std::min(block_rows_, m_) * n_);
+            for(size_t r0 = 0; r0 < m_; r0 += block_rows_){
+                const size_t nr = std::min(block_rows_, m_ - r0);
+                const int nthreads = mkl::loop_threads(nr * n_);
+                #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+                for(long long i = 0; i < (long long)nr; i++){
+                    for(size_t j = 0; j < n_; j++) block[i * n_ + j] = A_[j * lda_ + r0 + i];
+                }
+                f(r0, nr, static_cast<const T*>(block.data()));
+            }
+        }
+
+    private:
+        size_t m_, n_, lda_, block_rows_;
+        const T* A_;
+    };
+
+    //== A is m x n row-major, read `block_rows` rows at a time through
+    //   reader(row0, nrows, T* dst) which fills nrows x n packed row-major values.
+    //   the whole matrix is never resident : every product makes one pass over the rows.
+    template<class T, class Reader> class row_block_source
+    {
+    public:
+        using value_type = T;
+
+        row_block_source(size_t m, size_t n, Reader reader, size_t block_rows = 4096)
+            : m_(m), n_(n), block_rows_(std::max<size_t>(1, block_rows)), reader_(std::move(reader)) {}
+        size_t rows() const {return m_;}
+        size_t cols() const {return n_;}
+
+        template<class F> void for_each_row_block(F&& f) const
+        {
+            block_.resize(std::min(block_rows_, m_) * n_);
+            for(size_t r0 = 0; r0 < m_; r0 += block_rows_){
+                const size_t nr = std::min(block_rows_, m_ - r0);
+                reader_(r0, nr, block_.data());
+                f(r0, nr, static_cast<const T*>(block_.data()));
+            }
+        }
+        //== a row-major block B is the column-major n x nr matrix B^T
+        void multiply(const T* X, size_t l, T* Y) const
+        {
+            for_each_row_block([&](size_t r0, size_t nr, const T* B){
+                blas::gemm<T>(CblasTrans, CblasNoTrans, nr, l, n_, T(1), B, n_, X, n_, T(0), Y + r0, m_);
+            });
+        }
+        //== accumulates Z^H = sum_blocks Y_block^H B (l x n), then Z = (Z^H)^H
+        void multiply_adjoint(const T* Y, size_t l, T* Z) const
+        {
+            scratch<T> W(l * n_, T(0));
+            for_each_row_block([&](size_t r0, size_t nr, const T* B){
+                blas::gemm<T>(blas::adjoint<T>, CblasTrans, l, n_, nr, T(1), Y + r0, m_, B, n_, T(1), W.data(), l);
+            });
+            for(size_t j = 0; j < l; j++){
+                for(size_t i = 0; i < n_; i++){
+                    if constexpr(is_complex_v<T>) Z[j * n_ + i] = std::conj(W[i * l + j]);
+                    else Z[j * n_ + i] = W[i * l + j];
+                }
+            }
+        }
+
+    private:
+        size_t m_, n_, block_rows_;
+        Reader reader_;
+        mutable aligned_vector<T> block_;
+    };
+    template<class T, class Reader> row_block_source<T, Reader> make_row_block_source(size_t m, size_t n, Reader reader, size_t block_rows = 4096)
+    {
+        return row_block_source<T, Reader>(m, n, std::move(reader), block_rows);
+    }
+
+    namespace detail
+    {
+        template<class T> void gaussian_matrix(size_t rows, size_t cols, T* out, unsigned seed)
+        {
+            std::mt19937 gen(seed);
+            std::normal_distribution<real_t<T>> dis(0, 1);
+            for(size_t i = 0; i < rows * cols; i++){
+                if constexpr(is_complex_v<T>) out[i] = T(dis(gen), dis(gen));
+                else out[i] = dis(gen);
+            }
+        }
+
+        //== Y = A D F R : every row is multiplied by random phases D, transformed and sampled at l frequencies R.
+        //   for real T the half spectrum is sampled and each frequency gives two columns (real and imaginary part),
+        //   DC and Nyquist are skipped since their imaginary part vanishes.
+        template<class T, class Source> bool srft_sketch(const Source& A, size_t l, T* Y, unsigned seed)
+        {
+            using fft_t = mekil::mklFFT<T>;
+            using complex_type = complex_t<T>;
+            const size_t m = A.rows(), n = A.cols();
+            const size_t nf = fft_t::fourier_fastest_size(MKL_LONG(n));
+            const size_t nsample = is_complex_v<T> ? l : (l + 1) / 2;
+            const size_t first = is_complex_v<T> ? 0 : 1, last = is_complex_v<T> ? n : (n + 1) / 2;
+            if(last < first + nsample) return false;
+
+            std::mt19937 gen(seed);
+            aligned_vector<T> phase(n);
+            if constexpr(is_complex_v<T>){
+                std::uniform_real_distribution<real_t<T>> dis(0, 2 * real_t<T>(M_PI));
+                for(auto& p : phase) p = std::polar(real_t<T>(1), dis(gen));
+            }
+            else{
+                std::bernoulli_distribution dis;
+                for(auto& p : phase) p = dis(gen) ? T(1) : T(-1);
+            }
+            std::vector<size_t> freq(last - first);
+            std::iota(freq.begin(), freq.end(), first);
+            std::shuffle(freq.begin(), freq.end(), gen);
+            freq.resize(nsample);
+            const real_t<T> scale = 1 / std::sqrt(real_t<T>(l));
+
+            std::optional<mekil::fft_plan<T>> plan;
+            size_t plan_rows = 0;
+            aligned_vector<T> rows;
+            aligned_vector<complex_type> spectrum;
+            A.for_each_row_block([&](size_t r0, size_t nr, const T* B){
+                if(nr != plan_rows){
+                    plan = mekil::fft_plan<T>::directional({MKL_LONG(n)}, true, int(nr));
+                    plan_rows = nr;
+                }
+                rows.resize(nr * n);
+                spectrum.resize(nr * nf);
+                const int nthreads = mkl::loop_threads(nr * n);
+                #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+                for(long long i = 0; i < (long long)nr; i++){
+                    for(size_t j = 0; j < n; j++) rows[i * n + j] = B[i * n + j] * phase[j];
+                }
+                plan->forward(rows.data(), spectrum.data());
+                #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+                for(long long i = 0; i < (long long)nr; i++){
+                    const complex_type* s = spectrum.data() + i * nf;
+                    for(size_t k = 0; k < nsample; k++){
+                        const complex_type v = s[freq[k]] * scale;
+                        if constexpr(is_complex_v<T>) Y[k * m + r0 + i] = v;
+                        else{
+                            Y[(2 * k) * m + r0 + i] = v.real();
+                            if(2 * k + 1 < l) Y[(2 * k + 1) * m + r0 + i] = v.imag();
+                        }
+                    }
+                }
+            });
+            return true;
+        }
+    }
+
+    //== orthonormal Q (m x l, column-major) with range(Q) ~ range(A), l = rank + oversample clipped to min(m, n).
+    //   srft falls back to a gaussian sketch when n has fewer usable frequencies than l.
+    template<class Source> std::vector<typename Source::value_type> range_finder(const Source& A, const options& opt)
+    {
+        using T = typename Source::value_type;
+        const size_t m = A.rows(), n = A.cols();
+        const size_t l = std::min(opt.rank + opt.oversample, std::min(m, n));
+        if(0 == opt.rank || 0 == l) throw std::invalid_argument("randomized: rank must be in [1, min(m, n)]");
+
+        aligned_vector<T> Z(n * l), R(l * l);
+        std::vector<T> Y(m * l);
+        if(sketch::gaussian == opt.kind || !detail::srft_sketch<T>(A, l, Y.data(), opt.seed)){
+            detail::gaussian_matrix<T>(n, l, Z.data(), opt.seed);
+            A.multiply(Z.data(), l, Y.data());
+        }
+        //== re-orthonormalize after every product, otherwise the power iterations collapse onto the top singular vector
+        for(int it = 0; it < opt.power_iterations; it++){
+            block_qr<T>(m, l, Y.data(), m, R.data(), l);
+            A.multiply_adjoint(Y.data(), l, Z.data());
+            block_qr<T>(n, l, Z.data(), n, R.data(), l);
+            A.multiply(Z.data(), l, Y.data());
+        }
+        block_qr<T>(m, l, Y.data(), m, R.data(), l);
+        return Y;
+    }
+
+    //== truncated SVD : Q from the range finder, then Z = A^H Q = U_z S V_z^H (n x l)
+    //   so that Q^H A = V_z S U_z^H, U = Q V_z and V = U_z.
+    template<class Source> svd_result<typename Source::value_type> svd(const Source& A, const options& opt)
+    {
+        using T = typename Source::value_type;
+        const size_t m = A.rows(), n = A.cols();
+        std::vector<T> Q = range_finder(A, opt);
+        const size_t l = Q.size() / m;
+        const size_t k = std::min(opt.rank, l);
+
+        aligned_vector<T> Z(n * l), Uz(n * l), Vzh(l * l);
+        aligned_vector<real_t<T>> s(l);
+        A.multiply_adjoint(Q.data(), l, Z.data());
+        if(0 != lapack::gesvd<T>('S', 'S', n, l, Z.data(), n, s.data(), Uz.data(), n, Vzh.data(), l)) throw std::runtime_error("randomized: gesvd failed");
+
+        svd_result<T> result;
+        result.m = m;
+        result.n = n;
+        result.rank = k;
+        result.s.assign(s.begin(), s.begin() + k);
+        result.V.assign(Uz.begin(), Uz.begin() + n * k);
+        //== V_z = (V_z^H)^H, U = Q V_z[:, 0:k]
+        result.U.resize(m * k);
+        blas::gemm<T>(CblasNoTrans, blas::adjoint<T>, m, k, l, T(1), Q.data(), m, Vzh.data(), l, T(0), result.U.data(), m);
+        return result;
+    }
+
+    //== column-major m x n matrix in memory
+    template<class T> svd_result<T> svd(size_t m, size_t n, const T* A, size_t lda, const options& opt)
+    {
+        return svd(dense_source<T>(m, n, A, lda), opt);
+    }
+}
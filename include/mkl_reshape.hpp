@@ -1,5 +1,11 @@
 #pragma once
 #include "mkl_basic_operator.h"
+#include "mkl_parallel.hpp"
+#include "mkl_arena.hpp"
+#include "mkl_trace.hpp"
+#include <functional>
+#include <numeric>
+#include <stdexcept>
 
 
 template<class T> inline void copy_batch_strided(const MKL_INT N,
@@ -7,7 +13,31 @@ template<class T> inline void copy_batch_strided(const MKL_INT N,
                                T *Y, const MKL_INT incY, const MKL_INT stridey,
                                const MKL_INT batch_size)
 {
-    CBLAS_REPEAT_CODE(T, copy_batch_strided, N, X, incX, stridex, Y, incY, stridey, batch_size);
+    //== batches are split into contiguous chunks, one chunk per thread
+    const int nthreads = static_cast<int>(std::min<size_t>(mkl::loop_threads(size_t(N) * size_t(batch_size)), size_t(std::max<MKL_INT>(batch_size, 1))));
+    if(nthreads <= 1){
+        CBLAS_REPEAT_CODE(T, copy_batch_strided, N, X, incX, stridex, Y, incY, stridey, batch_size);
+        return;
+    }
+    const MKL_INT chunk = (batch_size + nthreads - 1) / nthreads;
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for(int t = 0; t < nthreads; t++){
+        const MKL_INT b0 = t * chunk;
+        const MKL_INT b1 = std::min(batch_size, b0 + chunk);
+        if(b0 < b1){
+            CBLAS_REPEAT_CODE(T, copy_batch_strided, N, X + size_t(b0) * stridex, incX, stridex, Y + size_t(b0) * stridey, incY, stridey, b1 - b0);
+        }
+    }
+}
+
+namespace mkl::detail
+{
+    //== pixels shared by a window starting at in_offset and one starting at out_offset
+    inline size_t crop_overlap(size_t in_size, size_t in_offset, size_t out_size, size_t out_offset)
+    {
+        if(in_size <= in_offset || out_size <= out_offset) return 0;
+        return std::min(in_size - in_offset, out_size - out_offset);
+    }
 }
 
 template<class T> inline void crop_image(T* output, vec2<size_t> output_shape, vec2<size_t> output_offset, 
@@ -17,49 +47,319 @@ template<class T> inline void crop_image(T* output, vec2<size_t> output_shape, v
     const auto [outputSizeX, outputSizeY] = output_shape;
     const auto [offset_x_in, offset_y_in] = input_offset;
     const auto [offset_x_out, offset_y_out] = output_offset;
+    const size_t nx = mkl::detail::crop_overlap(inputSizeX, offset_x_in, outputSizeX, offset_x_out);
+    const size_t ny = mkl::detail::crop_overlap(inputSizeY, offset_y_in, outputSizeY, offset_y_out);
+    if(0 == nx || 0 == ny) return;
     const T* pIn = input + offset_y_in * inputSizeX + offset_x_in;
     T* pOut = output +  offset_y_out * outputSizeX + offset_x_out;
-    copy_batch_strided<T>(std::min(inputSizeX - offset_x_in, outputSizeX - offset_x_out), pIn, step_in, inputSizeX, pOut, step_out, outputSizeX, std::min(inputSizeY - offset_y_in, outputSizeY - offset_y_out));
+    copy_batch_strided<T>(nx, pIn, step_in, inputSizeX, pOut, step_out, outputSizeX, ny);
 }
-template<class TFrom, class TTo> inline void crop_to(TTo* output, vec2<size_t> output_shape, vec2<size_t> output_offset, 
-                 const TFrom* input,  vec2<size_t> input_shape,  vec2<size_t> input_offset)
+namespace mkl::detail
 {
-    static_assert(std::is_standard_layout_v<TFrom> && std::is_standard_layout_v<TTo>);
-    constexpr int min_pixel_size = std::min(sizeof(TFrom), sizeof(TTo));
-
-    constexpr int element_count_from = sizeof(TFrom) / min_pixel_size;
-    constexpr int element_count_to = sizeof(TTo) / min_pixel_size;
-    static_assert(element_count_from * min_pixel_size == sizeof(TFrom));
-    static_assert(element_count_to   * min_pixel_size == sizeof(TTo));
-    static_assert(element_count_from == 1 || element_count_to == 1);
-
-    output_shape[0] *= element_count_to;
-    output_offset[0] *= element_count_to;
-    input_shape[0] *= element_count_from;
-    input_offset[0] *= element_count_from;
-    auto crop = [&](auto t){
-        using T = decltype(t);
-        crop_image<T>(reinterpret_cast<T*>(output), output_shape, output_offset,
-                     reinterpret_cast<const T*>(input), input_shape, input_offset, element_count_from, element_count_to
-        );
+    //== out[i] = convert(in[i]) * scale + offset over one row of n pixels.
+    //== complex -> real keeps the real part, real -> complex sets the imaginary part to offset.imag(),
+    //== or leaves it untouched with real_part_only (the crop_to contract).
+    //== pixels are walked as interleaved scalars so every case is a unit or stride-2 simd loop.
+    template<class TFrom, class TTo, class R, bool real_part_only = false> inline void convert_row(const TFrom* in, TTo* out, size_t n, R scale, TTo offset)
+    {
+        using SFrom = real_t<TFrom>;
+        using STo = real_t<TTo>;
+        const SFrom* __restrict s = reinterpret_cast<const SFrom*>(in);
+        STo* __restrict d = reinterpret_cast<STo*>(out);
+        if constexpr(std::is_same_v<TFrom, TTo>){
+            if(R(1) == scale && TTo(0) == offset){
+                std::copy(in, in + n, out);
+                return;
+            }
+        }
+        const R re = std::real(offset);
+        if constexpr(is_real_v<TFrom> && is_real_v<TTo>){
+            #pragma omp simd
+            for(size_t i = 0; i < n; i++) d[i] = STo(R(s[i]) * scale + re);
+        }
+        else if constexpr(is_complex_v<TFrom> && is_real_v<TTo>){
+            #pragma omp simd
+            for(size_t i = 0; i < n; i++) d[i] = STo(R(s[2 * i]) * scale + re);
+        }
+        else{
+            const STo im = STo(std::imag(offset));
+            if constexpr(is_real_v<TFrom> && real_part_only){
+                #pragma omp simd
+                for(size_t i = 0; i < n; i++) d[2 * i] = STo(R(s[i]) * scale + re);
+            }
+            else if constexpr(is_real_v<TFrom>){
+                #pragma omp simd
+                for(size_t i = 0; i < n; i++){
+                    d[2 * i] = STo(R(s[i]) * scale + re);
+                    d[2 * i + 1] = im;
+                }
+            }
+            else{
+                #pragma omp simd
+                for(size_t i = 0; i < n; i++){
+                    d[2 * i] = STo(R(s[2 * i]) * scale + re);
+                    d[2 * i + 1] = STo(R(s[2 * i + 1]) * scale + R(im));
+                }
+            }
+        }
+    }
+
+    //== one image of a stack : input == nullptr marks an output image with no source (zero-filled or skipped)
+    template<class TFrom, class TTo> struct crop_frame
+    {
+        const TFrom* input;
+        TTo* output;
+        vec2<size_t> input_offset;
+        vec2<size_t> output_offset;
     };
 
-    if constexpr(sizeof(float) == min_pixel_size){
-        crop(float());
+    //== one pass over the output rows of count images : the overlap of the two windows is converted,
+    //== the rest of each output is zeroed when zero_fill is set and left untouched otherwise.
+    //== (image, row) pairs are flattened so small frames of a large stack still spread over the threads.
+    template<class TFrom, class TTo, class R, bool real_part_only = false, class Frame> inline void crop_convert_stack(size_t count, vec2<size_t> output_shape, vec2<size_t> input_shape,
+                     Frame frame, R scale, TTo offset, bool zero_fill)
+    {
+        const auto [inputSizeX, inputSizeY] = input_shape;
+        const auto [outputSizeX, outputSizeY] = output_shape;
+        const size_t rows = count * outputSizeY;
+        const int nthreads = mkl::loop_threads(rows * outputSizeX);
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long r = 0; r < static_cast<long long>(rows); r++){
+            const size_t y = size_t(r) % outputSizeY;
+            const crop_frame<TFrom, TTo> f = frame(size_t(r) / outputSizeY);
+            const auto [offset_x_in, offset_y_in] = f.input_offset;
+            const auto [offset_x_out, offset_y_out] = f.output_offset;
+            //== counted in pixels on both sides, whatever the scalar types are
+            const size_t nx = nullptr == f.input ? 0 : crop_overlap(inputSizeX, offset_x_in, outputSizeX, offset_x_out);
+            const size_t ny = nullptr == f.input ? 0 : crop_overlap(inputSizeY, offset_y_in, outputSizeY, offset_y_out);
+            const bool covered = 0 != nx && offset_y_out <= y && y < offset_y_out + ny;
+            TTo* pOut = f.output + y * outputSizeX;
+            if(!covered){
+                if(zero_fill) std::fill(pOut, pOut + outputSizeX, TTo(0));
+                continue;
+            }
+            if(zero_fill){
+                std::fill(pOut, pOut + offset_x_out, TTo(0));
+                std::fill(pOut + offset_x_out + nx, pOut + outputSizeX, TTo(0));
+            }
+            const TFrom* pIn = f.input + (y - offset_y_out + offset_y_in) * inputSizeX + offset_x_in;
+            convert_row<TFrom, TTo, R, real_part_only>(pIn, pOut + offset_x_out, nx, scale, offset);
+        }
+    }
+    template<class TFrom, class TTo, class R, bool real_part_only = false> inline void crop_convert(TTo* output, vec2<size_t> output_shape, vec2<size_t> output_offset,
+                     const TFrom* input, vec2<size_t> input_shape, vec2<size_t> input_offset, R scale, TTo offset, bool zero_fill)
+    {
+        const crop_frame<TFrom, TTo> f{input, output, input_offset, output_offset};
+        crop_convert_stack<TFrom, TTo, R, real_part_only>(1, output_shape, input_shape, [&](size_t){ return f; }, scale, offset, zero_fill);
+    }
+
+    //== offsets are given once for the whole stack or once per image
+    inline const vec2<size_t>& batch_offset(const std::vector<vec2<size_t>>& offsets, size_t i)
+    {
+        return offsets[1 == offsets.size() ? 0 : i];
     }
-    else if constexpr(sizeof(double) == min_pixel_size){
-        crop(double());
+    inline void check_batch_offsets(const std::vector<vec2<size_t>>& offsets, size_t batch)
+    {
+        if(offsets.size() != 1 && offsets.size() != batch)
+            throw std::invalid_argument("crop offsets : expected 1 or " + std::to_string(batch) + " entries, got " + std::to_string(offsets.size()));
     }
-    else if constexpr(sizeof(std::complex<double>) == min_pixel_size){
-        crop(std::complex<double>());
+}
+
+//== crop, convert between any of {float, double, complex<float>, complex<double>}, then scale and shift :
+//==     output(offset_out + p) = convert(input(offset_in + p)) * scale + offset
+//== complex -> real keeps the real part. with zero_fill, output pixels outside the overlap are set to zero.
+template<class TFrom, class TTo> inline void crop_convert(TTo* output, vec2<size_t> output_shape, vec2<size_t> output_offset,
+                 const TFrom* input,  vec2<size_t> input_shape,  vec2<size_t> input_offset,
+                 real_t<TTo> scale = 1, TTo offset = TTo(0), bool zero_fill = false)
+{
+    MEKIL_TRACE_SCOPE("reshape.crop_convert", (sizeof(TFrom) + sizeof(TTo)) * output_shape[0] * output_shape[1], output_shape[0], output_shape[1]);
+    using R = decltype(real_t<TFrom>() * real_t<TTo>());
+    mkl::detail::crop_convert<TFrom, TTo, R>(output, output_shape, output_offset, input, input_shape, input_offset, R(scale), offset, zero_fill);
+}
+//== batched crop_convert over a stack of images stored input_distance / output_distance elements apart.
+//== offsets hold one window position for every image or one per image.
+template<class TFrom, class TTo> inline void crop_convert_batch(TTo* output, vec2<size_t> output_shape, size_t output_distance, const std::vector<vec2<size_t>>& output_offsets,
+                 const TFrom* input, vec2<size_t> input_shape, size_t input_distance, const std::vector<vec2<size_t>>& input_offsets, size_t batch,
+                 real_t<TTo> scale = 1, TTo offset = TTo(0), bool zero_fill = false)
+{
+    MEKIL_TRACE_SCOPE("reshape.crop_convert_batch", (sizeof(TFrom) + sizeof(TTo)) * output_shape[0] * output_shape[1] * batch, output_shape[0], output_shape[1], batch);
+    mkl::detail::check_batch_offsets(output_offsets, batch);
+    mkl::detail::check_batch_offsets(input_offsets, batch);
+    using R = decltype(real_t<TFrom>() * real_t<TTo>());
+    mkl::detail::crop_convert_stack<TFrom, TTo, R>(batch, output_shape, input_shape, [&](size_t i){
+        return mkl::detail::crop_frame<TFrom, TTo>{input + i * input_distance, output + i * output_distance,
+            mkl::detail::batch_offset(input_offsets, i), mkl::detail::batch_offset(output_offsets, i)};
+    }, R(scale), offset, zero_fill);
+}
+//== same over images scattered in memory, one pointer per image
+template<class TFrom, class TTo> inline void crop_convert_batch(TTo* const* outputs, vec2<size_t> output_shape, const std::vector<vec2<size_t>>& output_offsets,
+                 const TFrom* const* inputs, vec2<size_t> input_shape, const std::vector<vec2<size_t>>& input_offsets, size_t batch,
+                 real_t<TTo> scale = 1, TTo offset = TTo(0), bool zero_fill = false)
+{
+    MEKIL_TRACE_SCOPE("reshape.crop_convert_batch", (sizeof(TFrom) + sizeof(TTo)) * output_shape[0] * output_shape[1] * batch, output_shape[0], output_shape[1], batch);
+    mkl::detail::check_batch_offsets(output_offsets, batch);
+    mkl::detail::check_batch_offsets(input_offsets, batch);
+    using R = decltype(real_t<TFrom>() * real_t<TTo>());
+    mkl::detail::crop_convert_stack<TFrom, TTo, R>(batch, output_shape, input_shape, [&](size_t i){
+        return mkl::detail::crop_frame<TFrom, TTo>{inputs[i], outputs[i],
+            mkl::detail::batch_offset(input_offsets, i), mkl::detail::batch_offset(output_offsets, i)};
+    }, R(scale), offset, zero_fill);
+}
+//== crop of an x-fastest volume, shapes and offsets are {x, y, z}. output slices without a source slice
+//== are zeroed with zero_fill. (slice, row) pairs are spread over the threads like a stack of images.
+template<class TFrom, class TTo> inline void crop_convert_3d(TTo* output, std::array<size_t, 3> output_shape, std::array<size_t, 3> output_offset,
+                 const TFrom* input, std::array<size_t, 3> input_shape, std::array<size_t, 3> input_offset,
+                 real_t<TTo> scale = 1, TTo offset = TTo(0), bool zero_fill = false)
+{
+    MEKIL_TRACE_SCOPE("reshape.crop_convert_3d", (sizeof(TFrom) + sizeof(TTo)) * output_shape[0] * output_shape[1] * output_shape[2], output_shape[0], output_shape[1], output_shape[2]);
+    using R = decltype(real_t<TFrom>() * real_t<TTo>());
+    const size_t in_slice = input_shape[0] * input_shape[1], out_slice = output_shape[0] * output_shape[1];
+    const size_t nz = mkl::detail::crop_overlap(input_shape[2], input_offset[2], output_shape[2], output_offset[2]);
+    const vec2<size_t> in_offset{input_offset[0], input_offset[1]}, out_offset{output_offset[0], output_offset[1]};
+    mkl::detail::crop_convert_stack<TFrom, TTo, R>(output_shape[2], {output_shape[0], output_shape[1]}, {input_shape[0], input_shape[1]}, [&](size_t z){
+        const bool covered = output_offset[2] <= z && z < output_offset[2] + nz;
+        const TFrom* in = covered ? input + (z - output_offset[2] + input_offset[2]) * in_slice : nullptr;
+        return mkl::detail::crop_frame<TFrom, TTo>{in, output + z * out_slice, in_offset, out_offset};
+    }, R(scale), offset, zero_fill);
+}
+//== plain crop between pixel types : complex -> real keeps the real part, real -> complex writes
+//== the real part only and leaves the imaginary part of the output as it was.
+template<class TFrom, class TTo> inline void crop_to(TTo* output, vec2<size_t> output_shape, vec2<size_t> output_offset, 
+                 const TFrom* input,  vec2<size_t> input_shape,  vec2<size_t> input_offset)
+{
+    MEKIL_TRACE_SCOPE("reshape.crop_to", (sizeof(TFrom) + sizeof(TTo)) * output_shape[0] * output_shape[1], output_shape[0], output_shape[1]);
+    static_assert(std::is_standard_layout_v<TFrom> && std::is_standard_layout_v<TTo>);
+    if constexpr(std::is_same_v<TFrom, TTo>){
+        crop_image<TTo>(output, output_shape, output_offset, input, input_shape, input_offset);
     }
     else{
-        unreachable_constexpr_if();
+        using R = decltype(real_t<TFrom>() * real_t<TTo>());
+        mkl::detail::crop_convert<TFrom, TTo, R, true>(output, output_shape, output_offset, input, input_shape, input_offset, R(1), TTo(0), false);
     }
 }
 
 
 
+namespace mkl::detail
+{
+    //== output[out, out + count) <- input[in, in + count) along one axis
+    struct embed_run
+    {
+        size_t out;
+        size_t in;
+        size_t count;
+    };
+
+    //== one axis of a centered embed : the input center n/2 lands on the output center N/2,
+    //== or on index 0 when the result is written ifftshifted (numpy ifftshift of the centered pad).
+    //== n > N crops the center instead.
+    struct embed_axis
+    {
+        size_t N, n;
+        bool shifted;
+        long long offset;   // pre-shift output index of input index 0
+
+        embed_axis(size_t N, size_t n, bool shifted)
+            : N(N), n(n), shifted(shifted), offset(static_cast<long long>(N / 2) - static_cast<long long>(n / 2)) {}
+
+        //== input index written to output index y, -1 when y is padding
+        long long source(size_t y) const
+        {
+            const size_t q = shifted ? (y + N / 2) % N : y;
+            const long long i = static_cast<long long>(q) - offset;
+            return (0 <= i && i < static_cast<long long>(n)) ? i : -1;
+        }
+        //== at most two runs (the shift wraps the data around), ordered by output index
+        std::array<embed_run, 2> runs(size_t& count) const
+        {
+            const size_t qa = size_t(std::max<long long>(0, offset));
+            const size_t qb = size_t(std::clamp<long long>(offset + static_cast<long long>(n), 0, static_cast<long long>(N)));
+            std::array<embed_run, 2> r{};
+            count = 0;
+            if(qa >= qb) return r;
+            if(!shifted){
+                r[count++] = {qa, size_t(static_cast<long long>(qa) - offset), qb - qa};
+                return r;
+            }
+            const size_t h = N / 2;
+            if(std::max(qa, h) < qb) r[count++] = {std::max(qa, h) - h, size_t(static_cast<long long>(std::max(qa, h)) - offset), qb - std::max(qa, h)};
+            if(qa < std::min(qb, h)) r[count++] = {qa + N - h, size_t(static_cast<long long>(qa) - offset), std::min(qb, h) - qa};
+            return r;
+        }
+    };
+
+    //== every output row is written once : zeros in the gaps (and the row padding), converted data in the runs
+    inline void check_embed_pitch(size_t output_pitch, size_t width)
+    {
+        if(output_pitch < width)
+            throw std::invalid_argument("embed : output pitch " + std::to_string(output_pitch) + " is smaller than the row width " + std::to_string(width));
+    }
+    template<class TFrom, class TTo, class R, class SourceRow> inline void embed_rows(TTo* output, size_t output_pitch, size_t rows, const embed_axis& x,
+                     SourceRow source_row, const TFrom* input, R scale)
+    {
+        size_t nruns = 0;
+        const auto runs = x.runs(nruns);
+        const int nthreads = mkl::loop_threads(rows * output_pitch);
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long r = 0; r < static_cast<long long>(rows); r++){
+            TTo* pOut = output + size_t(r) * output_pitch;
+            const long long src = source_row(size_t(r));
+            if(src < 0){
+                std::fill(pOut, pOut + output_pitch, TTo(0));
+                continue;
+            }
+            const TFrom* pIn = input + size_t(src) * x.n;
+            size_t filled = 0;
+            for(size_t k = 0; k < nruns; k++){
+                std::fill(pOut + filled, pOut + runs[k].out, TTo(0));
+                convert_row<TFrom, TTo, R>(pIn + runs[k].in, pOut + runs[k].out, runs[k].count, scale, TTo(0));
+                filled = runs[k].out + runs[k].count;
+            }
+            std::fill(pOut + filled, pOut + output_pitch, TTo(0));
+        }
+    }
+}
+
+//== embed input centered into a zero-filled output in one pass, shapes are {x, y} with x fastest.
+//== the input center (n/2 on every axis) lands on the output center, or on pixel 0 with ifftshift :
+//== the result is then ready for an fft, as ifftshift(pad) would give, for odd and even sizes.
+//== a larger input is center-cropped. output_pitch > x (e.g. 2 * (x / 2 + 1) for in-place r2c) zeroes the row padding too.
+template<class TFrom, class TTo> inline void embed_centered(TTo* output, vec2<size_t> output_shape, const TFrom* input, vec2<size_t> input_shape,
+                 bool ifftshift = false, real_t<TTo> scale = 1, size_t output_pitch = 0)
+{
+    if(0 == output_pitch) output_pitch = output_shape[0];
+    mkl::detail::check_embed_pitch(output_pitch, output_shape[0]);
+    MEKIL_TRACE_SCOPE("reshape.embed_centered", sizeof(TFrom) * input_shape[0] * input_shape[1] + sizeof(TTo) * output_pitch * output_shape[1], output_shape[0], output_shape[1]);
+    using R = decltype(real_t<TFrom>() * real_t<TTo>());
+    const mkl::detail::embed_axis x(output_shape[0], input_shape[0], ifftshift), y(output_shape[1], input_shape[1], ifftshift);
+    mkl::detail::embed_rows<TFrom, TTo, R>(output, output_pitch, output_shape[1], x, [&](size_t r){ return y.source(r); }, input, R(scale));
+}
+//== same for volumes, shapes are {x, y, z}
+template<class TFrom, class TTo> inline void embed_centered_3d(TTo* output, std::array<size_t, 3> output_shape, const TFrom* input, std::array<size_t, 3> input_shape,
+                 bool ifftshift = false, real_t<TTo> scale = 1, size_t output_pitch = 0)
+{
+    if(0 == output_pitch) output_pitch = output_shape[0];
+    mkl::detail::check_embed_pitch(output_pitch, output_shape[0]);
+    MEKIL_TRACE_SCOPE("reshape.embed_centered_3d", sizeof(TFrom) * input_shape[0] * input_shape[1] * input_shape[2] + sizeof(TTo) * output_pitch * output_shape[1] * output_shape[2],
+                      output_shape[0], output_shape[1], output_shape[2]);
+    using R = decltype(real_t<TFrom>() * real_t<TTo>());
+    const mkl::detail::embed_axis x(output_shape[0], input_shape[0], ifftshift), y(output_shape[1], input_shape[1], ifftshift), z(output_shape[2], input_shape[2], ifftshift);
+    const size_t ny = output_shape[1];
+    mkl::detail::embed_rows<TFrom, TTo, R>(output, output_pitch, ny * output_shape[2], x, [&](size_t r){
+        const long long sy = y.source(r % ny), sz = z.source(r / ny);
+        return (sy < 0 || sz < 0) ? -1 : sz * static_cast<long long>(input_shape[1]) + sy;
+    }, input, R(scale));
+}
+//== centered zero padding, the inverse of a centered crop
+template<class T> inline void pad_to(T* output, vec2<size_t> output_shape, const T* input, vec2<size_t> input_shape, bool ifftshift = false)
+{
+    embed_centered<T, T>(output, output_shape, input, input_shape, ifftshift);
+}
+template<class T> inline void pad_to_3d(T* output, std::array<size_t, 3> output_shape, const T* input, std::array<size_t, 3> input_shape, bool ifftshift = false)
+{
+    embed_centered_3d<T, T>(output, output_shape, input, input_shape, ifftshift);
+}
+
 template <class T> inline void fftshift_even_only(T *image, size_t width, size_t height)
 {
     const size_t sizeX = width;
@@ -72,18 +372,18 @@ template <class T> inline void fftshift_even_only(T *image, size_t width, size_t
 
     const size_t halfSizeX = (sizeX + 1) / 2;
     const size_t halfSizeY = (sizeY + 1) / 2;
-    for (size_t i = 0; i < halfSizeY; i++)
+    const int nthreads = mkl::loop_threads(sizeX * sizeY);
+    #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+    for (long long i = 0; i < static_cast<long long>(halfSizeY); i++)
     {
-        CBLAS_REPEAT_CODE(T, swap, halfSizeX, pA, 1, pD, 1);
-        CBLAS_REPEAT_CODE(T, swap, halfSizeX, pB, 1, pC, 1);
-        pA += sizeX;
-        pD += sizeX;
-        pB += sizeX;
-        pC += sizeX;
+        const size_t offset = size_t(i) * sizeX;
+        CBLAS_REPEAT_CODE(T, swap, halfSizeX, pA + offset, 1, pD + offset, 1);
+        CBLAS_REPEAT_CODE(T, swap, halfSizeX, pB + offset, 1, pC + offset, 1);
     }
 }
 template <class T> inline void fftshift(T *image, size_t width, size_t height)
 {
+    MEKIL_TRACE_SCOPE("reshape.fftshift", 2 * sizeof(T) * width * height, width, height);
     if((0 == width %2) && ( 0 == height %2)){
         fftshift_even_only(image, width, height);
         return;
@@ -98,7 +398,7 @@ template <class T> inline void fftshift(T *image, size_t width, size_t height)
     T *pC = image + (sizeY - halfSizeY) * sizeX;
     T *pD = image + halfSizeY * sizeX + halfSizeX;
 
-    std::vector<T> temp(halfSizeX * sizeY);
+    mkl::scratch<T> temp(halfSizeX * sizeY);
     copy_batch_strided(halfSizeX, pA, 1, sizeX, temp.data(), 1, halfSizeX, sizeY);
     
     copy_batch_strided(sizeX - halfSizeX, pB, 1, sizeX, pC, 1, sizeX, halfSizeY);
@@ -109,19 +409,184 @@ template <class T> inline void fftshift(T *image, size_t width, size_t height)
     copy_batch_strided(halfSizeX, temp.data(), 1, halfSizeX, pD, 1, sizeX, halfSizeY);
     copy_batch_strided(halfSizeX, temp.data() + halfSizeX * halfSizeY, 1, halfSizeX, pB, 1, sizeX, sizeY - halfSizeY);
 }
+namespace mkl::detail
+{
+    template<class T> constexpr bool is_mkl_scalar_v = is_s<T> || is_d<T> || is_c<T> || is_z<T>;
+
+    //== leaves of the recursive transposes : about one L1 worth of source and destination
+    template<class T> constexpr size_t transpose_leaf = std::max<size_t>(16, 4096 / sizeof(T));
+    template<class T> constexpr size_t transpose_tile = std::max<size_t>(8, 64 / sizeof(T) * 4);
+
+    //== cache-oblivious out-of-place transpose of rows [r0, r1) x cols [c0, c1) of a row-major matrix :
+    //== split the longer side until the block fits the leaf size, whatever the cache sizes are
+    template<class T> inline void transpose_recursive(const T* in, size_t ld_in, T* out, size_t ld_out, size_t r0, size_t r1, size_t c0, size_t c1)
+    {
+        if((r1 - r0) * (c1 - c0) <= transpose_leaf<T> || (r1 - r0 <= 1 && c1 - c0 <= 1)){
+            for(size_t r = r0; r < r1; r++){
+                for(size_t c = c0; c < c1; c++) out[c * ld_out + r] = in[r * ld_in + c];
+            }
+            return;
+        }
+        if(r1 - r0 >= c1 - c0){
+            const size_t rm = r0 + (r1 - r0) / 2;
+            transpose_recursive(in, ld_in, out, ld_out, r0, rm, c0, c1);
+            transpose_recursive(in, ld_in, out, ld_out, rm, r1, c0, c1);
+        }
+        else{
+            const size_t cm = c0 + (c1 - c0) / 2;
+            transpose_recursive(in, ld_in, out, ld_out, r0, r1, c0, cm);
+            transpose_recursive(in, ld_in, out, ld_out, r0, r1, cm, c1);
+        }
+    }
+    //== row bands of the source go to the threads, each band recursive
+    template<class T> inline void transpose_fallback(const T* in, T* out, size_t rows, size_t cols)
+    {
+        const size_t band = transpose_tile<T> * 4;
+        const size_t bands = (rows + band - 1) / band;
+        const int nthreads = mkl::loop_threads(rows * cols);
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long b = 0; b < static_cast<long long>(bands); b++){
+            transpose_recursive(in, cols, out, rows, size_t(b) * band, std::min(rows, (size_t(b) + 1) * band), 0, cols);
+        }
+    }
+    //== square in place : tiles above the diagonal are swapped with their mirror, diagonal tiles transposed
+    template<class T> inline void transpose_square_inplace(T* a, size_t n)
+    {
+        const size_t tile = transpose_tile<T>;
+        const size_t tiles = (n + tile - 1) / tile;
+        const int nthreads = mkl::loop_threads(n * n);
+        //== the work per tile row shrinks along the diagonal, tile rows are dealt round robin
+        #pragma omp parallel for schedule(static, 1) num_threads(nthreads) if(nthreads > 1)
+        for(long long ti = 0; ti < static_cast<long long>(tiles); ti++){
+            const size_t r0 = size_t(ti) * tile, r1 = std::min(n, r0 + tile);
+            for(size_t r = r0; r < r1; r++){
+                for(size_t c = r + 1; c < r1; c++) std::swap(a[r * n + c], a[c * n + r]);
+            }
+            for(size_t c0 = r1; c0 < n; c0 += tile){
+                const size_t c1 = std::min(n, c0 + tile);
+                for(size_t r = r0; r < r1; r++){
+                    for(size_t c = c0; c < c1; c++) std::swap(a[r * n + c], a[c * n + r]);
+                }
+            }
+        }
+    }
+    //== rectangular in place : follow the cycles of k -> k * rows mod (rows * cols - 1),
+    //== with one marker bit per element instead of a second copy of the matrix
+    template<class T> inline void transpose_cycles_inplace(T* a, size_t rows, size_t cols)
+    {
+        const size_t N = rows * cols;
+        if(N < 3) return;
+        const size_t M = N - 1;
+        mkl::scratch<uint64_t> visited((N + 63) / 64, 0);
+        auto test_and_set = [&](size_t k){
+            const uint64_t bit = uint64_t(1) << (k % 64);
+            const bool was = visited[k / 64] & bit;
+            visited[k / 64] |= bit;
+            return was;
+        };
+        for(size_t start = 1; start < M; start++){
+            if(test_and_set(start)) continue;
+            T carried = a[start];
+            size_t k = start;
+            while(true){
+#if defined(__SIZEOF_INT128__)
+                k = size_t((static_cast<unsigned __int128>(k) * rows) % M);
+#else
+                k = size_t((static_cast<uint64_t>(k) * rows) % M);
+#endif
+                std::swap(carried, a[k]);
+                if(k == start) break;
+                test_and_set(k);
+            }
+        }
+    }
+}
+
+//== shape is {rows, cols} of the input. float, double and complex go to mkl_?omatcopy,
+//== other element types to a parallel cache-oblivious transpose.
 template<class T, bool is_c_stly_memory_layout = false>
 inline void transpose(const T* input, T* output, const std::array<int,2>& shape)
 {
     const int rows = shape[0];
     const int cols = shape[1];
-    MKL_REPEAT_CODE(T, omatcopy,
-        is_c_stly_memory_layout ? 'R' : 'C', // memory layout
-        'T',                                 // transpose
-        rows, cols,
-        mkl_t<T>{1.0},                       // alpha
-        (const mkl_t<T>*)input, is_c_stly_memory_layout ? cols : rows,
-        (mkl_t<T>*)output, is_c_stly_memory_layout ? rows : cols
-    );
+    if constexpr(mkl::detail::is_mkl_scalar_v<T>){
+        const T one(1);
+        MKL_REPEAT_CODE(T, omatcopy,
+            is_c_stly_memory_layout ? 'R' : 'C', // memory layout
+            'T',                                 // transpose
+            rows, cols,
+            *reinterpret_cast<const mkl_t<T>*>(&one), // alpha
+            (const mkl_t<T>*)input, is_c_stly_memory_layout ? cols : rows,
+            (mkl_t<T>*)output, is_c_stly_memory_layout ? rows : cols
+        );
+    }
+    else{
+        //== a column-major rows x cols matrix is a row-major cols x rows one
+        if constexpr(is_c_stly_memory_layout) mkl::detail::transpose_fallback(input, output, size_t(rows), size_t(cols));
+        else                                   mkl::detail::transpose_fallback(input, output, size_t(cols), size_t(rows));
+    }
+}
+//== in-place transpose of a {rows, cols} matrix, square or rectangular, without a second buffer.
+//== float, double and complex go to mkl_?imatcopy. other types use blocked tile swaps when square
+//== and serial cycle following when rectangular (one marker bit per element).
+template<class T, bool is_c_stly_memory_layout = false>
+inline void transpose_inplace(T* data, const std::array<size_t, 2>& shape)
+{
+    const auto [rows, cols] = shape;
+    MEKIL_TRACE_SCOPE("reshape.transpose_inplace", 2 * sizeof(T) * rows * cols, rows, cols);
+    if constexpr(mkl::detail::is_mkl_scalar_v<T>){
+        const T one(1);
+        MKL_REPEAT_CODE(T, imatcopy,
+            is_c_stly_memory_layout ? 'R' : 'C',
+            'T',
+            rows, cols,
+            *reinterpret_cast<const mkl_t<T>*>(&one),
+            (mkl_t<T>*)data, is_c_stly_memory_layout ? cols : rows,
+            is_c_stly_memory_layout ? rows : cols
+        );
+    }
+    else if(rows == cols){
+        mkl::detail::transpose_square_inplace(data, rows);
+    }
+    else{
+        if constexpr(is_c_stly_memory_layout) mkl::detail::transpose_cycles_inplace(data, rows, cols);
+        else                                   mkl::detail::transpose_cycles_inplace(data, cols, rows);
+    }
+}
+//== transpose of batch {rows, cols} matrices, input_distance / output_distance elements apart (0 : packed).
+//== float, double and complex go to mkl_?omatcopy_batch_strided.
+template<class T, bool is_c_stly_memory_layout = false>
+inline void transpose_batch(const T* input, T* output, const std::array<size_t, 2>& shape, size_t batch, size_t input_distance = 0, size_t output_distance = 0)
+{
+    const auto [rows, cols] = shape;
+    if(0 == input_distance) input_distance = rows * cols;
+    if(0 == output_distance) output_distance = rows * cols;
+    MEKIL_TRACE_SCOPE("reshape.transpose_batch", 2 * sizeof(T) * rows * cols * batch, rows, cols, batch);
+    if constexpr(mkl::detail::is_mkl_scalar_v<T>){
+        const T one(1);
+        MKL_REPEAT_CODE(T, omatcopy_batch_strided,
+            is_c_stly_memory_layout ? 'R' : 'C',
+            'T',
+            rows, cols,
+            *reinterpret_cast<const mkl_t<T>*>(&one),
+            (const mkl_t<T>*)input, is_c_stly_memory_layout ? cols : rows, input_distance,
+            (mkl_t<T>*)output, is_c_stly_memory_layout ? rows : cols, output_distance,
+            batch
+        );
+    }
+    else{
+        const size_t r = is_c_stly_memory_layout ? rows : cols, c = is_c_stly_memory_layout ? cols : rows;
+        //== whole images per thread when the stack is deep enough, parallel images otherwise
+        const int nthreads = mkl::loop_threads(rows * cols * batch);
+        if(nthreads <= 1 || batch < size_t(nthreads)){
+            for(size_t b = 0; b < batch; b++) mkl::detail::transpose_fallback(input + b * input_distance, output + b * output_distance, r, c);
+            return;
+        }
+        #pragma omp parallel for schedule(static) num_threads(nthreads)
+        for(long long b = 0; b < static_cast<long long>(batch); b++){
+            mkl::detail::transpose_recursive(input + size_t(b) * input_distance, c, output + size_t(b) * output_distance, r, 0, r, 0, c);
+        }
+    }
 }
 template<class TFrom, class TTo, class Callback, bool is_c_stly_memory_layout = false>
 inline void permuteND(const TFrom* input, TTo* output,
@@ -130,9 +595,11 @@ inline void permuteND(const TFrom* input, TTo* output,
                Callback convert_callback)
 {
     int ndim = static_cast<int>(shape.size());
+    MEKIL_TRACE_SCOPE("reshape.permuteND", (sizeof(TFrom) + sizeof(TTo)) * std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>()),
+                      mkl::trace::extent(shape, 0), mkl::trace::extent(shape, 1), mkl::trace::extent(shape, 2));
 
     // 计算输入 stride
-    std::vector<int> in_stride(ndim);
+    mkl::scratch<int> in_stride(ndim);
     if constexpr (is_c_stly_memory_layout) {
         // C-style: last dim stride=1
         in_stride[ndim - 1] = 1;
@@ -148,12 +615,12 @@ inline void permuteND(const TFrom* input, TTo* output,
     }
 
     // 输出 shape
-    std::vector<int> out_shape(ndim);
+    mkl::scratch<int> out_shape(ndim);
     for (int i = 0; i < ndim; ++i)
         out_shape[i] = shape[perm[i]];
 
     // 输出 stride (和输入相同方式)
-    std::vector<int> out_stride(ndim);
+    mkl::scratch<int> out_stride(ndim);
     if constexpr (is_c_stly_memory_layout) {
         out_stride[ndim - 1] = 1;
         for (int i = ndim - 2; i >= 0; --i) {
@@ -170,35 +637,40 @@ inline void permuteND(const TFrom* input, TTo* output,
     int total = 1;
     for (int d : shape) total *= d;
 
-    // 遍历输出 index
-    for (int out_index = 0; out_index < total; ++out_index) {
-        // 解码 output 坐标
-        std::vector<int> out_coord(ndim);
-        int idx = out_index;
-        if constexpr (is_c_stly_memory_layout) {
-            for (int i = 0; i < ndim; ++i) {
-                out_coord[i] = idx / out_stride[i];
-                idx %= out_stride[i];
-            }
-        } else {
-            for (int i = ndim - 1; i >= 0; --i) {
-                out_coord[i] = idx / out_stride[i];
-                idx %= out_stride[i];
+    // 遍历输出 index, 每个线程持有自己的坐标缓冲
+    const int nthreads = mkl::loop_threads(size_t(total));
+    #pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+    {
+        mkl::scratch<int> out_coord(ndim);
+        mkl::scratch<int> in_coord(ndim);
+        #pragma omp for schedule(static)
+        for (int out_index = 0; out_index < total; ++out_index) {
+            // 解码 output 坐标
+            int idx = out_index;
+            if constexpr (is_c_stly_memory_layout) {
+                for (int i = 0; i < ndim; ++i) {
+                    out_coord[i] = idx / out_stride[i];
+                    idx %= out_stride[i];
+                }
+            } else {
+                for (int i = ndim - 1; i >= 0; --i) {
+                    out_coord[i] = idx / out_stride[i];
+                    idx %= out_stride[i];
+                }
             }
-        }
 
-        // 反 perm 得到输入坐标
-        std::vector<int> in_coord(ndim);
-        for (int i = 0; i < ndim; ++i)
-            in_coord[perm[i]] = out_coord[i];
+            // 反 perm 得到输入坐标
+            for (int i = 0; i < ndim; ++i)
+                in_coord[perm[i]] = out_coord[i];
 
-        // 输入 index
-        int in_index = 0;
-        for (int i = 0; i < ndim; ++i)
-            in_index += in_coord[i] * in_stride[i];
+            // 输入 index
+            int in_index = 0;
+            for (int i = 0; i < ndim; ++i)
+                in_index += in_coord[i] * in_stride[i];
 
-        // 写入输出
-        output[out_index] = convert_callback(input[in_index]);
+            // 写入输出
+            output[out_index] = convert_callback(input[in_index]);
+        }
     }
 }
 
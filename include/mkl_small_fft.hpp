@@ -0,0 +1,362 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_parallel.hpp"
+#include "mkl_trace.hpp"
+#include <array>
+
+//== small fixed-size transforms (N = 2^a 3^b 5^c, meant for 4..64) as template codelets, without a descriptor :
+//   mixed-radix decimation in time, radix 8/4/2/3/5 chosen at compile time, twiddles are constexpr tables.
+//   same conventions as fft_plan<T> : forward is unscaled with exp(-i), backward is normalized by 1/N,
+//   real transforms give the N/2+1 half spectrum (even N through one complex N/2-point transform).
+//
+//   small_fft<T, N>::forward(in, out)              raw pointers, in may alias out
+//   small_fft<T, N>::forward(vec)                  ::vec by value
+//   small_fft<T, N>::forward_inplace(vec)          real : the padded in-place layout ::vec<real, 2 (N/2+1)>
+//   small_fft<T, N>::forward_batch<L>(...)         L independent transforms per register, lane l = transform l.
+//                                                  L = 4 / 8 / 16, the default fills 64 bytes.
+namespace mekil
+{
+    namespace detail
+    {
+        constexpr long double small_fft_pi = 3.141592653589793238462643383279502884L;
+        constexpr long double taylor_cos(long double x)
+        {
+            long double term = 1, sum = 1;
+            for(int i = 1; i < 40; i++){
+                term *= -x * x / ((2 * i - 1) * (2 * i));
+                sum += term;
+            }
+            return sum;
+        }
+        constexpr long double taylor_sin(long double x)
+        {
+            long double term = x, sum = x;
+            for(int i = 1; i < 40; i++){
+                term *= -x * x / ((2 * i) * (2 * i + 1));
+                sum += term;
+            }
+            return sum;
+        }
+        //== a constant complex factor (std::complex and std::pair do not assign in constexpr code before C++20)
+        template<class R> struct root
+        {
+            R re;
+            R im;
+        };
+        //== exp(sign 2 pi i k / n), exact on the quarter turns
+        template<class R> constexpr root<R> unit_root(size_t k, size_t n, int sign)
+        {
+            k %= n;
+            if(0 == (4 * k) % n){
+                constexpr R c[4] = {1, 0, -1, 0};
+                const size_t q = 4 * k / n;
+                return {c[q], R(sign) * c[(q + 3) % 4]};
+            }
+            long double x = 2 * small_fft_pi * static_cast<long double>(k) / static_cast<long double>(n);
+            if(x > small_fft_pi) x -= 2 * small_fft_pi;
+            return {R(taylor_cos(x)), R(sign * taylor_sin(x))};
+        }
+        template<class R, size_t N, bool Forward> struct twiddle_table
+        {
+            static constexpr std::array<root<R>, N> make()
+            {
+                std::array<root<R>, N> w{};
+                for(size_t k = 0; k < N; k++) w[k] = unit_root<R>(k, N, Forward ? -1 : 1);
+                return w;
+            }
+            static constexpr std::array<root<R>, N> w = make();
+        };
+
+        constexpr size_t small_fft_radix(size_t n)
+        {
+            for(size_t r : {8, 4, 2, 3, 5}){
+                if(0 == n % r) return r;
+            }
+            return 0;
+        }
+        constexpr bool small_fft_supported(size_t n)
+        {
+            while(n > 1){
+                const size_t r = small_fft_radix(n);
+                if(0 == r) return false;
+                n /= r;
+            }
+            return true;
+        }
+
+        //== L complex values, one per transform, split in real and imaginary lanes
+        template<class R, size_t L> struct cpack
+        {
+            R re[L];
+            R im[L];
+        };
+        template<class R, size_t L> inline cpack<R, L> operator+(const cpack<R, L>& a, const cpack<R, L>& b)
+        {
+            cpack<R, L> c;
+            #pragma omp simd
+            for(size_t l = 0; l < L; l++){ c.re[l] = a.re[l] + b.re[l]; c.im[l] = a.im[l] + b.im[l]; }
+            return c;
+        }
+        template<class R, size_t L> inline cpack<R, L> operator-(const cpack<R, L>& a, const cpack<R, L>& b)
+        {
+            cpack<R, L> c;
+            #pragma omp simd
+            for(size_t l = 0; l < L; l++){ c.re[l] = a.re[l] - b.re[l]; c.im[l] = a.im[l] - b.im[l]; }
+            return c;
+        }
+        template<class R, size_t L> inline cpack<R, L> mul(const cpack<R, L>& a, const root<R>& w)
+        {
+            cpack<R, L> c;
+            #pragma omp simd
+            for(size_t l = 0; l < L; l++){
+                c.re[l] = a.re[l] * w.re - a.im[l] * w.im;
+                c.im[l] = a.re[l] * w.im + a.im[l] * w.re;
+            }
+            return c;
+        }
+        //== times -i (forward) or +i (backward)
+        template<bool Forward, class R, size_t L> inline cpack<R, L> rotate_quarter(const cpack<R, L>& a)
+        {
+            cpack<R, L> c;
+            #pragma omp simd
+            for(size_t l = 0; l < L; l++){
+                c.re[l] = Forward ? a.im[l] : -a.im[l];
+                c.im[l] = Forward ? -a.re[l] : a.re[l];
+            }
+            return c;
+        }
+
+        //== in-place radix-r DFT of t[0..r)
+        template<size_t r, bool Forward, class R, size_t L> inline void radix_kernel(cpack<R, L>* t)
+        {
+            if constexpr(2 == r){
+                const auto a = t[0];
+                t[0] = a + t[1];
+                t[1] = a - t[1];
+            }
+            else if constexpr(4 == r){
+                const auto s0 = t[0] + t[2], s1 = t[0] - t[2], s2 = t[1] + t[3], s3 = rotate_quarter<Forward>(t[1] - t[3]);
+                t[0] = s0 + s2;
+                t[1] = s1 + s3;
+                t[2] = s0 - s2;
+                t[3] = s1 - s3;
+            }
+            else if constexpr(8 == r){
+                cpack<R, L> e[4] = {t[0], t[2], t[4], t[6]}, o[4] = {t[1], t[3], t[5], t[7]};
+                radix_kernel<4, Forward>(e);
+                radix_kernel<4, Forward>(o);
+                constexpr auto& w = twiddle_table<R, 8, Forward>::w;
+                o[1] = mul(o[1], w[1]);
+                o[2] = rotate_quarter<Forward>(o[2]);
+                o[3] = mul(o[3], w[3]);
+                for(size_t q = 0; q < 4; q++){
+                    t[q] = e[q] + o[q];
+                    t[q + 4] = e[q] - o[q];
+                }
+            }
+            else{
+                //== radix 3 and 5 : direct sums with the constant roots of unity
+                constexpr auto& w = twiddle_table<R, r, Forward>::w;
+                cpack<R, L> x[r];
+                for(size_t q = 0; q < r; q++){
+                    x[q] = t[0];
+                    for(size_t j = 1; j < r; j++) x[q] = x[q] + mul(t[j], w[(j * q) % r]);
+                }
+                for(size_t q = 0; q < r; q++) t[q] = x[q];
+            }
+        }
+
+        //== out[0..N) = DFT of in[0], in[S], ..., in[(N-1) S]
+        template<size_t N, size_t S, bool Forward, class R, size_t L> inline void small_dit(const cpack<R, L>* in, cpack<R, L>* out)
+        {
+            if constexpr(1 == N){
+                out[0] = in[0];
+            }
+            else{
+                constexpr size_t r = small_fft_radix(N), M = N / r;
+                for(size_t j = 0; j < r; j++) small_dit<M, S * r, Forward, R, L>(in + j * S, out + j * M);
+                //== butterflies read and write the same r slots k, k + M, ... so they run in place
+                constexpr auto& w = twiddle_table<R, N, Forward>::w;
+                for(size_t k = 0; k < M; k++){
+                    cpack<R, L> t[r];
+                    t[0] = out[k];
+                    for(size_t j = 1; j < r; j++) t[j] = 0 == k ? out[j * M + k] : mul(out[j * M + k], w[j * k]);
+                    radix_kernel<r, Forward>(t);
+                    for(size_t q = 0; q < r; q++) out[q * M + k] = t[q];
+                }
+            }
+        }
+    }
+
+    template<class T, size_t N> struct small_fft
+    {
+        static_assert(N >= 1 && detail::small_fft_supported(N), "small_fft : N must factor into 2, 3 and 5");
+        using real_type = real_t<T>;
+        using complex_type = complex_t<T>;
+        static constexpr size_t spatial_size = N;
+        static constexpr size_t fourier_size = is_real_v<T> ? N / 2 + 1 : N;
+        //== transforms per register for the batched calls : 64 bytes of real lanes
+        static constexpr size_t simd_lanes = 64 / sizeof(real_type);
+
+        static void forward(const T* in, complex_type* out)
+        {
+            forward_group<1>(in, 0, out, 0, 1);
+        }
+        static void backward(const complex_type* in, T* out)
+        {
+            backward_group<1>(in, 0, out, 0, 1);
+        }
+        static ::vec<complex_type, fourier_size> forward(const ::vec<T, N>& in)
+        {
+            ::vec<complex_type, fourier_size> out;
+            forward(&in[0], &out[0]);
+            return out;
+        }
+        static ::vec<T, N> backward(const ::vec<complex_type, fourier_size>& in)
+        {
+            ::vec<T, N> out;
+            backward(&in[0], &out[0]);
+            return out;
+        }
+        //== complex : in place on N values. real : N values padded to 2 (N/2+1), the in-place layout of cal_fft_memory_layout
+        static void forward_inplace(::vec<T, is_real_v<T> ? 2 * fourier_size : N>& v)
+        {
+            forward(&v[0], reinterpret_cast<complex_type*>(&v[0]));
+        }
+        static void backward_inplace(::vec<T, is_real_v<T> ? 2 * fourier_size : N>& v)
+        {
+            backward(reinterpret_cast<const complex_type*>(&v[0]), &v[0]);
+        }
+
+        //== count transforms, in_distance / out_distance elements apart, L at a time with one transform per lane
+        template<size_t L = simd_lanes> static void forward_batch(const T* in, size_t in_distance, complex_type* out, size_t out_distance, size_t count)
+        {
+            MEKIL_TRACE_SCOPE("fft.small_forward_batch", (sizeof(T) * N + sizeof(complex_type) * fourier_size) * count, N, count);
+            run_batch<L>(count, [&](size_t b, size_t lanes){
+                forward_group<L>(in + b * in_distance, in_distance, out + b * out_distance, out_distance, lanes);
+            });
+        }
+        template<size_t L = simd_lanes> static void backward_batch(const complex_type* in, size_t in_distance, T* out, size_t out_distance, size_t count)
+        {
+            MEKIL_TRACE_SCOPE("fft.small_backward_batch", (sizeof(T) * N + sizeof(complex_type) * fourier_size) * count, N, count);
+            run_batch<L>(count, [&](size_t b, size_t lanes){
+                backward_group<L>(in + b * in_distance, in_distance, out + b * out_distance, out_distance, lanes);
+            });
+        }
+
+    private:
+        //== the real half-spectrum packs even/odd samples into one complex N/2-point transform
+        static constexpr bool packed_real = is_real_v<T> && 0 == N % 2;
+        static constexpr size_t work_size = packed_real ? N / 2 : N;
+        template<size_t L> using pack = detail::cpack<real_type, L>;
+
+        template<size_t L, class Group> static void run_batch(size_t count, Group group)
+        {
+            static_assert(L >= 1);
+            const size_t groups = (count + L - 1) / L;
+            const int nthreads = mkl::loop_threads(count * N);
+            #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+            for(long long g = 0; g < static_cast<long long>(groups); g++){
+                const size_t b = size_t(g) * L;
+                group(b, std::min(L, count - b));
+            }
+        }
+
+        template<size_t L> static void forward_group(const T* in, size_t in_distance, complex_type* out, size_t out_distance, size_t lanes)
+        {
+            pack<L> x[work_size], X[work_size];
+            //== unused lanes compute on zeros and are never stored
+            for(size_t n = 0; n < work_size; n++){
+                for(size_t l = 0; l < L; l++){
+                    real_type re = 0, im = 0;
+                    if(l < lanes){
+                        const T* p = in + l * in_distance;
+                        if constexpr(packed_real){ re = p[2 * n]; im = p[2 * n + 1]; }
+                        else if constexpr(is_real_v<T>){ re = p[n]; }
+                        else{ re = p[n].real(); im = p[n].imag(); }
+                    }
+                    x[n].re[l] = re;
+                    x[n].im[l] = im;
+                }
+            }
+            detail::small_dit<work_size, 1, true>(x, X);
+            if constexpr(packed_real){
+                //== X[k] = (Z[k] + conj Z[M-k]) / 2 - i w^k (Z[k] - conj Z[M-k]) / 2
+                constexpr size_t M = N / 2;
+                constexpr auto& w = detail::twiddle_table<real_type, N, true>::w;
+                for(size_t k = 0; k <= M; k++){
+                    const pack<L>& a = X[k % M];
+                    const pack<L>& b = X[(M - k) % M];
+                    pack<L> e, o;
+                    #pragma omp simd
+                    for(size_t l = 0; l < L; l++){
+                        e.re[l] = real_type(0.5) * (a.re[l] + b.re[l]);
+                        e.im[l] = real_type(0.5) * (a.im[l] - b.im[l]);
+                        o.re[l] = real_type(0.5) * (a.im[l] + b.im[l]);
+                        o.im[l] = real_type(0.5) * (b.re[l] - a.re[l]);
+                    }
+                    const pack<L> y = e + detail::mul(o, w[k]);
+                    for(size_t l = 0; l < lanes; l++) out[l * out_distance + k] = complex_type(y.re[l], y.im[l]);
+                }
+            }
+            else{
+                for(size_t k = 0; k < fourier_size; k++){
+                    for(size_t l = 0; l < lanes; l++) out[l * out_distance + k] = complex_type(X[k].re[l], X[k].im[l]);
+                }
+            }
+        }
+
+        template<size_t L> static void backward_group(const complex_type* in, size_t in_distance, T* out, size_t out_distance, size_t lanes)
+        {
+            pack<L> x[work_size], X[work_size];
+            auto load = [&](size_t k){
+                pack<L> v;
+                for(size_t l = 0; l < L; l++){
+                    const complex_type c = l < lanes ? in[l * in_distance + k] : complex_type(0);
+                    v.re[l] = c.real();
+                    v.im[l] = c.imag();
+                }
+                return v;
+            };
+            if constexpr(packed_real){
+                //== Z[k] = Xe[k] + i Xo[k], Xe = (X[k] + conj X[M-k]) / 2, Xo = w^-k (X[k] - conj X[M-k]) / 2
+                constexpr size_t M = N / 2;
+                constexpr auto& w = detail::twiddle_table<real_type, N, false>::w;
+                for(size_t k = 0; k < M; k++){
+                    const pack<L> a = load(k), b = load(M - k);
+                    pack<L> e, d;
+                    #pragma omp simd
+                    for(size_t l = 0; l < L; l++){
+                        e.re[l] = real_type(0.5) * (a.re[l] + b.re[l]);
+                        e.im[l] = real_type(0.5) * (a.im[l] - b.im[l]);
+                        d.re[l] = real_type(0.5) * (a.re[l] - b.re[l]);
+                        d.im[l] = real_type(0.5) * (a.im[l] + b.im[l]);
+                    }
+                    x[k] = e + detail::rotate_quarter<false>(detail::mul(d, w[k]));
+                }
+            }
+            else if constexpr(is_real_v<T>){
+                //== odd N : the full hermitian spectrum through the complex transform
+                for(size_t k = 0; k < fourier_size; k++) x[k] = load(k);
+                for(size_t k = fourier_size; k < N; k++){
+                    x[k] = x[N - k];
+                    #pragma omp simd
+                    for(size_t l = 0; l < L; l++) x[k].im[l] = -x[k].im[l];
+                }
+            }
+            else{
+                for(size_t k = 0; k < N; k++) x[k] = load(k);
+            }
+            detail::small_dit<work_size, 1, false>(x, X);
+            const real_type scale = real_type(1) / real_type(work_size);
+            for(size_t n = 0; n < work_size; n++){
+                for(size_t l = 0; l < lanes; l++){
+                    T* p = out + l * out_distance;
+                    if constexpr(packed_real){ p[2 * n] = X[n].re[l] * scale; p[2 * n + 1] = X[n].im[l] * scale; }
+                    else if constexpr(is_real_v<T>){ p[n] = X[n].re[l] * scale; }
+                    else{ p[n] = complex_type(X[n].re[l] * scale, X[n].im[l] * scale); }
+                }
+            }
+        }
+    };
+}
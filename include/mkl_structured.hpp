@@ -0,0 +1,217 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_arena.hpp"
+#include "mkl_fft.hpp"
+#include "mkl_vec.hpp"
+#include <map>
+
+//== convolution-structured operators applied in O(n log n) through the DFT.
+//   a (block) circulant matrix is diagonalized by the DFT, its eigenvalues are the DFT of its
+//   generating kernel and y = IDFT(spectrum * DFT(x)).
+//   a (block) Toeplitz matrix is the leading block of a circulant of size >= 2n - 1 per axis.
+//   shapes are row-major like the rest of the library, rank 2 gives BCCB / BTTB matrices.
+//   the operators follow the interface of mkl_operator.hpp, so they plug into mkl_krylov.hpp.
+//   plans and work buffers are cached inside the operator : one operator per thread.
+namespace mkl
+{
+    //== smallest 2^a 3^b 5^c 7^d >= n
+    inline size_t fft_fast_size(size_t n)
+    {
+        for(size_t m = std::max<size_t>(n, 1);; m++){
+            size_t r = m;
+            for(size_t p : {2, 3, 5, 7}) while(0 == r % p) r /= p;
+            if(1 == r) return m;
+        }
+    }
+
+    //== y = g (*) x on a periodic grid of shape `shape`, batched over back-to-back grids
+    template<class T> class fft_convolver
+    {
+    public:
+        using fft_t = mekil::mklFFT<T>;
+        using plan_t = mekil::fft_plan<T>;
+        using spectrum_type = complex_t<T>;
+
+        fft_convolver(std::vector<size_t> shape, const T* generator, size_t max_batch)
+            : shape_(shape.begin(), shape.end()), max_batch_(std::max<size_t>(1, max_batch))
+        {
+            spatial_size_ = product_of(shape_, shape_.back());
+            fourier_size_ = product_of(shape_, fft_t::fourier_fastest_size(shape_.back()));
+            spectrum_.resize(fourier_size_);
+            auto& plans = plans_for(1);
+            aligned_vector<T> g(generator, generator + spatial_size_);
+            plans.first.forward(g.data(), spectrum_.data());
+        }
+        size_t size() const {return spatial_size_;}
+        const aligned_vector<spectrum_type>& spectrum() const {return spectrum_;}
+
+        //== X and Y hold `batch` packed grids, X may alias Y
+        void convolve(const T* X, T* Y, size_t batch, bool adjoint = false) const
+        {
+            for(size_t b0 = 0; b0 < batch; b0 += max_batch_){
+                const size_t nb = std::min(max_batch_, batch - b0);
+                auto& plans = plans_for(nb);
+                work_.resize(fourier_size_ * nb);
+                plans.first.forward(X + b0 * spatial_size_, work_.data());
+                for(size_t b = 0; b < nb; b++){
+                    spectrum_type* w = work_.data() + b * fourier_size_;
+                    if(adjoint) mkl::vec::mul_by_conj<spectrum_type>(fourier_size_, w, spectrum_.data(), w);
+                    else        mkl::vec::mul<spectrum_type>(fourier_size_, w, spectrum_.data(), w);
+                }
+                plans.second.backward(work_.data(), Y + b0 * spatial_size_);
+            }
+        }
+
+    private:
+        using plan_pair = std::pair<plan_t, plan_t>;
+        static size_t product_of(const std::vector<MKL_LONG>& shape, MKL_LONG fastest)
+        {
+            size_t n = fastest;
+            for(size_t i = 0; i + 1 < shape.size(); i++) n *= shape[i];
+            return n;
+        }
+        plan_pair& plans_for(size_t batch) const
+        {
+            auto it = plans_.find(batch);
+            if(it == plans_.end()){
+                it = plans_.emplace(batch, plan_pair(plan_t::directional(shape_, true, int(batch)),
+                                                     plan_t::directional(shape_, false, int(batch)))).first;
+            }
+            return it->second;
+        }
+
+        std::vector<MKL_LONG> shape_;
+        size_t max_batch_;
+        size_t spatial_size_, fourier_size_;
+        aligned_vector<spectrum_type> spectrum_;
+        mutable std::map<size_t, plan_pair> plans_;
+        mutable aligned_vector<spectrum_type> work_;
+    };
+
+    //== (block) circulant : A x = kernel (*) x with periodic boundaries,
+    //   kernel is the first column of A and has the shape of x.
+    template<class T> class circulant_operator
+    {
+    public:
+        using value_type = T;
+
+        circulant_operator(std::vector<size_t> shape, const T* kernel, size_t max_batch = 8)
+            : conv_(shape, kernel, max_batch) {}
+        size_t rows() const {return conv_.size();}
+        size_t cols() const {return conv_.size();}
+        //== eigenvalues of A in DFT order (the half spectrum of the fastest axis for real T)
+        const aligned_vector<complex_t<T>>& eigenvalues() const {return conv_.spectrum();}
+
+        void apply(const T* x, T* y) const {conv_.convolve(x, y, 1);}
+        void apply_adjoint(const T* x, T* y) const {conv_.convolve(x, y, 1, true);}
+        void apply_block(const T* X, size_t ncol, size_t ldx, T* Y, size_t ldy) const
+        {
+            const size_t n = conv_.size();
+            if(ldx == n && ldy == n){
+                conv_.convolve(X, Y, ncol);
+                return;
+            }
+            scratch<T> packed(n * ncol);
+            for(size_t j = 0; j < ncol; j++) std::copy(X + j * ldx, X + j * ldx + n, packed.begin() + j * n);
+            conv_.convolve(packed.data(), packed.data(), ncol);
+            for(size_t j = 0; j < ncol; j++) std::copy(packed.begin() + j * n, packed.begin() + (j + 1) * n, Y + j * ldy);
+        }
+        void operator()(const T* x, T* y) const {apply(x, y);}
+
+    private:
+        fft_convolver<T> conv_;
+    };
+
+    //== (block) Toeplitz : y[i] = sum_j kernel[i - j + (n - 1)] x[j], per axis,
+    //   kernel has shape (2 n_k - 1) and holds the coefficients of the offsets -(n_k - 1) .. n_k - 1.
+    //   in 1D the kernel is [r[n-1] .. r[1], c[0], c[1] .. c[n-1]] for first column c and first row r.
+    template<class T> class toeplitz_operator
+    {
+    public:
+        using value_type = T;
+
+        toeplitz_operator(std::vector<size_t> shape, const T* kernel, size_t max_batch = 8)
+            : shape_(shape), padded_(fast_padded_shape(shape)), conv_(padded_, embed_kernel(shape, padded_, kernel).data(), max_batch)
+        {
+            size_ = 1;
+            for(size_t n : shape_) size_ *= n;
+        }
+        static toeplitz_operator from_column_row(size_t n, const T* column, const T* row, size_t max_batch = 8)
+        {
+            std::vector<T> kernel(2 * n - 1);
+            for(size_t i = 1; i < n; i++) kernel[n - 1 - i] = row[i];
+            for(size_t i = 0; i < n; i++) kernel[n - 1 + i] = column[i];
+            return toeplitz_operator({n}, kernel.data(), max_batch);
+        }
+        size_t rows() const {return size_;}
+        size_t cols() const {return size_;}
+        const std::vector<size_t>& padded_shape() const {return padded_;}
+
+        void apply(const T* x, T* y) const {apply_block(x, 1, size_, y, size_);}
+        void apply_block(const T* X, size_t ncol, size_t ldx, T* Y, size_t ldy) const
+        {
+            const size_t m = conv_.size();
+            work_.assign(m * ncol, T(0));
+            for(size_t j = 0; j < ncol; j++) transfer(X + j * ldx, work_.data() + j * m, true);
+            conv_.convolve(work_.data(), work_.data(), ncol);
+            for(size_t j = 0; j < ncol; j++) transfer(work_.data() + j * m, Y + j * ldy, false);
+        }
+        void operator()(const T* x, T* y) const {apply(x, y);}
+
+    private:
+        static std::vector<size_t> fast_padded_shape(const std::vector<size_t>& shape)
+        {
+            std::vector<size_t> padded(shape.size());
+            for(size_t k = 0; k < shape.size(); k++) padded[k] = fft_fast_size(2 * shape[k] - 1);
+            return padded;
+        }
+        //== offset d of axis k lands on index d mod L_k of the circulant generator
+        static std::vector<T> embed_kernel(const std::vector<size_t>& shape, const std::vector<size_t>& padded, const T* kernel)
+        {
+            const size_t rank = shape.size();
+            size_t kernel_size = 1, padded_size = 1;
+            for(size_t k = 0; k < rank; k++){
+                kernel_size *= 2 * shape[k] - 1;
+                padded_size *= padded[k];
+            }
+            std::vector<T> generator(padded_size, T(0));
+            std::vector<size_t> idx(rank, 0);
+            for(size_t i = 0; i < kernel_size; i++){
+                size_t dst = 0;
+                for(size_t k = 0; k < rank; k++){
+                    const long long d = static_cast<long long>(idx[k]) - static_cast<long long>(shape[k] - 1);
+                    dst = dst * padded[k] + static_cast<size_t>(d < 0 ? d + static_cast<long long>(padded[k]) : d);
+                }
+                generator[dst] = kernel[i];
+                for(size_t k = rank; k-- > 0;){
+                    if(++idx[k] < 2 * shape[k] - 1) break;
+                    idx[k] = 0;
+                }
+            }
+            return generator;
+        }
+        //== copy the n-shaped block between a packed vector and the corner of a padded grid
+        void transfer(const T* from, T* to, bool embed) const
+        {
+            const size_t rank = shape_.size();
+            const size_t row = shape_.back();
+            const size_t rows = size_ / row;
+            std::vector<size_t> idx(rank, 0);
+            for(size_t r = 0; r < rows; r++){
+                size_t offset = 0;
+                for(size_t k = 0; k < rank; k++) offset = offset * padded_[k] + idx[k];
+                if(embed) std::copy(from + r * row, from + (r + 1) * row, to + offset);
+                else      std::copy(from + offset, from + offset + row, to + r * row);
+                for(size_t k = rank - 1; k-- > 0;){
+                    if(++idx[k] < shape_[k]) break;
+                    idx[k] = 0;
+                }
+            }
+        }
+
+        std::vector<size_t> shape_, padded_;
+        size_t size_;
+        fft_convolver<T> conv_;
+        mutable aligned_vector<T> work_;
+    };
+}
@@ -0,0 +1,295 @@
+#pragma once
+#include "mkl_basic_operator.h"
+#include "mkl_parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//== work-stealing scheduler for many small independent jobs (small FFTs, crops, integral images) :
+//   one deque per worker, the owner pushes and pops at the back (newest first, warm caches),
+//   idle workers steal from the front of a random victim (oldest first, the biggest remaining work).
+//   tasks spawned from a non-worker thread go to a shared injection queue.
+//
+//   inside a task the library runs on the worker thread : MKL is set sequential on every worker
+//   (mkl_set_num_threads_local) and loop_threads returns 1. scratch memory comes from the thread-local
+//   arena of the worker and mekil::cached_plan keeps one descriptor per layout and worker.
+//
+//   task_group is the fork-join unit : spawn adds a task (tasks may spawn further tasks into their
+//   own group or a new one), wait runs pending tasks until the group is empty, then rethrows the
+//   first exception a task of the group threw.
+//
+//       mkl::task_group g;
+//       for(auto& job : jobs) g.spawn([&job]{ job.run(); });
+//       g.wait();
+namespace mkl
+{
+    class task_group;
+
+    class task_scheduler
+    {
+    public:
+        //== num_threads 0 : max_threads() of the current execution policy
+        explicit task_scheduler(int num_threads = 0)
+        {
+            const int n = num_threads > 0 ? num_threads : std::max(1, max_threads());
+            workers_.reserve(n);
+            for(int i = 0; i < n; i++) workers_.push_back(std::make_unique<worker>());
+            for(int i = 0; i < n; i++) workers_[i]->thread = std::thread([this, i]{ run_worker(i); });
+        }
+        ~task_scheduler()
+        {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex_);
+                stop_ = true;
+            }
+            sleep_cv_.notify_all();
+            for(auto& w : workers_) w->thread.join();
+        }
+        task_scheduler(const task_scheduler&) = delete;
+        task_scheduler& operator=(const task_scheduler&) = delete;
+
+        int size() const {return int(workers_.size());}
+        //== index of the calling worker of this scheduler, -1 for any other thread
+        int worker_index() const {return this == current().scheduler ? current().index : -1;}
+
+        //== process-wide scheduler used by task_group by default
+        static task_scheduler& global()
+        {
+            static task_scheduler scheduler;
+            return scheduler;
+        }
+
+    private:
+        friend class task_group;
+        struct task
+        {
+            std::function<void()> run;
+            task_group* group;
+        };
+        struct worker
+        {
+            std::mutex mutex;
+            std::deque<task> tasks;
+            std::thread thread;
+        };
+        struct thread_state
+        {
+            const task_scheduler* scheduler = nullptr;
+            int index = -1;
+            uint64_t seed = 0x2545f4914f6cdd1dull;
+        };
+        static thread_state& current()
+        {
+            thread_local thread_state state;
+            return state;
+        }
+
+        void push(task t)
+        {
+            const int self = worker_index();
+            if(self >= 0){
+                std::lock_guard<std::mutex> lock(workers_[self]->mutex);
+                workers_[self]->tasks.push_back(std::move(t));
+            }
+            else{
+                std::lock_guard<std::mutex> lock(injection_mutex_);
+                injection_.push_back(std::move(t));
+            }
+            queued_.fetch_add(1, std::memory_order_release);
+            //== the sleep mutex orders the counter against a worker about to sleep
+            { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+            sleep_cv_.notify_one();
+        }
+        bool pop(task& t)
+        {
+            const int self = worker_index();
+            if(self >= 0){
+                worker& w = *workers_[self];
+                std::lock_guard<std::mutex> lock(w.mutex);
+                if(!w.tasks.empty()){
+                    t = std::move(w.tasks.back());
+                    w.tasks.pop_back();
+                    return taken();
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(injection_mutex_);
+                if(!injection_.empty()){
+                    t = std::move(injection_.front());
+                    injection_.pop_front();
+                    return taken();
+                }
+            }
+            //== steal : victims in a random rotation so thieves spread out
+            const size_t n = workers_.size();
+            uint64_t& seed = current().seed;
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            const size_t start = size_t(seed % n);
+            for(size_t k = 0; k < n; k++){
+                const size_t v = (start + k) % n;
+                if(int(v) == self) continue;
+                worker& w = *workers_[v];
+                std::lock_guard<std::mutex> lock(w.mutex);
+                if(!w.tasks.empty()){
+                    t = std::move(w.tasks.front());
+                    w.tasks.pop_front();
+                    return taken();
+                }
+            }
+            return false;
+        }
+        bool taken()
+        {
+            queued_.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+        //== one pending task on the calling thread, false when every queue is empty
+        bool run_one();
+        static void execute(task& t);
+        //== sleep until done() or until a task is queued : waiters sleep with the idle workers,
+        //   so a waiting worker still picks up the tasks its group depends on
+        template<class P> void idle_wait(P done)
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_cv_.wait(lock, [&]{ return done() || queued_.load(std::memory_order_acquire) > 0; });
+        }
+        void wake_all()
+        {
+            { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+            sleep_cv_.notify_all();
+        }
+
+        void run_worker(int index)
+        {
+            auto& state = current();
+            state.scheduler = this;
+            state.index = index;
+            state.seed = 0x9e3779b97f4a7c15ull * uint64_t(index + 1);
+            in_task_worker() = true;
+            mkl_set_num_threads_local(1);
+            while(true){
+                if(run_one()) continue;
+                std::unique_lock<std::mutex> lock(sleep_mutex_);
+                sleep_cv_.wait(lock, [&]{ return stop_ || queued_.load(std::memory_order_acquire) > 0; });
+                if(stop_ && 0 == queued_.load(std::memory_order_acquire)) return;
+            }
+        }
+
+        std::vector<std::unique_ptr<worker>> workers_;
+        std::mutex injection_mutex_;
+        std::deque<task> injection_;
+        std::atomic<size_t> queued_{0};
+        std::mutex sleep_mutex_;
+        std::condition_variable sleep_cv_;
+        bool stop_ = false;
+    };
+
+    class task_group
+    {
+    public:
+        explicit task_group(task_scheduler& scheduler = task_scheduler::global()) : scheduler_(scheduler) {}
+        ~task_group()
+        {
+            //== tasks hold a pointer to the group : never leave them running
+            try{ wait(); } catch(...){}
+        }
+        task_group(const task_group&) = delete;
+        task_group& operator=(const task_group&) = delete;
+
+        template<class F> void spawn(F&& f)
+        {
+            pending_.fetch_add(1, std::memory_order_relaxed);
+            scheduler_.push({std::function<void()>(std::forward<F>(f)), this});
+        }
+        //== the waiting thread runs tasks too (its own deque first when it is a worker),
+        //   with nothing to run it sleeps until the group is done or new tasks arrive
+        void wait()
+        {
+            while(pending_.load(std::memory_order_acquire) > 0){
+                if(scheduler_.run_one()) continue;
+                scheduler_.idle_wait([this]{ return 0 == pending_.load(std::memory_order_acquire); });
+            }
+            std::exception_ptr error;
+            {
+                std::lock_guard<std::mutex> lock(error_mutex_);
+                std::swap(error, error_);
+            }
+            if(error) std::rethrow_exception(error);
+        }
+        task_scheduler& scheduler() const {return scheduler_;}
+
+    private:
+        friend class task_scheduler;
+        void finish(std::exception_ptr error)
+        {
+            if(error){
+                std::lock_guard<std::mutex> lock(error_mutex_);
+                if(!error_) error_ = error;
+            }
+            //== the group may be gone as soon as the count reaches zero : only the scheduler is touched after
+            task_scheduler& scheduler = scheduler_;
+            if(1 == pending_.fetch_sub(1, std::memory_order_acq_rel)) scheduler.wake_all();
+        }
+
+        task_scheduler& scheduler_;
+        std::atomic<size_t> pending_{0};
+        std::mutex error_mutex_;
+        std::exception_ptr error_;
+    };
+
+    inline void task_scheduler::execute(task& t)
+    {
+        std::exception_ptr error;
+        try{
+            t.run();
+        }
+        catch(...){
+            error = std::current_exception();
+        }
+        t.group->finish(error);
+    }
+    inline bool task_scheduler::run_one()
+    {
+        task t;
+        if(!pop(t)) return false;
+        if(worker_index() >= 0){
+            execute(t);
+            return true;
+        }
+        //== a helping outside thread runs the task under the worker settings
+        const bool was_inside = in_task_worker();
+        in_task_worker() = true;
+        {
+            scoped_mkl_threads sequential(1);
+            execute(t);
+        }
+        in_task_worker() = was_inside;
+        return true;
+    }
+
+    //== f(i) for i in [begin, end) : ranges are halved into subtasks down to `grain` indices,
+    //   so idle workers steal the large halves and uneven iterations balance themselves
+    template<class F> inline void parallel_tasks(size_t begin, size_t end, F f, size_t grain = 1, task_scheduler& scheduler = task_scheduler::global())
+    {
+        if(begin >= end) return;
+        grain = std::max<size_t>(grain, 1);
+        task_group group(scheduler);
+        std::function<void(size_t, size_t)> split = [&](size_t b, size_t e){
+            while(e - b > grain){
+                const size_t m = b + (e - b) / 2;
+                group.spawn([&split, m, e]{ split(m, e); });
+                e = m;
+            }
+            for(size_t i = b; i < e; i++) f(i);
+        };
+        split(begin, end);
+        group.wait();
+    }
+}
@@ -0,0 +1,296 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+//== hot-path instrumentation, compiled in only with MEKIL_ENABLE_TRACE (cmake -DMEKIL_TRACE=ON).
+//   without it MEKIL_TRACE_SCOPE expands to nothing : arguments are not even evaluated.
+//
+//   MEKIL_TRACE_SCOPE(name, bytes, d0, d1, d2) times the enclosing scope and records the bytes
+//   it moves and up to three extents. `name` must be a string literal.
+//   every thread appends to its own buffer (single writer, no lock) and keeps per-(name, shape) totals,
+//   so counts stay exact when the buffer is full. the buffer grows by chunks of `chunk_events` up to
+//   the capacity : a thread that traces a few calls holds one chunk, not the whole capacity.
+//   the totals live in a fixed open-addressing table of `shape_slots` entries allocated with the
+//   buffer, so recording never allocates for them; shapes past a full table are summed under "(other)".
+//   export (chrome_trace / summary) reads all buffers and must not race with traced calls.
+//   buffers of exited threads are kept for export until print_summary (events) or clear (everything).
+namespace mkl::trace
+{
+    struct event
+    {
+        const char* name;
+        uint64_t begin_ns, end_ns;
+        uint64_t bytes;
+        uint64_t dims[3];
+    };
+    struct totals
+    {
+        uint64_t count = 0, nanoseconds = 0, bytes = 0;
+    };
+    using shape_key = std::tuple<std::string, uint64_t, uint64_t, uint64_t>;
+
+    inline uint64_t now_ns()
+    {
+        using namespace std::chrono;
+        return uint64_t(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    //== i-th extent of a shape container, 0 past its end
+    template<class V> uint64_t extent(const V& shape, size_t i)
+    {
+        return i < shape.size() ? uint64_t(shape[i]) : 0;
+    }
+
+    constexpr size_t chunk_events = 1024;
+    constexpr size_t shape_slots = 256;     // power of two
+
+    //== per-(name, shape) totals of a thread, name == nullptr : free slot
+    struct shape_totals
+    {
+        const char* name = nullptr;
+        uint64_t dims[3] = {0, 0, 0};
+        totals t;
+    };
+
+    struct thread_buffer
+    {
+        explicit thread_buffer(uint32_t id, size_t capacity) : tid(id), capacity(capacity), shapes(new shape_totals[shape_slots]) {}
+        uint32_t tid;
+        size_t capacity;
+        std::vector<std::unique_ptr<event[]>> chunks;
+        std::atomic<size_t> count{0};
+        std::atomic<bool> exited{false};
+        uint64_t dropped = 0;
+        std::unique_ptr<shape_totals[]> shapes;
+        totals other;           // shapes that found the table full
+
+        //== totals of (name, d0, d1, d2) : linear probing from a hash of the name pointer and the extents
+        totals& shape(const char* name, uint64_t d0, uint64_t d1, uint64_t d2)
+        {
+            uint64_t h = uint64_t(reinterpret_cast<uintptr_t>(name)) * 0x9E3779B97F4A7C15ull;
+            h = (h ^ d0) * 0x9E3779B97F4A7C15ull;
+            h = (h ^ d1) * 0x9E3779B97F4A7C15ull;
+            h = (h ^ d2) * 0x9E3779B97F4A7C15ull;
+            for(size_t probe = 0, i = size_t(h >> 32); probe < shape_slots; probe++, i++){
+                shape_totals& e = shapes[i & (shape_slots - 1)];
+                if(nullptr == e.name){
+                    e.name = name;
+                    e.dims[0] = d0;
+                    e.dims[1] = d1;
+                    e.dims[2] = d2;
+                    return e.t;
+                }
+                if(e.name == name && e.dims[0] == d0 && e.dims[1] == d1 && e.dims[2] == d2) return e.t;
+            }
+            return other;
+        }
+        void clear_shapes()
+        {
+            std::fill(shapes.get(), shapes.get() + shape_slots, shape_totals{});
+            other = {};
+        }
+
+        const event& at(size_t i) const {return chunks[i / chunk_events][i % chunk_events];}
+        //== events held for export
+        size_t size() const {return std::min(count.load(std::memory_order_acquire), chunks.size() * chunk_events);}
+        void release_events()
+        {
+            chunks.clear();
+            chunks.shrink_to_fit();
+        }
+    };
+
+    namespace detail
+    {
+        struct registry
+        {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<thread_buffer>> buffers;    // kept after thread exit for export
+            uint32_t next_tid = 0;
+            std::atomic<size_t> capacity{size_t(1) << 16};
+            std::atomic<bool> enabled{true};
+            const uint64_t origin_ns = now_ns();
+        };
+        inline registry& global()
+        {
+            static registry r;
+            return r;
+        }
+        //== marks the buffer of the thread as exited when the thread ends
+        struct thread_handle
+        {
+            std::shared_ptr<thread_buffer> buffer;
+            ~thread_handle() {buffer->exited = true;}
+        };
+        inline thread_buffer& local()
+        {
+            static thread_local thread_handle handle{[]{
+                auto& r = global();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                auto b = std::make_shared<thread_buffer>(r.next_tid++, r.capacity.load());
+                r.buffers.push_back(b);
+                return b;
+            }()};
+            return *handle.buffer;
+        }
+    }
+
+    //== events per thread buffer, applies to threads that have not traced yet
+    inline void set_capacity(size_t events) {detail::global().capacity = events;}
+    //== runtime switch for builds with tracing compiled in
+    inline void set_enabled(bool on) {detail::global().enabled = on;}
+    inline bool enabled() {return detail::global().enabled.load(std::memory_order_relaxed);}
+
+    inline void record(const char* name, uint64_t begin_ns, uint64_t end_ns, uint64_t bytes, uint64_t d0, uint64_t d1, uint64_t d2)
+    {
+        thread_buffer& b = detail::local();
+        totals& t = b.shape(name, d0, d1, d2);
+        t.count++;
+        t.nanoseconds += end_ns - begin_ns;
+        t.bytes += bytes;
+        const size_t i = b.count.load(std::memory_order_relaxed);
+        if(i >= b.capacity){
+            b.dropped++;
+            return;
+        }
+        if(i / chunk_events == b.chunks.size()) b.chunks.emplace_back(new event[std::min(chunk_events, b.capacity - i)]);
+        b.chunks[i / chunk_events][i % chunk_events] = event{name, begin_ns, end_ns, bytes, {d0, d1, d2}};
+        b.count.store(i + 1, std::memory_order_release);
+    }
+
+    class scope
+    {
+    public:
+        scope(const char* name, uint64_t bytes = 0, uint64_t d0 = 0, uint64_t d1 = 0, uint64_t d2 = 0)
+            : name_(enabled() ? name : nullptr), bytes_(bytes), dims_{d0, d1, d2}, begin_(name_ ? now_ns() : 0) {}
+        scope(const char* name, uint64_t bytes, const std::array<uint64_t, 3>& dims) : scope(name, bytes, dims[0], dims[1], dims[2]) {}
+        ~scope()
+        {
+            if(name_) record(name_, begin_, now_ns(), bytes_, dims_[0], dims_[1], dims_[2]);
+        }
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+    private:
+        const char* name_;
+        uint64_t bytes_;
+        uint64_t dims_[3];
+        uint64_t begin_;
+    };
+
+    //== drop every recorded event and total, buffers of exited threads are released
+    inline void clear()
+    {
+        auto& r = detail::global();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.erase(std::remove_if(r.buffers.begin(), r.buffers.end(), [](auto& b){ return b->exited.load(); }), r.buffers.end());
+        for(auto& b : r.buffers){
+            b->count = 0;
+            b->dropped = 0;
+            b->clear_shapes();
+            b->release_events();
+        }
+    }
+
+    inline std::string shape_string(const uint64_t* dims)
+    {
+        std::string s;
+        for(int i = 0; i < 3 && dims[i]; i++) s += (i ? "x" : "") + std::to_string(dims[i]);
+        return s;
+    }
+
+    //== Chrome trace-event JSON (chrome://tracing, Perfetto) : one complete event per traced call
+    inline std::string chrome_trace()
+    {
+        auto& r = detail::global();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::string out = "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+        bool first = true;
+        char line[512];
+        for(auto& b : r.buffers){
+            const size_t n = b->size();
+            for(size_t i = 0; i < n; i++){
+                const event& e = b->at(i);
+                std::snprintf(line, sizeof(line),
+                    "%s{\"name\": \"%s\", \"cat\": \"mekil\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, "
+                    "\"args\": {\"bytes\": %llu, \"shape\": \"%s\"}}",
+                    first ? "" : ",\n", e.name, b->tid, (e.begin_ns - r.origin_ns) * 1e-3, (e.end_ns - e.begin_ns) * 1e-3,
+                    (unsigned long long)e.bytes, shape_string(e.dims).c_str());
+                out += line;
+                first = false;
+            }
+        }
+        out += "\n]}\n";
+        return out;
+    }
+    inline bool write_chrome_trace(const std::string& path)
+    {
+        FILE* f = std::fopen(path.c_str(), "w");
+        if(nullptr == f) return false;
+        const std::string json = chrome_trace();
+        const bool ok = json.size() == std::fwrite(json.data(), 1, json.size(), f);
+        return 0 == std::fclose(f) && ok;
+    }
+
+    //== totals of every thread merged per (name, shape)
+    inline std::map<shape_key, totals> summary()
+    {
+        auto& r = detail::global();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::map<shape_key, totals> merged;
+        auto add = [&](const shape_key& key, const totals& t){
+            auto& m = merged[key];
+            m.count += t.count;
+            m.nanoseconds += t.nanoseconds;
+            m.bytes += t.bytes;
+        };
+        for(auto& b : r.buffers){
+            for(size_t i = 0; i < shape_slots; i++){
+                const shape_totals& e = b->shapes[i];
+                if(e.name) add({e.name, e.dims[0], e.dims[1], e.dims[2]}, e.t);
+            }
+            if(b->other.count) add({"(other)", 0, 0, 0}, b->other);
+        }
+        return merged;
+    }
+    //== the summary is the end-of-run report : afterwards the events of exited threads are released
+    //   (their totals stay in summary, chrome_trace no longer holds them)
+    inline void print_summary(FILE* out = stdout)
+    {
+        const auto merged = summary();
+        std::fprintf(out, "%-28s %-16s %10s %12s %12s %10s\n", "name", "shape", "calls", "total(ms)", "mean(us)", "GB/s");
+        for(auto& [key, t] : merged){
+            const uint64_t dims[3] = {std::get<1>(key), std::get<2>(key), std::get<3>(key)};
+            const double seconds = t.nanoseconds * 1e-9;
+            std::fprintf(out, "%-28s %-16s %10llu %12.3f %12.3f %10.2f\n", std::get<0>(key).c_str(), shape_string(dims).c_str(),
+                (unsigned long long)t.count, seconds * 1e3, seconds * 1e6 / double(std::max<uint64_t>(t.count, 1)),
+                seconds > 0 ? t.bytes / seconds * 1e-9 : 0.0);
+        }
+        auto& r = detail::global();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        uint64_t dropped = 0;
+        for(auto& b : r.buffers){
+            dropped += b->dropped;
+            if(b->exited) b->release_events();
+        }
+        if(dropped) std::fprintf(out, "%llu events beyond the buffer capacity are counted but not in the trace\n", (unsigned long long)dropped);
+    }
+}
+
+#define MEKIL_TRACE_CONCAT_IMPL(a, b) a##b
+#define MEKIL_TRACE_CONCAT(a, b) MEKIL_TRACE_CONCAT_IMPL(a, b)
+#ifdef MEKIL_ENABLE_TRACE
+#   define MEKIL_TRACE_SCOPE(...) ::mkl::trace::scope MEKIL_TRACE_CONCAT(mekil_trace_scope_, __LINE__)(__VA_ARGS__)
+#else
+#   define MEKIL_TRACE_SCOPE(...) ((void)0)
+#endif
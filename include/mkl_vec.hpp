@@ -1,10 +1,12 @@
 #pragma once
 #include "mkl_basic_operator.h"
+#include "mkl_trace.hpp"
 
 namespace mkl::vec
 {
     template<class T> inline void add(int n, const T*a, const T*b, T* y)
     {
+        MEKIL_TRACE_SCOPE("vec.add", 3 * sizeof(T) * size_t(n), size_t(n));
         VEC_REPEAT_CODE(T, Add, n, reinterpret_cast<const mkl_t<T>*>(a), reinterpret_cast<const mkl_t<T>*>(b), reinterpret_cast<mkl_t<T>*>(y));
     }
     template <typename T> void self_add(const int n, const T *x, T *y)
@@ -14,6 +16,7 @@ namespace mkl::vec
     }
     template<class T> inline void sub(int n, const T*a, const T*b, T* y)
     {
+        MEKIL_TRACE_SCOPE("vec.sub", 3 * sizeof(T) * size_t(n), size_t(n));
         VEC_REPEAT_CODE(T, Sub, n, reinterpret_cast<const mkl_t<T>*>(a), reinterpret_cast<const mkl_t<T>*>(b), reinterpret_cast<mkl_t<T>*>(y));
     }
     template <typename T> void self_sub(const int n, const T *x, T *y)
@@ -22,6 +25,7 @@ namespace mkl::vec
     }
     template<class T> inline void mul(int n, const T*a, const T*b, T* y)
     {
+        MEKIL_TRACE_SCOPE("vec.mul", 3 * sizeof(T) * size_t(n), size_t(n));
         VEC_REPEAT_CODE(T, Mul, n, reinterpret_cast<const mkl_t<T>*>(a), reinterpret_cast<const mkl_t<T>*>(b), reinterpret_cast<mkl_t<T>*>(y));
     }
     template <typename T> void self_mul(const int n, const T *x, T *y)
@@ -30,12 +34,21 @@ namespace mkl::vec
     }
     template<class T> inline void div(int n, const T*a, const T*b, T* y)
     {
+        MEKIL_TRACE_SCOPE("vec.div", 3 * sizeof(T) * size_t(n), size_t(n));
         VEC_REPEAT_CODE(T, Div, n, reinterpret_cast<const mkl_t<T>*>(a), reinterpret_cast<const mkl_t<T>*>(b), reinterpret_cast<mkl_t<T>*>(y));
     }
     template <typename T> void self_div(const int n, const T *x, T *y)
     {
         div(n, x, y, y);
     }
+    //== y = a * conj(b), complex types only
+    template<class T> inline void mul_by_conj(int n, const T*a, const T*b, T* y)
+    {
+        static_assert(is_complex_v<T>);
+        MEKIL_TRACE_SCOPE("vec.mul_by_conj", 3 * sizeof(T) * size_t(n), size_t(n));
+        if constexpr(is_c<T>) vcMulByConj(n, reinterpret_cast<const mkl_t<T>*>(a), reinterpret_cast<const mkl_t<T>*>(b), reinterpret_cast<mkl_t<T>*>(y));
+        else                  vzMulByConj(n, reinterpret_cast<const mkl_t<T>*>(a), reinterpret_cast<const mkl_t<T>*>(b), reinterpret_cast<mkl_t<T>*>(y));
+    }
     template<class T> inline void add(int n, const T a, T* x)
     {
         //== TODO :SIMD
@@ -55,14 +68,17 @@ namespace mkl::vec
     }
     template<class T> inline void mul(int n, const T a, T* x, std::enable_if_t<is_real_v<T>, int> inc = 1)
     {
+        MEKIL_TRACE_SCOPE("vec.scale", 2 * sizeof(T) * size_t(n), size_t(n));
         CBLAS_REPEAT_CODE(T, scal, n, a, x, inc);
     }
     template<class T> inline void mul(int n, const T a, T* x, std::enable_if_t<is_complex_v<T>, int> inc = 1)
     {
+        MEKIL_TRACE_SCOPE("vec.scale", 2 * sizeof(T) * size_t(n), size_t(n));
         CBLAS_REPEAT_CODE(T, scal, n, &a, x, inc);
     }
     template<class T> inline void div(int n, const T a, T* x, int inc = 1)
     {
+        MEKIL_TRACE_SCOPE("vec.scale", 2 * sizeof(T) * size_t(n), size_t(n));
         CBLAS_REPEAT_CODE(T, scal, n, (T(1)/a), x, inc);
     }
 };
@@ -0,0 +1,17 @@
+//== AVX-512 (F/BW/DQ/VL) kernels
+#include "backend_kernels.hpp"
+#ifdef MEKIL_BACKEND_X86
+#   if defined(__clang__)
+#       pragma clang attribute push(__attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma"))), apply_to = function)
+#   else
+#       pragma GCC push_options
+#       pragma GCC target("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma")
+#   endif
+#   define MEKIL_BACKEND_ISA avx512
+#   include "backend_kernels.inl"
+#   if defined(__clang__)
+#       pragma clang attribute pop
+#   else
+#       pragma GCC pop_options
+#   endif
+#endif
@@ -0,0 +1,4 @@
+//== baseline kernels, compiled with the default flags of the build
+#include "backend_kernels.hpp"
+#define MEKIL_BACKEND_ISA generic
+#include "backend_kernels.inl"
@@ -0,0 +1,28 @@
+#pragma once
+#include <cpu_backend.hpp>
+#include <mkl_parallel.hpp>
+#include <mkl_intergral.hpp>
+#include <algorithm>
+
+//== private to libmekil : every instruction set gets its own copy of the kernels
+//   (backend_kernels.inl) in namespace mekil::kernels::<isa>, compiled under a target pragma
+//   so only the kernels use the wider instructions and no inline function is shared across sets.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#   define MEKIL_BACKEND_X86 1
+#endif
+
+#define MEKIL_DECLARE_BACKEND(isa)                          \
+    namespace mekil::kernels::isa                           \
+    {                                                       \
+        void fill(cpu_backend<float>& table);               \
+        void fill(cpu_backend<double>& table);              \
+        void fill(cpu_backend<complex_t<float>>& table);    \
+        void fill(cpu_backend<complex_t<double>>& table);   \
+    }
+
+MEKIL_DECLARE_BACKEND(generic)
+#ifdef MEKIL_BACKEND_X86
+MEKIL_DECLARE_BACKEND(sse42)
+MEKIL_DECLARE_BACKEND(avx2)
+MEKIL_DECLARE_BACKEND(avx512)
+#endif
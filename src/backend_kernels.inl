@@ -0,0 +1,120 @@
+//== included by backend_<isa>.cpp with MEKIL_BACKEND_ISA naming the instruction set.
+//   the loops follow mkl_intergral.hpp and mkl_vec.hpp, written so the compiler can
+//   vectorize them with whatever the active target allows.
+#ifndef MEKIL_BACKEND_ISA
+#   error "define MEKIL_BACKEND_ISA before including backend_kernels.inl"
+#endif
+
+namespace mekil::kernels::MEKIL_BACKEND_ISA
+{
+    template<class T> void vt_add(int n, const T* x, T* y)
+    {
+        const int nthreads = mkl::loop_threads(size_t(std::max(n, 0)));
+        #pragma omp parallel for simd schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(int i = 0; i < n; i++) y[i] += x[i];
+    }
+    //== running sum along x, one row per iteration
+    template<class T> void integral_x(vec2<size_t> shape, T* image)
+    {
+        const auto [ysize, xsize] = shape;
+        const int nthreads = mkl::loop_threads(ysize * xsize);
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long y = 0; y < static_cast<long long>(ysize); y++){
+            T* p = image + size_t(y) * xsize;
+            for(size_t x = 1; x < xsize; x++) p[x] += p[x - 1];
+        }
+    }
+    //== running sum along y over column strips that stay in L1, one strip per iteration
+    template<class T> void integral_y(vec2<size_t> shape, T* image)
+    {
+        const auto [ysize, xsize] = shape;
+        if(0 == ysize || 0 == xsize) return;
+        constexpr size_t strip = std::max<size_t>(1, mkl::integral_strip_bytes / sizeof(T));
+        const long long nstrip = static_cast<long long>((xsize + strip - 1) / strip);
+        const int nthreads = mkl::loop_threads(ysize * xsize);
+        #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+        for(long long s = 0; s < nstrip; s++){
+            const size_t x0 = size_t(s) * strip;
+            const size_t w  = std::min(strip, xsize - x0);
+            T* p = image + x0;
+            for(size_t y = 1; y < ysize; y++){
+                const T* prev = p;
+                p += xsize;
+                #pragma omp simd
+                for(size_t x = 0; x < w; x++) p[x] += prev[x];
+            }
+        }
+    }
+    //== fused summed-area table of mkl::integral_xy : row blocks integrated in one pass each,
+    //   then the bottom rows of the preceding blocks carried into the following ones
+    template<class T> void integral_xy(vec2<size_t> shape, T* image)
+    {
+        const auto [ysize, xsize] = shape;
+        if(0 == ysize || 0 == xsize) return;
+        auto block_op = [xsize](T* p, size_t rows){
+            T running = T(0);
+            for(size_t x = 0; x < xsize; x++){
+                running += p[x];
+                p[x] = running;
+            }
+            for(size_t y = 1; y < rows; y++){
+                const T* prev = p;
+                p += xsize;
+                running = T(0);
+                for(size_t x = 0; x < xsize; x++){
+                    running += p[x];
+                    p[x] = running + prev[x];
+                }
+            }
+        };
+        int nblock = static_cast<int>(std::min<size_t>(mkl::loop_threads(ysize * xsize), ysize));
+        if(1 == nblock){
+            block_op(image, ysize);
+            return;
+        }
+        const size_t rows_per_block = (ysize + nblock - 1) / nblock;
+        nblock = static_cast<int>((ysize + rows_per_block - 1) / rows_per_block);
+        auto block_begin = [&](int b){ return size_t(b) * rows_per_block; };
+        auto block_end   = [&](int b){ return std::min(ysize, block_begin(b) + rows_per_block); };
+
+        mkl::scratch<T> carry(size_t(nblock) * xsize);
+        #pragma omp parallel num_threads(nblock)
+        {
+            #pragma omp for schedule(static)
+            for(int b = 0; b < nblock; b++){
+                block_op(image + block_begin(b) * xsize, block_end(b) - block_begin(b));
+            }
+            //== carry[b] = sum of the bottom rows of blocks [0, b)
+            #pragma omp single
+            {
+                std::fill(carry.data(), carry.data() + xsize, T(0));
+                for(int b = 1; b < nblock; b++){
+                    const T* prev = carry.data() + (b - 1) * xsize;
+                    const T* bottom = image + (block_end(b - 1) - 1) * xsize;
+                    T* c = carry.data() + b * xsize;
+                    #pragma omp simd
+                    for(size_t x = 0; x < xsize; x++) c[x] = prev[x] + bottom[x];
+                }
+            }
+            #pragma omp for schedule(static)
+            for(long long y = static_cast<long long>(rows_per_block); y < static_cast<long long>(ysize); y++){
+                const T* c = carry.data() + (size_t(y) / rows_per_block) * xsize;
+                T* p = image + size_t(y) * xsize;
+                #pragma omp simd
+                for(size_t x = 0; x < xsize; x++) p[x] += c[x];
+            }
+        }
+    }
+
+    template<class T> void fill_table(cpu_backend<T>& table)
+    {
+        table.VtAdd       = vt_add<T>;
+        table.integral_x  = integral_x<T>;
+        table.integral_y  = integral_y<T>;
+        table.integral_xy = integral_xy<T>;
+    }
+    void fill(cpu_backend<float>& table)             {fill_table(table);}
+    void fill(cpu_backend<double>& table)            {fill_table(table);}
+    void fill(cpu_backend<complex_t<float>>& table)  {fill_table(table);}
+    void fill(cpu_backend<complex_t<double>>& table) {fill_table(table);}
+}
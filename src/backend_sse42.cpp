@@ -0,0 +1,17 @@
+//== SSE4.2 kernels
+#include "backend_kernels.hpp"
+#ifdef MEKIL_BACKEND_X86
+#   if defined(__clang__)
+#       pragma clang attribute push(__attribute__((target("sse4.2"))), apply_to = function)
+#   else
+#       pragma GCC push_options
+#       pragma GCC target("sse4.2")
+#   endif
+#   define MEKIL_BACKEND_ISA sse42
+#   include "backend_kernels.inl"
+#   if defined(__clang__)
+#       pragma clang attribute pop
+#   else
+#       pragma GCC pop_options
+#   endif
+#endif
@@ -1,41 +1,167 @@
-// #include <cpu_backend.hpp>
-// #include <mkl_vec.hpp>
-// #include <mkl_intergral.hpp>
-// #include <fftw_fft.hpp>
-
-// template<class TFrom, class TTo, int direction = FFTW_FORWARD> void self_fft_impl(TFrom* self, size_t* shape, size_t n)
-// {
-//     using fft = mekil::fftw<TFrom, TTo>;
-//     std::vector<int> row_major_dim(n);
-//     for(int i = 0; i < n; i++){
-//         row_major_dim.at(i) = shape[n - 1 - i];
-//     }
-//     fft::transform(fft::make_plan(row_major_dim, direction, self, self).get());
-// }
-// template<class TFrom, class TTo, int direction = FFTW_FORWARD> void fft_impl(const TFrom* from, TTo* to, size_t* shape, size_t n)
-// {
-//     using fft = mekil::fftw<TFrom, TTo>;
-//     std::vector<int> row_major_dim(n);
-//     for(int i = 0; i < n; i++){
-//         row_major_dim.at(i) = shape[n - 1 - i];
-//     }
-//     fft::transform(fft::make_plan(row_major_dim, direction, const_cast<TFrom*>(from), to).get());
-// }
-// namespace uca
-// {
-//     template<class T> void cpu_backend_impl(cpu_backend<T>& cpu)
-//     {
-//         cpu.enable =  true;
-//         cpu.VtAdd = mkl::vec::self_add<T>;
-//         cpu.integral_x = mkl::integral_x<T>;
-//         cpu.integral_y = mkl::integral_y<T>;
-//         cpu.self_fft = self_fft_impl<T, complex_t<T>, FFTW_FORWARD>;
-//         cpu.self_ifft = self_fft_impl<complex_t<T>, T, FFTW_BACKWARD>;
-//         cpu.fft = fft_impl<T, complex_t<T>, FFTW_FORWARD>;
-//         cpu.ifft = fft_impl<complex_t<T>, T, FFTW_BACKWARD>;
-//     }
-//     template<> cpu_backend<float>::cpu_backend(){cpu_backend_impl(*this);}
-//     template<> cpu_backend<double>::cpu_backend(){cpu_backend_impl(*this);}
-//     template<> cpu_backend<complex_t<float>>::cpu_backend(){cpu_backend_impl(*this);}
-//     template<> cpu_backend<complex_t<double>>::cpu_backend(){cpu_backend_impl(*this);}
-// }
\ No newline at end of file
+#include <cpu_backend.hpp>
+#include <mkl_fft.hpp>
+#include <mkl_arena.hpp>
+#include "backend_kernels.hpp"
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    using namespace mekil;
+
+    //== the fft entries are the same for every instruction set : MKL dispatches internally
+    std::vector<MKL_LONG> col_major_dims(const size_t* shape, size_t rank)
+    {
+        return std::vector<MKL_LONG>(shape, shape + rank);
+    }
+    std::vector<MKL_LONG> row_major_dims(const size_t* shape, size_t rank)
+    {
+        return std::vector<MKL_LONG>(std::make_reverse_iterator(shape + rank), std::make_reverse_iterator(shape));
+    }
+    //== plans come from the calling thread's bounded mekil::thread_plan_cache : repeated small
+    //   transforms commit their descriptor once
+    template<class T, bool forward> void self_fft_impl(T* self, const size_t* shape, size_t rank)
+    {
+        if constexpr(is_real_v<T>){
+            //== mklFFT keeps multi-dimensional real transforms out of place : the padded rows go
+            //   through a packed copy, the half spectrum fills the padded buffer exactly
+            if(rank > 1){
+                const size_t nx = shape[0], padded = 2 * (nx / 2 + 1);
+                size_t rows = 1;
+                for(size_t d = 1; d < rank; d++) rows *= shape[d];
+                mkl::scratch<T> packed(nx * rows);
+                const auto& plan = cached_plan<T>(row_major_dims(shape, rank), forward);
+                if constexpr(forward){
+                    for(size_t r = 0; r < rows; r++) std::copy(self + r * padded, self + r * padded + nx, packed.data() + r * nx);
+                    plan.forward(packed.data(), reinterpret_cast<complex_t<T>*>(self));
+                }
+                else{
+                    plan.backward(reinterpret_cast<const complex_t<T>*>(self), packed.data());
+                    for(size_t r = 0; r < rows; r++) std::copy(packed.data() + r * nx, packed.data() + (r + 1) * nx, self + r * padded);
+                }
+                return;
+            }
+        }
+        const auto& plan = cached_inplace_plan<T>(col_major_dims(shape, rank));
+        if constexpr(forward) plan.forward(self);
+        else plan.backward(self);
+    }
+    template<class T> void fft_impl(const T* from, complex_t<T>* to, const size_t* shape, size_t rank)
+    {
+        cached_plan<T>(row_major_dims(shape, rank), true).forward(from, to);
+    }
+    template<class T> void ifft_impl(const complex_t<T>* from, T* to, const size_t* shape, size_t rank)
+    {
+        cached_plan<T>(row_major_dims(shape, rank), false).backward(from, to);
+    }
+
+    cpu_isa hardware_isa()
+    {
+#ifdef MEKIL_BACKEND_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) return cpu_isa::avx512;
+        if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return cpu_isa::avx2;
+        if(__builtin_cpu_supports("sse4.2")) return cpu_isa::sse42;
+#endif
+        return cpu_isa::generic;
+    }
+
+    template<class T> struct registry
+    {
+        std::array<cpu_backend<T>, 4> tables;
+        registry()
+        {
+            auto common = [](cpu_backend<T>& table, cpu_isa isa){
+                table.enable    = true;
+                table.isa       = isa;
+                table.self_fft  = self_fft_impl<T, true>;
+                table.self_ifft = self_fft_impl<T, false>;
+                table.fft       = fft_impl<T>;
+                table.ifft      = ifft_impl<T>;
+            };
+            kernels::generic::fill(tables[int(cpu_isa::generic)]);
+            common(tables[int(cpu_isa::generic)], cpu_isa::generic);
+#ifdef MEKIL_BACKEND_X86
+            kernels::sse42::fill(tables[int(cpu_isa::sse42)]);
+            common(tables[int(cpu_isa::sse42)], cpu_isa::sse42);
+            kernels::avx2::fill(tables[int(cpu_isa::avx2)]);
+            common(tables[int(cpu_isa::avx2)], cpu_isa::avx2);
+            kernels::avx512::fill(tables[int(cpu_isa::avx512)]);
+            common(tables[int(cpu_isa::avx512)], cpu_isa::avx512);
+#endif
+        }
+        static registry& instance()
+        {
+            static registry r;
+            return r;
+        }
+    };
+
+    //== MEKIL_ISA from the environment, capped by what the cpu supports
+    cpu_isa initial_isa()
+    {
+        const cpu_isa best = detect_cpu_isa();
+        const char* env = std::getenv("MEKIL_ISA");
+        if(nullptr == env) return best;
+        for(int i = 0; i <= int(cpu_isa::avx512); i++){
+            if(0 == std::strcmp(env, cpu_isa_name(cpu_isa(i)))) return std::min(cpu_isa(i), best);
+        }
+        return best;
+    }
+    std::atomic<int>& active_storage()
+    {
+        static std::atomic<int> active{int(initial_isa())};
+        return active;
+    }
+    //== pick the instruction set when the library is loaded
+    [[maybe_unused]] const int selected_at_load = active_storage().load();
+}
+
+namespace mekil
+{
+    const char* cpu_isa_name(cpu_isa isa)
+    {
+        switch(isa){
+            case cpu_isa::generic: return "generic";
+            case cpu_isa::sse42:   return "sse42";
+            case cpu_isa::avx2:    return "avx2";
+            case cpu_isa::avx512:  return "avx512";
+        }
+        return "unknown";
+    }
+    cpu_isa detect_cpu_isa()
+    {
+        return hardware_isa();
+    }
+    cpu_isa active_cpu_isa()
+    {
+        return cpu_isa(active_storage().load());
+    }
+    bool set_cpu_isa(cpu_isa isa)
+    {
+        if(int(isa) < 0 || isa > detect_cpu_isa()) return false;
+        active_storage() = int(isa);
+        return true;
+    }
+
+    template<class T> const cpu_backend<T>& backend(cpu_isa isa)
+    {
+        return registry<T>::instance().tables.at(size_t(isa));
+    }
+    template<class T> const cpu_backend<T>& backend()
+    {
+        return backend<T>(active_cpu_isa());
+    }
+
+    template const cpu_backend<float>& backend<float>();
+    template const cpu_backend<double>& backend<double>();
+    template const cpu_backend<complex_t<float>>& backend<complex_t<float>>();
+    template const cpu_backend<complex_t<double>>& backend<complex_t<double>>();
+    template const cpu_backend<float>& backend<float>(cpu_isa);
+    template const cpu_backend<double>& backend<double>(cpu_isa);
+    template const cpu_backend<complex_t<float>>& backend<complex_t<float>>(cpu_isa);
+    template const cpu_backend<complex_t<double>>& backend<complex_t<double>>(cpu_isa);
+}
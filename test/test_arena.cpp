@@ -0,0 +1,112 @@
+#include <mkl_arena.hpp>
+#include <mkl_linespace.hpp>
+#include <mkl_structured.hpp>
+#include <thread>
+
+bool aligned(const void* p, size_t alignment = mkl::memory::alignment)
+{
+    return 0 == reinterpret_cast<uintptr_t>(p) % alignment;
+}
+
+void test_alignment()
+{
+    for(size_t n : {1, 3, 17, 1000, 123457}){
+        mkl::aligned_vector<double> v(n);
+        mkl::scratch<std::complex<float>> s(n);
+        if(!aligned(v.data()) || !aligned(s.data())) throw std::runtime_error("arena block is not 64-byte aligned");
+    }
+    mkl::scratch<char> huge(mkl::memory::huge_page_bytes);
+    if(!aligned(huge.data(), mkl::memory::huge_page_bytes)) throw std::runtime_error("huge block is not 2 MiB aligned");
+}
+
+//== the second round of identical requests is served from the arena
+void test_reuse()
+{
+    mkl::memory::release_cached();
+    mkl::memory::reset_counters();
+    for(int round = 0; round < 2; round++){
+        mkl::aligned_vector<float> a(1000);
+        mkl::scratch<double> b(77);
+        mkl::aligned_vector<int> c(5);
+    }
+    const auto s = mkl::memory::counters();
+    if(s.system_allocations != 3 || s.arena_hits != 3) throw std::runtime_error("arena did not reuse freed blocks");
+
+    mkl::memory::release_cached();
+    if(mkl::memory::cached_bytes() != 0 || mkl::memory::counters().system_frees != 3) throw std::runtime_error("release_cached kept blocks");
+}
+
+//== huge blocks take whole 2 MiB pages, not the next power of two, and are reused by exact size
+void test_huge_blocks()
+{
+    using mkl::memory::huge_page_bytes;
+    if(mkl::memory::detail::block_bytes((size_t(1) << 30) + 1) != (size_t(1) << 30) + huge_page_bytes) throw std::runtime_error("1 GiB request rounded past whole pages");
+    if(mkl::memory::detail::block_bytes(3 * huge_page_bytes - 5) != 3 * huge_page_bytes) throw std::runtime_error("huge request not page-rounded");
+    if(mkl::memory::detail::block_bytes(1000) != 1024) throw std::runtime_error("small request left its size class");
+
+    mkl::memory::release_cached();
+    mkl::memory::reset_counters();
+    for(int round = 0; round < 2; round++){
+        mkl::scratch<char> a(3 * huge_page_bytes - 5);
+        mkl::scratch<char> b(5 * huge_page_bytes);
+        if(!aligned(a.data(), huge_page_bytes) || !aligned(b.data(), huge_page_bytes)) throw std::runtime_error("huge block is not 2 MiB aligned");
+    }
+    auto s = mkl::memory::counters();
+    if(s.system_allocations != 2 || s.arena_hits != 2) throw std::runtime_error("huge blocks were not reused");
+    if(mkl::memory::cached_bytes() != 8 * huge_page_bytes) throw std::runtime_error("huge blocks cached at the wrong size");
+
+    //== larger than the cache limit : straight back to the system
+    mkl::memory::release_cached();
+    mkl::memory::set_cache_limit(4 * huge_page_bytes);
+    mkl::memory::reset_counters();
+    { mkl::scratch<char> big(6 * huge_page_bytes); }
+    s = mkl::memory::counters();
+    mkl::memory::set_cache_limit(size_t(256) << 20);
+    if(s.system_frees != 1 || mkl::memory::cached_bytes() != 0) throw std::runtime_error("block above the cache limit was cached");
+}
+
+//== blocks freed by another thread join that thread's arena and are released at thread exit
+void test_threads()
+{
+    mkl::memory::reset_counters();
+    auto* v = new mkl::aligned_vector<double>(4096);
+    std::thread([&]{ delete v; }).join();
+    const auto s = mkl::memory::counters();
+    if(s.system_allocations != s.system_frees) throw std::runtime_error("thread exit leaked arena blocks");
+}
+
+//== hot paths reach a steady state without system allocations
+template<class F> void check_steady_state(const std::string& name, F&& f)
+{
+    f();
+    mkl::memory::reset_counters();
+    for(int i = 0; i < 10; i++) f();
+    const auto s = mkl::memory::counters();
+    if(0 != s.system_allocations) throw std::runtime_error(name + " allocated " + std::to_string(s.system_allocations) + " blocks in steady state");
+}
+
+void test_steady_state()
+{
+    std::vector<double> image(33 * 17);
+    check_steady_state("fftshift", [&]{ fftshift(image.data(), 33, 17); });
+
+    std::vector<std::complex<double>> line(1000);
+    check_steady_state("linespace", [&]{ mkl::linespace(line.data(), line.size(), 0.5, 0.25); });
+
+    const size_t n = 40, ld = 43, ncol = 3;
+    std::vector<double> kernel(n), X(ld * ncol, 1.0), Y(ld * ncol);
+    for(size_t i = 0; i < n; i++) kernel[i] = 1.0 / (1 + i);
+    mkl::circulant_operator<double> circulant({n}, kernel.data());
+    check_steady_state("circulant", [&]{ circulant.apply_block(X.data(), ncol, ld, Y.data(), ld); });
+}
+
+int main()
+{
+    test_alignment();
+    test_reuse();
+    test_huge_blocks();
+    test_threads();
+    test_steady_state();
+    std::cout << "arena tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <mkl_block_qr.hpp>
+
+template<class T> T conj_of(const T& v)
+{
+    if constexpr(is_complex_v<T>) return std::conj(v);
+    else return v;
+}
+//== ||Q^H Q - I|| and ||Q R - A|| / ||A||
+template<class T> void check_qr(size_t m, size_t n, const std::vector<T>& A, const std::vector<T>& Q, const std::vector<T>& R, double tol, const std::string& msg)
+{
+    double orth = 0, rec = 0, anorm = 0;
+    for(size_t j = 0; j < n; j++){
+        for(size_t i = 0; i < n; i++){
+            T s = 0;
+            for(size_t k = 0; k < m; k++) s += conj_of(Q[i * m + k]) * Q[j * m + k];
+            orth = std::max(orth, double(std::abs(s - T(i == j ? 1 : 0))));
+        }
+        for(size_t k = 0; k < m; k++){
+            T s = 0;
+            for(size_t i = 0; i <= j; i++) s += Q[i * m + k] * R[j * n + i];
+            rec = std::max(rec, double(std::abs(s - A[j * m + k])));
+            anorm = std::max(anorm, double(std::abs(A[j * m + k])));
+        }
+    }
+    if(orth > tol || rec > tol * anorm) throw std::runtime_error("block qr failed in " + msg + ": orthogonality " + std::to_string(orth) + ", reconstruction " + std::to_string(rec));
+}
+
+template<class T> void test_block_qr(size_t m, size_t n, double tol)
+{
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> A(m * n);
+    for(auto& a : A) a = rand();
+    std::vector<T> Q = A, R(n * n);
+    if(!mkl::cholqr2(m, n, Q.data(), m, R.data(), n)) throw std::runtime_error("cholqr2 rejected a well conditioned block");
+    check_qr(m, n, A, Q, R, tol, "cholqr2");
+
+    Q = A;
+    mkl::tsqr(m, n, Q.data(), m, R.data(), n);
+    check_qr(m, n, A, Q, R, tol, "tsqr");
+
+    //== nearly dependent columns : cholqr2 must refuse, block_qr falls back to tsqr
+    if(std::is_same_v<real_t<T>, float>) return;
+    for(size_t k = 0; k < m; k++) A[(n - 1) * m + k] = A[k] + real_t<T>(1e-9) * A[(n - 1) * m + k];
+    Q = A;
+    if(mkl::cholqr2(m, n, Q.data(), m, R.data(), n)) throw std::runtime_error("cholqr2 accepted an ill conditioned block");
+    if(Q != A) throw std::runtime_error("cholqr2 modified a rejected block");
+    mkl::block_qr(m, n, Q.data(), m, R.data(), n);
+    check_qr(m, n, A, Q, R, tol, "block_qr fallback");
+}
+
+int main()
+{
+    test_block_qr<double>(5000, 8, 1e-12);
+    test_block_qr<std::complex<double>>(3000, 6, 1e-12);
+    test_block_qr<double>(40, 16, 1e-12);
+    //== several tsqr chunks
+    mkl::current_execution_policy().grain = 1;
+    test_block_qr<double>(5000, 8, 1e-12);
+    test_block_qr<std::complex<float>>(3000, 4, 1e-4);
+    std::cout << "block qr tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <cpu_backend.hpp>
+#include <mkl_intergral.hpp>
+
+template<class T> void check_close(const std::vector<T>& a, const std::vector<T>& b, double tol, const std::string& msg)
+{
+    for(size_t i = 0; i < a.size(); i++){
+        if(std::abs(a[i] - b[i]) > tol * (1 + std::abs(b[i]))) throw std::runtime_error("cpu backend mismatch in " + msg);
+    }
+}
+
+//== every built-in instruction set against the header templates
+template<class T> void test_kernels(double tol)
+{
+    const vec2<size_t> shape{37, 301};
+    const size_t n = shape[0] * shape[1];
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> image(n), x(n);
+    for(auto& v : image) v = rand();
+    for(auto& v : x) v = rand();
+
+    if(!mekil::backend<T>(mekil::cpu_isa::generic).enable) throw std::runtime_error("generic backend missing");
+    for(int i = 0; i <= int(mekil::cpu_isa::avx512); i++){
+        const auto isa = mekil::cpu_isa(i);
+        const auto& cpu = mekil::backend<T>(isa);
+        if(!cpu.enable || isa > mekil::detect_cpu_isa()) continue;
+        const std::string name = mekil::cpu_isa_name(isa);
+
+        std::vector<T> got = image, expected = image;
+        cpu.VtAdd(int(n), x.data(), got.data());
+        mkl::vec::self_add(int(n), x.data(), expected.data());
+        check_close(got, expected, tol, name + " VtAdd");
+
+        got = image; expected = image;
+        cpu.integral_x(shape, got.data());
+        mkl::integral_x(shape, expected.data());
+        check_close(got, expected, tol, name + " integral_x");
+
+        got = image; expected = image;
+        cpu.integral_y(shape, got.data());
+        mkl::integral_y(shape, expected.data());
+        check_close(got, expected, tol, name + " integral_y");
+
+        got = image; expected = image;
+        cpu.integral_xy(shape, got.data());
+        mkl::integral_xy(shape, expected.data());
+        check_close(got, expected, tol * 10, name + " integral_xy");
+    }
+}
+
+template<class T> void test_fft(double tol)
+{
+    const size_t shape[2] = {6, 5};     // column-major : x = 6, y = 5
+    const size_t n = 30, nf = (is_real_v<T> ? 4 : 6) * 5;
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> image(n), recovered(n);
+    for(auto& v : image) v = rand();
+    std::vector<complex_t<T>> freq(nf);
+    const auto& cpu = mekil::backend<T>();
+    cpu.fft(image.data(), freq.data(), shape, 2);
+    //== DC term is the sum of the image
+    T sum = 0;
+    for(auto v : image) sum += v;
+    if(std::abs(freq[0] - complex_t<T>(sum)) > tol * n) throw std::runtime_error("cpu backend fft DC mismatch");
+    cpu.ifft(freq.data(), recovered.data(), shape, 2);
+    check_close(recovered, image, tol, "fft round trip");
+
+    if constexpr(is_complex_v<T>){
+        std::vector<T> self = image;
+        cpu.self_fft(self.data(), shape, 2);
+        cpu.self_ifft(self.data(), shape, 2);
+        check_close(self, image, tol, "self fft round trip");
+    }
+    else{
+        //== padded rows of 2 * (6 / 2 + 1) reals, the spectrum matches the out-of-place one
+        const size_t padded = 8;
+        std::vector<T> self(padded * 5, T(0));
+        for(size_t y = 0; y < 5; y++) std::copy(image.begin() + y * 6, image.begin() + (y + 1) * 6, self.begin() + y * padded);
+        cpu.self_fft(self.data(), shape, 2);
+        const auto* spectrum = reinterpret_cast<const complex_t<T>*>(self.data());
+        check_close(std::vector<complex_t<T>>(spectrum, spectrum + nf), freq, tol, "real self fft");
+        cpu.self_ifft(self.data(), shape, 2);
+        for(size_t y = 0; y < 5; y++) std::copy(self.begin() + y * padded, self.begin() + y * padded + 6, recovered.begin() + y * 6);
+        check_close(recovered, image, tol, "real self fft round trip");
+    }
+}
+
+void test_override()
+{
+    const auto best = mekil::detect_cpu_isa();
+    if(mekil::active_cpu_isa() > best) throw std::runtime_error("active instruction set beyond the cpu");
+    if(!mekil::set_cpu_isa(mekil::cpu_isa::generic)) throw std::runtime_error("generic backend refused");
+    if(mekil::backend<float>().isa != mekil::cpu_isa::generic) throw std::runtime_error("override ignored");
+    if(best < mekil::cpu_isa::avx512 && mekil::set_cpu_isa(mekil::cpu_isa::avx512)) throw std::runtime_error("unsupported instruction set accepted");
+    mekil::set_cpu_isa(best);
+    std::cout << "cpu backend : " << mekil::cpu_isa_name(mekil::active_cpu_isa()) << std::endl;
+}
+
+int main()
+{
+    test_kernels<float>(1e-4);
+    test_kernels<double>(1e-12);
+    test_kernels<std::complex<float>>(1e-4);
+    test_kernels<std::complex<double>>(1e-12);
+    test_fft<float>(1e-5);
+    test_fft<double>(1e-12);
+    test_fft<std::complex<double>>(1e-12);
+    //== blocked integral_xy and repeated transforms on the cached plans
+    const auto policy = mkl::current_execution_policy();
+    mkl::current_execution_policy().grain = 1;
+    test_kernels<double>(1e-12);
+    test_fft<float>(1e-5);
+    test_fft<std::complex<double>>(1e-12);
+    mkl::current_execution_policy() = policy;
+    test_override();
+    std::cout << "cpu backend tests passed" << std::endl;
+    return 0;
+}
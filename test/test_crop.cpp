@@ -81,6 +81,244 @@ void test_crop_to()
         for(size_t i = 0; i < output.size(); i++)  assert(output.at(i) == input.at(i).imag());
     }
 }
+//== reference : pixel by pixel over the whole output
+template<class TFrom, class TTo> void test_crop_convert_pair(vec2<size_t> out_shape, vec2<size_t> out_offset, vec2<size_t> in_shape, vec2<size_t> in_offset)
+{
+    std::vector<TFrom> input(in_shape[0] * in_shape[1]);
+    uniform_random<TFrom> rand(-1, 1);
+    for(auto& v : input) v = rand();
+    const real_t<TTo> scale = 0.5;
+    const TTo offset = []{
+        if constexpr(is_complex_v<TTo>) return TTo(0.25, -0.75);
+        else return TTo(0.25);
+    }();
+    const TTo sentinel = TTo(-9);
+    auto expected = [&](size_t x, size_t y, bool zero_fill) -> TTo{
+        const bool inside = x >= out_offset[0] && y >= out_offset[1]
+            && x - out_offset[0] + in_offset[0] < in_shape[0] && y - out_offset[1] + in_offset[1] < in_shape[1];
+        if(!inside) return zero_fill ? TTo(0) : sentinel;
+        const TFrom v = input[(y - out_offset[1] + in_offset[1]) * in_shape[0] + x - out_offset[0] + in_offset[0]];
+        if constexpr(is_complex_v<TTo>) return TTo(std::complex<double>(v) * double(scale)) + offset;
+        else return TTo(std::real(v) * scale) + offset;
+    };
+    const double tol = (is_s<real_t<TFrom>> || is_s<real_t<TTo>>) ? 1e-6 : 1e-14;
+    for(bool zero_fill : {false, true}){
+        std::vector<TTo> output(out_shape[0] * out_shape[1], sentinel);
+        crop_convert<TFrom, TTo>(output.data(), out_shape, out_offset, input.data(), in_shape, in_offset, scale, offset, zero_fill);
+        for(size_t y = 0; y < out_shape[1]; y++){
+            for(size_t x = 0; x < out_shape[0]; x++){
+                if(std::abs(output[y * out_shape[0] + x] - expected(x, y, zero_fill)) > tol) throw std::runtime_error("crop_convert mismatch");
+            }
+        }
+    }
+
+    //== plain crop_to of the same windows, the overlap is counted in pixels.
+    //== real -> complex writes the real part only : the imaginary part of the output is kept
+    const TTo background = [&]{
+        if constexpr(is_complex_v<TTo>) return TTo(std::real(sentinel), 3);
+        else return sentinel;
+    }();
+    std::vector<TTo> output(out_shape[0] * out_shape[1], background);
+    crop_to<TFrom, TTo>(output.data(), out_shape, out_offset, input.data(), in_shape, in_offset);
+    for(size_t y = 0; y < out_shape[1]; y++){
+        for(size_t x = 0; x < out_shape[0]; x++){
+            TTo e = expected(x, y, false);
+            if(e == sentinel) e = background;
+            else{
+                e = (e - offset) / scale;
+                if constexpr(is_real_v<TFrom> && is_complex_v<TTo>) e = TTo(std::real(e), std::imag(background));
+            }
+            if(std::abs(output[y * out_shape[0] + x] - e) > tol) throw std::runtime_error("crop_to mismatch");
+        }
+    }
+}
+template<class TFrom> void test_crop_convert_from()
+{
+    //== smaller, larger and shifted windows, odd sizes
+    const std::array<std::array<vec2<size_t>, 4>, 4> cases{{
+        {vec2<size_t>{7, 5}, vec2<size_t>{0, 0}, vec2<size_t>{13, 11}, vec2<size_t>{3, 2}},
+        {vec2<size_t>{13, 11}, vec2<size_t>{2, 3}, vec2<size_t>{7, 5}, vec2<size_t>{0, 0}},
+        {vec2<size_t>{9, 9}, vec2<size_t>{4, 1}, vec2<size_t>{9, 9}, vec2<size_t>{2, 5}},
+        {vec2<size_t>{5, 3}, vec2<size_t>{6, 0}, vec2<size_t>{5, 3}, vec2<size_t>{0, 0}},
+    }};
+    for(const auto& [out_shape, out_offset, in_shape, in_offset] : cases){
+        test_crop_convert_pair<TFrom, float>(out_shape, out_offset, in_shape, in_offset);
+        test_crop_convert_pair<TFrom, double>(out_shape, out_offset, in_shape, in_offset);
+        test_crop_convert_pair<TFrom, std::complex<float>>(out_shape, out_offset, in_shape, in_offset);
+        test_crop_convert_pair<TFrom, std::complex<double>>(out_shape, out_offset, in_shape, in_offset);
+    }
+}
+void test_crop_convert()
+{
+    test_crop_convert_from<float>();
+    test_crop_convert_from<double>();
+    test_crop_convert_from<std::complex<float>>();
+    test_crop_convert_from<std::complex<double>>();
+
+    //== rows split across threads
+    auto policy = mkl::current_execution_policy();
+    mkl::current_execution_policy().grain = 1;
+    test_crop_convert_pair<std::complex<float>, double>({61, 47}, {3, 4}, {64, 64}, {5, 1});
+    test_crop_convert_pair<float, std::complex<double>>({64, 64}, {5, 1}, {61, 47}, {3, 4});
+    mkl::current_execution_policy() = policy;
+}
+//== a stack in one call matches the per-image calls, for strided stacks, pointer arrays and volumes
+template<class TFrom, class TTo> void test_crop_batch()
+{
+    const size_t batch = 9;
+    const vec2<size_t> in_shape{11, 7}, out_shape{6, 9};
+    const size_t in_distance = in_shape[0] * in_shape[1] + 5, out_distance = out_shape[0] * out_shape[1] + 3;
+    std::vector<TFrom> input(batch * in_distance);
+    uniform_random<TFrom> rand(-1, 1);
+    for(auto& v : input) v = rand();
+    std::vector<vec2<size_t>> in_offsets, out_offsets;
+    for(size_t i = 0; i < batch; i++){
+        in_offsets.push_back({i % 6, i % 4});
+        out_offsets.push_back({i % 3, (2 * i) % 10});
+    }
+    const real_t<TTo> scale = 2;
+    std::vector<TTo> expected(batch * out_distance, TTo(-3)), output = expected, scattered = expected;
+    for(size_t i = 0; i < batch; i++){
+        crop_convert<TFrom, TTo>(expected.data() + i * out_distance, out_shape, out_offsets[i],
+            input.data() + i * in_distance, in_shape, in_offsets[i], scale, TTo(1), true);
+    }
+    crop_convert_batch<TFrom, TTo>(output.data(), out_shape, out_distance, out_offsets,
+        input.data(), in_shape, in_distance, in_offsets, batch, scale, TTo(1), true);
+    if(output != expected) throw std::runtime_error("strided batch crop mismatch");
+
+    std::vector<const TFrom*> inputs;
+    std::vector<TTo*> outputs;
+    for(size_t i = batch; i-- > 0;){
+        inputs.push_back(input.data() + i * in_distance);
+        outputs.push_back(scattered.data() + i * out_distance);
+    }
+    std::reverse(in_offsets.begin(), in_offsets.end());
+    std::reverse(out_offsets.begin(), out_offsets.end());
+    crop_convert_batch<TFrom, TTo>(outputs.data(), out_shape, out_offsets, inputs.data(), in_shape, in_offsets, batch, scale, TTo(1), true);
+    if(scattered != expected) throw std::runtime_error("pointer-array batch crop mismatch");
+
+    //== one offset shared by the stack
+    std::fill(expected.begin(), expected.end(), TTo(-3));
+    output = expected;
+    for(size_t i = 0; i < batch; i++){
+        crop_convert<TFrom, TTo>(expected.data() + i * out_distance, out_shape, {1, 2}, input.data() + i * in_distance, in_shape, {3, 0});
+    }
+    crop_convert_batch<TFrom, TTo>(output.data(), out_shape, out_distance, {{1, 2}}, input.data(), in_shape, in_distance, {{3, 0}}, batch);
+    if(output != expected) throw std::runtime_error("shared-offset batch crop mismatch");
+
+    bool rejected = false;
+    try{ crop_convert_batch<TFrom, TTo>(output.data(), out_shape, out_distance, {{0, 0}, {0, 0}}, input.data(), in_shape, in_distance, {{0, 0}}, batch); }
+    catch(const std::invalid_argument&){ rejected = true; }
+    if(!rejected) throw std::runtime_error("wrong offset count not detected");
+
+    //== volume : z-slices before and after the source are zeroed
+    const std::array<size_t, 3> vin{7, 5, 6}, vout{5, 6, 8}, oin{1, 0, 2}, oout{0, 1, 3};
+    std::vector<TFrom> volume(vin[0] * vin[1] * vin[2]);
+    for(auto& v : volume) v = rand();
+    std::vector<TTo> cropped(vout[0] * vout[1] * vout[2], TTo(-3)), reference(cropped.size(), TTo(0));
+    for(size_t z = oout[2]; z < vout[2] && z - oout[2] + oin[2] < vin[2]; z++){
+        crop_convert<TFrom, TTo>(reference.data() + z * vout[0] * vout[1], {vout[0], vout[1]}, {oout[0], oout[1]},
+            volume.data() + (z - oout[2] + oin[2]) * vin[0] * vin[1], {vin[0], vin[1]}, {oin[0], oin[1]}, scale, TTo(0), true);
+    }
+    crop_convert_3d<TFrom, TTo>(cropped.data(), vout, oout, volume.data(), vin, oin, scale, TTo(0), true);
+    if(cropped != reference) throw std::runtime_error("volume crop mismatch");
+}
+void test_crop_batches()
+{
+    auto policy = mkl::current_execution_policy();
+    for(size_t grain : {policy.grain, size_t(1)}){
+        mkl::current_execution_policy().grain = grain;
+        test_crop_batch<float, float>();
+        test_crop_batch<std::complex<double>, float>();
+        test_crop_batch<float, std::complex<double>>();
+        test_crop_batch<std::complex<float>, std::complex<double>>();
+    }
+    mkl::current_execution_policy() = policy;
+}
+//== embed_centered against a zeroed buffer + crop, and against fftshift of the shifted embed
+template<class TFrom, class TTo> void test_embed(vec2<size_t> out_shape, vec2<size_t> in_shape)
+{
+    std::vector<TFrom> input(in_shape[0] * in_shape[1]);
+    uniform_random<TFrom> rand(-1, 1);
+    for(auto& v : input) v = rand();
+    auto centered = [](size_t N, size_t n){ return std::pair<size_t, size_t>(N / 2 >= n / 2 ? N / 2 - n / 2 : 0, N / 2 >= n / 2 ? 0 : n / 2 - N / 2); };
+    const auto [ox, ix] = centered(out_shape[0], in_shape[0]);
+    const auto [oy, iy] = centered(out_shape[1], in_shape[1]);
+    std::vector<TTo> reference(out_shape[0] * out_shape[1], TTo(0));
+    crop_convert<TFrom, TTo>(reference.data(), out_shape, {ox, oy}, input.data(), in_shape, {ix, iy}, 3);
+
+    //== r2c row padding is written too
+    const size_t pitch = out_shape[0] + 3;
+    std::vector<TTo> padded(pitch * out_shape[1], TTo(-1)), shifted(out_shape[0] * out_shape[1], TTo(-1));
+    embed_centered<TFrom, TTo>(padded.data(), out_shape, input.data(), in_shape, false, 3, pitch);
+    for(size_t y = 0; y < out_shape[1]; y++){
+        for(size_t x = 0; x < pitch; x++){
+            const TTo e = x < out_shape[0] ? reference[y * out_shape[0] + x] : TTo(0);
+            if(padded[y * pitch + x] != e) throw std::runtime_error("embed_centered mismatch");
+        }
+    }
+    embed_centered<TFrom, TTo>(shifted.data(), out_shape, input.data(), in_shape, true, 3);
+    fftshift(shifted.data(), out_shape[0], out_shape[1]);
+    if(shifted != reference) throw std::runtime_error("ifftshifted embed mismatch");
+}
+template<class T> void test_embed_3d(std::array<size_t, 3> out_shape, std::array<size_t, 3> in_shape)
+{
+    std::vector<T> input(in_shape[0] * in_shape[1] * in_shape[2]);
+    uniform_random<T> rand(-1, 1);
+    for(auto& v : input) v = rand();
+    std::vector<T> plain(out_shape[0] * out_shape[1] * out_shape[2], T(-1)), shifted = plain;
+    pad_to_3d<T>(plain.data(), out_shape, input.data(), in_shape);
+    pad_to_3d<T>(shifted.data(), out_shape, input.data(), in_shape, true);
+    auto at = [&](const std::vector<T>& v, std::array<size_t, 3> p){ return v[(p[2] * out_shape[1] + p[1]) * out_shape[0] + p[0]]; };
+    for(size_t z = 0; z < out_shape[2]; z++) for(size_t y = 0; y < out_shape[1]; y++) for(size_t x = 0; x < out_shape[0]; x++){
+        //== numpy ifftshift : shifted[k] = plain[(k + N/2) % N] on every axis
+        const std::array<size_t, 3> k{x, y, z};
+        std::array<size_t, 3> q, i;
+        bool inside = true;
+        for(int a = 0; a < 3; a++){
+            q[a] = (k[a] + out_shape[a] / 2) % out_shape[a];
+            const long long s = (long long)k[a] - (long long)(out_shape[a] / 2) + (long long)(in_shape[a] / 2);
+            inside = inside && 0 <= s && s < (long long)in_shape[a];
+            i[a] = size_t(s);
+        }
+        const T e = inside ? input[(i[2] * in_shape[1] + i[1]) * in_shape[0] + i[0]] : T(0);
+        if(at(plain, k) != e || at(shifted, k) != at(plain, q)) throw std::runtime_error("3d embed mismatch");
+    }
+}
+void test_embeds()
+{
+    const std::array<std::array<vec2<size_t>, 2>, 5> cases{{
+        {vec2<size_t>{16, 12}, vec2<size_t>{6, 4}},
+        {vec2<size_t>{15, 11}, vec2<size_t>{6, 5}},
+        {vec2<size_t>{9, 14}, vec2<size_t>{9, 3}},
+        {vec2<size_t>{7, 6}, vec2<size_t>{12, 9}},
+        {vec2<size_t>{1, 5}, vec2<size_t>{1, 2}},
+    }};
+    auto policy = mkl::current_execution_policy();
+    for(size_t grain : {policy.grain, size_t(1)}){
+        mkl::current_execution_policy().grain = grain;
+        for(const auto& [out_shape, in_shape] : cases){
+            test_embed<float, float>(out_shape, in_shape);
+            test_embed<double, std::complex<double>>(out_shape, in_shape);
+            test_embed<std::complex<float>, std::complex<double>>(out_shape, in_shape);
+        }
+        test_embed_3d<float>({8, 7, 5}, {3, 4, 2});
+        test_embed_3d<std::complex<double>>({5, 6, 9}, {7, 3, 4});
+    }
+    mkl::current_execution_policy() = policy;
+
+    //== a pitch narrower than the output rows is rejected instead of writing past them
+    std::vector<float> small(16 * 4), image(4 * 4);
+    for(int d : {2, 3}){
+        bool thrown = false;
+        try{
+            if(2 == d) embed_centered<float, float>(small.data(), {8, 4}, image.data(), {4, 4}, false, 1, 6);
+            else embed_centered_3d<float, float>(small.data(), {8, 2, 2}, image.data(), {4, 2, 2}, false, 1, 6);
+        }
+        catch(const std::invalid_argument&){ thrown = true; }
+        if(!thrown) throw std::runtime_error("embed accepted a pitch narrower than its rows");
+    }
+}
 int test_crop_image() 
 {
     auto print_image = [](const std::vector<double>& img, int width, int height) {
@@ -134,6 +372,9 @@ int test_crop_image()
 int main()
 {
     test_crop_to();
+    test_crop_convert();
+    test_crop_batches();
+    test_embeds();
     test_crop_image();
     test_complex_decompose();
     std::cout << "all test done\n";
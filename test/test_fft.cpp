@@ -11,13 +11,13 @@ void test_mkl_fft_ifft_out_of_place(const std::string& space, std::vector<int> c
     using fourier_type = complex_t<T>;
 
     int prod = 1;for(int n:col_major_dims) prod *= n;
-    std::vector<spatial_type> image(prod);
+    mkl::aligned_vector<spatial_type> image(prod);
     for(int i = 0; i < prod;i++) image.at(i) = real_t<T>(i)/prod;
 
     auto plan_fwd = fft_t::make_plan({col_major_dims.begin(), col_major_dims.end()});
-    std::vector<fourier_type> freq(prod);
+    mkl::aligned_vector<fourier_type> freq(prod);
     fft_t::exec_forward(*plan_fwd, image.data(), freq.data());
-    std::vector<spatial_type> recovered(prod);
+    mkl::aligned_vector<spatial_type> recovered(prod);
     fft_t::exec_backward(*plan_fwd, freq.data(), recovered.data());
 
     for(size_t i=0;i<prod;++i){
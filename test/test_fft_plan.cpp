@@ -0,0 +1,120 @@
+#define MEKIL_FFT_VALIDATE 1
+#include <mkl_fft.hpp>
+
+template<class T> real_t<T> tolerance() {return is_s<real_t<T>> ? 1e-5 : 1e-12;}
+
+//== the cached layout matches what the descriptor was configured with
+template<class T> void test_layout()
+{
+    using plan_t = mekil::fft_plan<T>;
+    auto fwd = plan_t::directional({6, 10}, true, 3);
+    const auto& info = fwd.info();
+    const MKL_LONG nf = is_real_v<T> ? 6 : 10;
+    if(info.lengths != std::vector<MKL_LONG>{6, 10} || info.inplace || info.batch != 3) throw std::runtime_error("plan sizes are not cached");
+    if(info.input_strides != std::vector<MKL_LONG>{0, 10, 1} || info.output_strides != std::vector<MKL_LONG>{0, nf, 1})
+        throw std::runtime_error("plan strides are not cached");
+    if(info.input_distance != 60 || info.output_distance != 6 * nf) throw std::runtime_error("plan distances are not cached");
+    if(info.spatial_elements != 60 || info.fourier_elements != size_t(6 * nf)) throw std::runtime_error("plan element counts are wrong");
+    if(std::abs(info.backward_scale - real_t<T>(1) / 60) > tolerance<T>() || info.forward_scale != 1) throw std::runtime_error("plan scales are not cached");
+
+    //== real multi-dimensional transforms fall back to out of place, the plan says so
+    auto col = plan_t::col_major({8, 4}, true);
+    if(col.info().inplace != is_complex_v<T> || col.info().lengths != std::vector<MKL_LONG>{4, 8}) throw std::runtime_error("col-major plan layout is wrong");
+}
+
+//== forward then backward reproduces the input, in and out of place
+template<class T> void test_round_trip()
+{
+    using plan_t = mekil::fft_plan<T>;
+    const size_t rows = 12, cols = 9, batch = 2, N = rows * cols;
+    const size_t nf = rows * (is_real_v<T> ? cols / 2 + 1 : cols);
+    mkl::aligned_vector<T> image(N * batch), recovered(N * batch);
+    mkl::aligned_vector<complex_t<T>> freq(nf * batch);
+    uniform_random<T> rand(-1, 1);
+    for(size_t i = 0; i < image.size(); i++) image[i] = rand();
+
+    auto fwd = plan_t::directional({MKL_LONG(rows), MKL_LONG(cols)}, true, int(batch));
+    auto bwd = plan_t::directional({MKL_LONG(rows), MKL_LONG(cols)}, false, int(batch));
+    fwd.forward(image.data(), freq.data());
+    bwd.backward(freq.data(), recovered.data());
+    for(size_t i = 0; i < image.size(); i++){
+        if(std::abs(recovered[i] - image[i]) > tolerance<T>()) throw std::runtime_error("out-of-place round trip mismatch");
+    }
+
+    //== in place : rank 1 for real data, padded to n/2+1 complex values
+    const size_t n = 30, padded = is_real_v<T> ? 2 * (n / 2 + 1) : n;
+    mkl::aligned_vector<T> line(padded), original(n);
+    for(size_t i = 0; i < n; i++) original[i] = line[i] = rand();
+    auto inplace = plan_t::row_major({MKL_LONG(n)}, true);
+    inplace.forward(line.data());
+    inplace.backward(line.data());
+    for(size_t i = 0; i < n; i++){
+        if(std::abs(line[i] - original[i]) > tolerance<T>()) throw std::runtime_error("in-place round trip mismatch");
+    }
+}
+
+template<class E, class F> void expect_throw(const std::string& what, F&& f)
+{
+    try{
+        f();
+    }
+    catch(const E&){
+        return;
+    }
+    throw std::runtime_error("misuse not detected : " + what);
+}
+
+//== misuse is reported from the cached layout, without querying the descriptor
+template<class T> void test_validation()
+{
+    using plan_t = mekil::fft_plan<T>;
+    mkl::aligned_vector<T> a(64);
+    mkl::aligned_vector<complex_t<T>> b(64);
+    auto fwd = plan_t::directional({8}, true);
+    auto bwd = plan_t::directional({8}, false);
+    expect_throw<std::logic_error>("in-place call of an out-of-place plan", [&]{ fwd.forward(a.data()); });
+    expect_throw<std::logic_error>("backward call of a forward plan", [&]{ fwd.backward(b.data(), a.data()); });
+    expect_throw<std::logic_error>("forward call of a backward plan", [&]{ bwd.forward(a.data(), b.data()); });
+    expect_throw<std::invalid_argument>("null buffer", [&]{ fwd.forward(nullptr, b.data()); });
+    auto inplace = plan_t::row_major({8}, true);
+    expect_throw<std::logic_error>("out-of-place call of an in-place plan", [&]{ inplace.forward(a.data(), b.data()); });
+}
+
+//== the thread cache keeps the most recently used plans up to its capacity
+template<class T> void test_cache()
+{
+    const size_t capacity = mekil::plan_cache_capacity();
+    mekil::set_plan_cache_capacity(3);
+    mekil::clear_plan_cache();
+    const auto& cache = mekil::thread_plan_cache<T>();
+    const auto* first = &mekil::cached_plan<T>({8}, true);
+    if(&mekil::cached_plan<T>({8}, true) != first) throw std::runtime_error("cached plan not reused");
+    mekil::cached_plan<T>({8}, false);
+    mekil::cached_inplace_plan<T>({8});
+    mekil::cached_plan<T>({8}, true);           // most recent again, the backward plan is the oldest
+    mekil::cached_plan<T>({16}, true);
+    if(cache.size() != 3) throw std::runtime_error("plan cache grew past its capacity");
+    if(&mekil::cached_plan<T>({8}, true) != first || cache.size() != 3) throw std::runtime_error("recently used plan was evicted");
+    if(mekil::cached_inplace_plan<T>({8}).info().inplace != true) throw std::runtime_error("in-place plan is not in place");
+    mekil::clear_plan_cache();
+    if(cache.size() != 0) throw std::runtime_error("plan cache not cleared");
+    mekil::set_plan_cache_capacity(capacity);
+}
+
+template<class T> void test_all()
+{
+    test_layout<T>();
+    test_round_trip<T>();
+    test_validation<T>();
+    test_cache<T>();
+}
+
+int main()
+{
+    test_all<float>();
+    test_all<double>();
+    test_all<std::complex<float>>();
+    test_all<std::complex<double>>();
+    std::cout << "fft plan tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <mkl_fourier_shift.hpp>
+
+template<class T> double tolerance() {return is_s<real_t<T>> ? 2e-4 : 1e-9;}
+
+//== band-limited periodic test image : a few integer frequencies below Nyquist, evaluated at any position
+struct waves
+{
+    size_t nx, ny;
+    double operator()(double x, double y) const
+    {
+        const double u = 2 * M_PI * x / nx, v = 2 * M_PI * y / ny;
+        return 1 + std::cos(u + 0.3) + 0.5 * std::sin(2 * u - v) + 0.25 * std::cos(3 * v + u + 1.1);
+    }
+};
+template<class T> T sample(const waves& w, double x, double y)
+{
+    if constexpr(is_real_v<T>) return T(w(x, y));
+    else return T(w(x, y), 0.5 * w(y * w.nx / w.ny, x * w.ny / w.nx));
+}
+template<class T> std::complex<double> sample_c(const waves& w, double x, double y)
+{
+    const T v = sample<T>(w, x, y);
+    return std::complex<double>(std::real(v), std::imag(v));
+}
+
+//== translating the spectrum gives the sampled translated image
+template<class T> void test_shift(vec2<size_t> shape, vec2<double> d)
+{
+    using C = complex_t<T>;
+    const auto [nx, ny] = shape;
+    const waves w{nx, ny};
+    const size_t columns = is_real_v<T> ? nx / 2 + 1 : nx;
+    std::vector<T> image(nx * ny), shifted(nx * ny);
+    for(size_t y = 0; y < ny; y++) for(size_t x = 0; x < nx; x++) image[y * nx + x] = sample<T>(w, x, y);
+    std::vector<C> spectrum(columns * ny);
+    const auto forward = mekil::fft_plan<T>::directional({MKL_LONG(ny), MKL_LONG(nx)}, true);
+    const auto backward = mekil::fft_plan<T>::directional({MKL_LONG(ny), MKL_LONG(nx)}, false);
+    forward.forward(image.data(), spectrum.data());
+    mkl::fourier_shift(spectrum.data(), shape, d, is_real_v<T>);
+    backward.backward(spectrum.data(), shifted.data());
+    for(size_t y = 0; y < ny; y++) for(size_t x = 0; x < nx; x++){
+        const std::complex<double> got(std::real(shifted[y * nx + x]), std::imag(shifted[y * nx + x]));
+        if(std::abs(sample_c<T>(w, x - d[0], y - d[1]) - got) > tolerance<T>() * 10)
+            throw std::runtime_error("sub-pixel shift mismatch");
+    }
+}
+
+//== integer shifts are exact rolls, Nyquist content included
+template<class T> void test_roll(vec2<size_t> shape, vec2<double> d)
+{
+    using C = complex_t<T>;
+    const auto [nx, ny] = shape;
+    const size_t columns = is_real_v<T> ? nx / 2 + 1 : nx;
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> image(nx * ny), rolled(nx * ny);
+    for(auto& v : image) v = rand();
+    std::vector<C> spectrum(columns * ny);
+    mekil::fft_plan<T>::directional({MKL_LONG(ny), MKL_LONG(nx)}, true).forward(image.data(), spectrum.data());
+    mkl::fourier_shift(spectrum.data(), shape, d, is_real_v<T>);
+    mekil::fft_plan<T>::directional({MKL_LONG(ny), MKL_LONG(nx)}, false).backward(spectrum.data(), rolled.data());
+    const long long sx = std::llround(d[0]), sy = std::llround(d[1]);
+    for(size_t y = 0; y < ny; y++) for(size_t x = 0; x < nx; x++){
+        const size_t ix = size_t((((long long)x - sx) % (long long)nx + nx) % nx), iy = size_t((((long long)y - sy) % (long long)ny + ny) % ny);
+        if(std::abs(rolled[y * nx + x] - image[iy * nx + ix]) > tolerance<T>()) throw std::runtime_error("integer shift is not a roll");
+    }
+}
+
+//== frames with their own shifts in one call, rows padded, match one call per frame
+template<class R> void test_batch()
+{
+    const vec2<size_t> shape{10, 7};
+    const size_t columns = 6, pitch = 8, distance = pitch * 7 + 5;
+    const std::vector<vec2<double>> shifts{{0.5, -1.25}, {3.0, 0.1}, {-2.7, 4.4}, {0, 0}};
+    uniform_random<std::complex<R>> rand(-1, 1);
+    std::vector<std::complex<R>> batch(distance * shifts.size());
+    for(auto& v : batch) v = rand();
+    auto single = batch;
+    mkl::fourier_shift_batch(batch.data(), shape, distance, shifts, true, pitch);
+    for(size_t f = 0; f < shifts.size(); f++) mkl::fourier_shift(single.data() + f * distance, shape, shifts[f], true, pitch);
+    for(size_t i = 0; i < batch.size(); i++){
+        if(std::abs(batch[i] - single[i]) > 1e-6) throw std::runtime_error("batched shift mismatch");
+    }
+    //== columns past the spectrum and the gaps between frames are untouched
+    for(size_t f = 0; f < shifts.size(); f++) for(size_t y = 0; y < 7; y++) for(size_t x = columns; x < pitch; x++){
+        if(batch[f * distance + y * pitch + x] != single[f * distance + y * pitch + x]) throw std::runtime_error("padding modified");
+    }
+}
+
+//== a smooth blob rotated by the three shears against the analytic rotation
+template<class T> void test_rotate(vec2<size_t> shape, double angle)
+{
+    const auto [nx, ny] = shape;
+    const double cx = double(nx / 2), cy = double(ny / 2), sigma = 4, ox = 5, oy = -3;
+    auto blob = [&](double x, double y, double gx, double gy){ return std::exp(-((x - gx) * (x - gx) + (y - gy) * (y - gy)) / (2 * sigma * sigma)); };
+    std::vector<T> image(nx * ny);
+    for(size_t y = 0; y < ny; y++) for(size_t x = 0; x < nx; x++) image[y * nx + x] = T(blob(x, y, cx + ox, cy + oy));
+    mkl::fourier_rotate(image.data(), shape, angle);
+    //== output(p) = input(R(-a)(p - c) + c) : the blob center moves to c + R(a) o
+    const double gx = cx + std::cos(angle) * ox - std::sin(angle) * oy, gy = cy + std::sin(angle) * ox + std::cos(angle) * oy;
+    double err = 0;
+    for(size_t y = 0; y < ny; y++) for(size_t x = 0; x < nx; x++) err = std::max(err, std::abs(std::real(image[y * nx + x]) - blob(x, y, gx, gy)));
+    if(err > 2e-3) throw std::runtime_error("rotation error " + std::to_string(err) + " at angle " + std::to_string(angle));
+}
+void test_quarter_turns()
+{
+    std::vector<float> image(9 * 9), original;
+    uniform_random<float> rand(-1, 1);
+    for(auto& v : image) v = rand();
+    original = image;
+    mkl::rotate_quarter_turns(image.data(), 9, 1);
+    if(image[4 * 9 + 4] != original[4 * 9 + 4]) throw std::runtime_error("quarter turn moved the center");
+    mkl::rotate_quarter_turns(image.data(), 9, 3);
+    if(image != original) throw std::runtime_error("four quarter turns are not the identity");
+    //== a half turn equals two quarter turns, and two half turns are the identity for any shape
+    auto half = original;
+    mkl::rotate_half_turn(half.data(), {9, 9});
+    mkl::rotate_quarter_turns(image.data(), 9, 2);
+    if(half != image) throw std::runtime_error("half turn differs from two quarter turns");
+    std::vector<float> wide(6 * 5);
+    for(auto& v : wide) v = rand();
+    auto turned = wide;
+    mkl::rotate_half_turn(turned.data(), {6, 5});
+    if(turned[0] != wide[4 * 6 + 0] || turned[1 * 6 + 1] != wide[3 * 6 + 5]) throw std::runtime_error("half turn mapping");
+    mkl::rotate_half_turn(turned.data(), {6, 5});
+    if(turned != wide) throw std::runtime_error("two half turns are not the identity");
+}
+
+template<class T> void test_all()
+{
+    for(auto shape : {vec2<size_t>{16, 12}, vec2<size_t>{15, 9}, vec2<size_t>{8, 11}}){
+        test_shift<T>(shape, {0.37, -1.6});
+        test_shift<T>(shape, {-4.5, 2.25});
+        test_roll<T>(shape, {3, -2});
+        test_roll<T>(shape, {-1, 5});
+    }
+    test_rotate<T>({64, 64}, 0.3);
+    test_rotate<T>({64, 64}, 2.0);
+    test_rotate<T>({64, 64}, -1.2);
+    test_rotate<T>({72, 64}, 0.4);
+    //== non-square shapes take an exact half turn first, the shears stay within 90 degrees
+    test_rotate<T>({72, 64}, 2.9);
+    test_rotate<T>({64, 70}, -3.1);
+    test_rotate<T>({72, 64}, 4.0);
+}
+
+int main()
+{
+    test_all<float>();
+    test_all<double>();
+    test_all<std::complex<double>>();
+    test_batch<float>();
+    test_batch<double>();
+    test_quarter_turns();
+    //== the same with every loop split across threads
+    const auto policy = mkl::current_execution_policy();
+    mkl::current_execution_policy().grain = 1;
+    test_all<float>();
+    test_batch<double>();
+    mkl::current_execution_policy() = policy;
+    std::cout << "fourier shift tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <mkl_half_spectrum.hpp>
+#include <mkl_linespace.hpp>
+
+template<class R> double tolerance() {return is_s<R> ? 1e-4 : 1e-10;}
+
+template<class R> std::vector<R> random_image(vec2<size_t> shape)
+{
+    uniform_random<R> rand(-1, 1);
+    std::vector<R> image(shape[0] * shape[1]);
+    for(auto& v : image) v = rand();
+    return image;
+}
+//== full c2c spectrum of a real image
+template<class R> std::vector<std::complex<R>> full_spectrum(const std::vector<R>& image, vec2<size_t> shape)
+{
+    std::vector<std::complex<R>> in(image.begin(), image.end()), out(in.size());
+    mekil::fft_plan<std::complex<R>>::directional({MKL_LONG(shape[1]), MKL_LONG(shape[0])}, true).forward(in.data(), out.data());
+    return out;
+}
+
+//== coordinates follow fftfreq, the hermitian expansion is the c2c spectrum
+template<class R> void test_layout(vec2<size_t> shape)
+{
+    const vec2<double> pitch{0.5, 2.0};
+    const auto image = random_image<R>(shape);
+    mkl::half_spectrum<R> s(shape, pitch);
+    s.forward(image.data());
+    const auto& v = s.view();
+    std::vector<double> fy(shape[1]);
+    mkl::fftfreq(fy.data(), shape[1], pitch[1]);
+    for(size_t y = 0; y < shape[1]; y++){
+        if(std::abs(v.fy(y) - fy[y]) > 1e-12) throw std::runtime_error("fy differs from fftfreq");
+    }
+    for(size_t x = 0; x < v.columns(); x++){
+        if(std::abs(v.fx(x) - double(x) / (shape[0] * pitch[0])) > 1e-12) throw std::runtime_error("fx mismatch");
+    }
+    const auto reference = full_spectrum(image, shape);
+    std::vector<std::complex<R>> full(reference.size());
+    v.to_full(full.data());
+    double norm = 0;
+    for(size_t i = 0; i < full.size(); i++){
+        if(std::abs(full[i] - reference[i]) > tolerance<R>() * 10) throw std::runtime_error("to_full differs from the c2c spectrum");
+        norm += std::norm(reference[i]);
+    }
+    if(std::abs(v.energy() - norm) > tolerance<R>() * norm) throw std::runtime_error("energy does not match the full spectrum");
+}
+
+//== filtering the half spectrum gives the same image as filtering the full spectrum
+template<class R, class F> void test_filter(vec2<size_t> shape, F gain, const std::string& name)
+{
+    const auto [nx, ny] = shape;
+    const auto image = random_image<R>(shape);
+    mkl::half_spectrum<R> s(shape);
+    s.forward(image.data());
+    s.view().apply(gain);
+    std::vector<R> filtered(nx * ny);
+    s.backward(filtered.data());
+
+    auto full = full_spectrum(image, shape);
+    std::vector<double> fx(nx), fy(ny);
+    mkl::fftfreq(fx.data(), nx);
+    mkl::fftfreq(fy.data(), ny);
+    for(size_t y = 0; y < ny; y++) for(size_t x = 0; x < nx; x++) full[y * nx + x] *= R(gain(fx[x], fy[y]));
+    std::vector<std::complex<R>> reference(full.size());
+    mekil::fft_plan<std::complex<R>>::directional({MKL_LONG(ny), MKL_LONG(nx)}, false).backward(full.data(), reference.data());
+    for(size_t i = 0; i < filtered.size(); i++){
+        if(std::abs(filtered[i] - reference[i]) > tolerance<R>()) throw std::runtime_error(name + " differs from the full-spectrum filter");
+    }
+}
+
+//== circular convolution through multiply, padded rows untouched
+template<class R> void test_multiply()
+{
+    const vec2<size_t> shape{9, 6};
+    const size_t pitch = 7;
+    uniform_random<std::complex<R>> rand(-1, 1);
+    std::vector<std::complex<R>> a(pitch * 6), b(pitch * 6);
+    for(auto& v : a) v = rand();
+    for(auto& v : b) v = rand();
+    const auto original = a;
+    mkl::half_spectrum_view<R> va(a.data(), shape, pitch), vb(b.data(), shape, pitch);
+    va.multiply(vb, true);
+    for(size_t y = 0; y < 6; y++) for(size_t x = 0; x < pitch; x++){
+        const std::complex<R> expected = x < va.columns() ? original[y * pitch + x] * std::conj(b[y * pitch + x]) : original[y * pitch + x];
+        if(std::abs(a[y * pitch + x] - expected) > tolerance<R>()) throw std::runtime_error("multiply mismatch");
+    }
+    size_t visited = 0;
+    va.for_each([&](double, double, std::complex<R>& v){
+        #pragma omp atomic
+        visited++;
+        v = 0;
+    });
+    if(visited != va.columns() * 6 || a[pitch + 2] != std::complex<R>(0)) throw std::runtime_error("for_each visited the wrong bins");
+    for(size_t y = 0; y < 6; y++) for(size_t x = va.columns(); x < pitch; x++){
+        if(a[y * pitch + x] != original[y * pitch + x]) throw std::runtime_error("padding modified");
+    }
+}
+
+template<class R> void test_all()
+{
+    for(auto shape : {vec2<size_t>{16, 12}, vec2<size_t>{15, 9}, vec2<size_t>{8, 11}}){
+        test_layout<R>(shape);
+        test_filter<R>(shape, mkl::filter::radial_mask{0.1, 0.3}, "radial band");
+        test_filter<R>(shape, mkl::filter::radial_mask{0, 0.2, false}, "radial high pass");
+        test_filter<R>(shape, mkl::filter::elliptical_mask{0.35, 0.15, 0.6}, "ellipse");
+        test_filter<R>(shape, mkl::filter::gaussian{0.12}, "gaussian");
+        test_filter<R>(shape, mkl::filter::gaussian{0.12, true}, "gaussian high pass");
+        test_filter<R>(shape, mkl::filter::butterworth{0.2, 3}, "butterworth");
+        test_filter<R>(shape, mkl::filter::butterworth{0.2, 2, true}, "butterworth high pass");
+    }
+    test_multiply<R>();
+}
+
+int main()
+{
+    test_all<float>();
+    test_all<double>();
+    //== the same with every loop split across threads
+    const auto policy = mkl::current_execution_policy();
+    mkl::current_execution_policy().grain = 1;
+    test_all<double>();
+    mkl::current_execution_policy() = policy;
+    std::cout << "half spectrum tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <mkl_intergral.hpp>
+
+template<class T> std::vector<T> reference_sat(const std::vector<T>& image, size_t ysize, size_t xsize)
+{
+    std::vector<T> sat(image.size());
+    for(size_t y = 0; y < ysize; y++){
+        T running = T(0);
+        for(size_t x = 0; x < xsize; x++){
+            running += image.at(y * xsize + x);
+            sat.at(y * xsize + x) = running + (y ? sat.at((y - 1) * xsize + x) : T(0));
+        }
+    }
+    return sat;
+}
+template<class T> void check_close(const std::vector<T>& a, const std::vector<T>& b, const std::string& msg)
+{
+    for(size_t i = 0; i < a.size(); i++){
+        if(std::abs(a.at(i) - b.at(i)) > 1e-9 * (1 + std::abs(b.at(i)))){
+            throw std::runtime_error("integral mismatch at " + std::to_string(i) + " in " + msg);
+        }
+    }
+}
+template<class T> void test_integral(size_t ysize, size_t xsize)
+{
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> image(ysize * xsize);
+    for(auto& n : image) n = rand();
+    auto expected = reference_sat(image, ysize, xsize);
+
+    std::vector<T> separable = image;
+    mkl::integral_x<T>({ysize, xsize}, separable.data());
+    mkl::integral_y<T>({ysize, xsize}, separable.data());
+    check_close(separable, expected, "integral_x + integral_y " + std::to_string(ysize) + "x" + std::to_string(xsize));
+
+    std::vector<T> fused = image;
+    mkl::integral_xy<T>({ysize, xsize}, fused.data());
+    check_close(fused, expected, "integral_xy " + std::to_string(ysize) + "x" + std::to_string(xsize));
+}
+int main()
+{
+    std::vector<vec2<size_t>> shapes{{1, 1}, {1, 37}, {53, 1}, {17, 300}, {513, 1031}, {2048, 129}};
+    for(auto mode : {mkl::parallel_mode::outer_loop, mkl::parallel_mode::mkl_internal, mkl::parallel_mode::sequential}){
+        mkl::execution_policy policy;
+        policy.mode = mode;
+        policy.grain = 1024;
+        mkl::set_execution_policy(policy);
+        for(auto [ysize, xsize] : shapes){
+            test_integral<double>(ysize, xsize);
+            test_integral<std::complex<double>>(ysize, xsize);
+        }
+    }
+    std::cout << "all test done\n";
+    return 0;
+}
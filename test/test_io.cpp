@@ -0,0 +1,153 @@
+#include <mkl_io.hpp>
+#include <cstdio>
+
+using namespace mkl::io;
+
+std::string temp_path(const std::string& name)
+{
+    return "/tmp/mekil_test_io_" + std::to_string(::getpid()) + "_" + name;
+}
+
+template<class T> mkl::aligned_vector<T> random_array(size_t n)
+{
+    uniform_random<T> rand(-1, 1);
+    mkl::aligned_vector<T> v(n);
+    for(auto& x : v) x = rand();
+    return v;
+}
+
+//== header written the way numpy writes it (version 1.0, 64-byte aligned)
+void test_npy_header()
+{
+    const std::string h = make_npy_header("<f4", {3, 4});
+    if(0 != h.size() % 64 || '\n' != h.back()) throw std::runtime_error("npy header is not padded to 64 bytes");
+    if(std::string::npos == h.find("{'descr': '<f4', 'fortran_order': False, 'shape': (3, 4), }")) throw std::runtime_error("npy header dict is wrong");
+    const npy_header p = parse_npy_header(h.data(), h.size());
+    if(p.descr != "<f4" || p.fortran_order || p.shape != std::vector<size_t>{3, 4} || p.data_offset != h.size()) throw std::runtime_error("npy header does not round trip");
+    const std::string line = make_npy_header("<c16", {7});
+    if(parse_npy_header(line.data(), line.size()).shape != std::vector<size_t>{7}) throw std::runtime_error("1-d npy shape is wrong");
+
+    const std::string dict = "{'descr': '<f8', 'fortran_order': True, 'shape': (2, 5), }\n";
+    const std::string fortran = std::string("\x93NUMPY\x01\x00", 8) + char(dict.size()) + '\0' + dict;
+    const npy_header f = parse_npy_header(fortran.data(), fortran.size());
+    if(!f.fortran_order || f.shape != std::vector<size_t>{2, 5}) throw std::runtime_error("fortran npy header is wrong");
+}
+
+template<class T> void test_npy()
+{
+    const std::string path = temp_path("a.npy");
+    const std::vector<size_t> shape{5, 6, 7};
+    const auto data = random_array<T>(5 * 6 * 7);
+    write_npy<T>(path, array_view<const T>{data.data(), shape, 7});
+
+    auto mapped = map_npy<T>(path);
+    const auto v = mapped.view();
+    if(v.shape != shape || v.row_pitch != 7) throw std::runtime_error("mapped npy shape is wrong");
+    if(0 != reinterpret_cast<uintptr_t>(v.data) % mkl::memory::alignment) throw std::runtime_error("mapped npy data is not 64-byte aligned");
+    if(!std::equal(data.begin(), data.end(), v.data)) throw std::runtime_error("npy round trip mismatch");
+    bool refused = false;
+    try{ mapped.mutable_view(); } catch(const std::logic_error&){ refused = true; }
+    if(!refused) throw std::runtime_error("read-only mapping handed out a writable view");
+
+    //== private mapping : writes do not reach the file
+    {
+        auto cow = map_npy<T>(path, access::copy_on_write);
+        cow.mutable_view().data[0] = T(42);
+    }
+    if(map_npy<T>(path).view().data[0] != data[0]) throw std::runtime_error("copy-on-write mapping changed the file");
+
+    bool rejected = false;
+    try{ map_npy<std::conditional_t<is_s<T>, double, float>>(path); } catch(const std::runtime_error&){ rejected = true; }
+    if(!rejected) throw std::runtime_error("dtype mismatch not detected");
+    std::remove(path.c_str());
+}
+
+//== padded raw file : rows padded to the in-place fft layout, read back packed and padded
+template<class T> void test_raw()
+{
+    const std::string path = temp_path("a.raw");
+    const size_t h = 9, w = 10, pitch = padded_width<T>(w);
+    const auto data = random_array<T>(h * w);
+    {
+        auto file = create_raw<T>(path, {h, w}, pitch);
+        copy_rows<T>(array_view<const T>{data.data(), {h, w}, w}, file.mutable_view());
+    }
+    auto mapped = map_raw<T>(path, {h, w}, access::read_only, 0, pitch);
+    mkl::aligned_vector<T> padded(h * pitch, T(-7));
+    load_padded<T>(mapped.view(), padded.data());
+    for(size_t r = 0; r < h; r++){
+        for(size_t c = 0; c < w; c++){
+            if(padded[r * pitch + c] != data[r * w + c] || mapped.view().row(r)[c] != data[r * w + c]) throw std::runtime_error("raw padded round trip mismatch");
+        }
+    }
+    bool short_file = false;
+    try{ map_raw<T>(path, {h + 1, pitch}); } catch(const std::runtime_error&){ short_file = true; }
+    if(!short_file) throw std::runtime_error("raw file size not checked");
+    std::remove(path.c_str());
+}
+
+//== a strided plan reads the padded mapping directly and matches the packed transform
+template<class T> void test_fft_from_mapping()
+{
+    const std::string path = temp_path("fft.raw");
+    const size_t batch = 3, h = 8, w = 6, pitch = w + 3, nf = h * (is_real_v<T> ? w / 2 + 1 : w);
+    const auto data = random_array<T>(batch * h * w);
+    {
+        auto file = create_raw<T>(path, {batch, h, w}, pitch);
+        copy_rows<T>(array_view<const T>{data.data(), {batch, h, w}, w}, file.mutable_view());
+    }
+    auto mapped = map_raw<T>(path, {batch, h, w}, access::read_only, 0, pitch);
+    mkl::aligned_vector<complex_t<T>> from_mapping(batch * nf), reference(batch * nf);
+    forward_plan(mapped.view(), 2).forward(mapped.view().data, from_mapping.data());
+    mekil::fft_plan<T>::directional({MKL_LONG(h), MKL_LONG(w)}, true, int(batch)).forward(data.data(), reference.data());
+    for(size_t i = 0; i < reference.size(); i++){
+        if(std::abs(from_mapping[i] - reference[i]) > (is_s<real_t<T>> ? 1e-4 : 1e-10)) throw std::runtime_error("fft of the mapping mismatch");
+    }
+    std::remove(path.c_str());
+}
+
+void test_npz()
+{
+    const std::string path = temp_path("a.npz");
+    const auto a = random_array<float>(4 * 5);
+    const auto b = random_array<std::complex<double>>(3 * 2 * 7);
+    write_npz(path, {npz_entry("image", array_view<const float>{a.data(), {4, 5}, 5}),
+                     npz_entry("volume", array_view<const std::complex<double>>{b.data(), {3, 2, 7}, 7})});
+
+    auto image = map_npz<float>(path, "image");
+    auto volume = map_npz<std::complex<double>>(path, "volume.npy");
+    if(image.shape() != std::vector<size_t>{4, 5} || volume.shape() != std::vector<size_t>{3, 2, 7}) throw std::runtime_error("npz shapes are wrong");
+    if(0 != reinterpret_cast<uintptr_t>(volume.view().data) % mkl::memory::alignment) throw std::runtime_error("npz member is not 64-byte aligned");
+    if(!std::equal(a.begin(), a.end(), image.view().data) || !std::equal(b.begin(), b.end(), volume.view().data)) throw std::runtime_error("npz round trip mismatch");
+
+    //== the stored crc is the one of the member
+    const auto& f = image.file();
+    const char* local = f.data();
+    const size_t data = 30 + mkl::io::detail::read_le(local + 26, 2) + mkl::io::detail::read_le(local + 28, 2);
+    if(mkl::io::detail::read_le(local + 14, 4) != mkl::io::detail::crc32(f.data() + data, mkl::io::detail::read_le(local + 18, 4)))
+        throw std::runtime_error("npz crc is wrong");
+
+    bool missing = false;
+    try{ map_npz<float>(path, "nothing"); } catch(const std::runtime_error&){ missing = true; }
+    if(!missing) throw std::runtime_error("missing npz member not reported");
+    std::remove(path.c_str());
+}
+
+template<class T> void test_all()
+{
+    test_npy<T>();
+    test_raw<T>();
+    test_fft_from_mapping<T>();
+}
+
+int main()
+{
+    test_npy_header();
+    test_all<float>();
+    test_all<double>();
+    test_all<std::complex<float>>();
+    test_all<std::complex<double>>();
+    test_npz();
+    std::cout << "io tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <mkl_krylov.hpp>
+
+template<class T> T conj_of(const T& v)
+{
+    if constexpr(is_complex_v<T>) return std::conj(v);
+    else return v;
+}
+template<class T> std::vector<T> random_matrix(size_t n, bool hermitian)
+{
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> A(n * n);
+    for(auto& a : A) a = rand();
+    if(hermitian){
+        for(size_t j = 0; j < n; j++) for(size_t i = 0; i <= j; i++){
+            A[j * n + i] = (A[j * n + i] + conj_of(A[i * n + j])) * real_t<T>(0.5);
+            A[i * n + j] = conj_of(A[j * n + i]);
+        }
+    }
+    return A;
+}
+//== ||A x - lambda x|| for every returned pair
+template<class T, class TValue, class TVector> void check_residual(const std::vector<T>& A, size_t n,
+    const mkl::krylov::eigen_result<TValue, TVector>& r, double tol, const std::string& msg)
+{
+    for(size_t k = 0; k < r.values.size(); k++){
+        const TVector* x = r.vectors.data() + k * n;
+        double res = 0;
+        for(size_t i = 0; i < n; i++){
+            TVector s = 0;
+            for(size_t j = 0; j < n; j++) s += TVector(A[j * n + i]) * x[j];
+            res += std::norm(s - TVector(r.values[k]) * x[i]);
+        }
+        if(std::sqrt(res) > tol * std::max(1.0, double(std::abs(r.values[k])))){
+            throw std::runtime_error("krylov residual " + std::to_string(std::sqrt(res)) + " in " + msg);
+        }
+    }
+}
+template<class T> auto dense_operator(const std::vector<T>& A, size_t n)
+{
+    return [&A, n](const T* x, T* y){
+        mkl::blas::gemv<T>(CblasNoTrans, n, n, T(1), A.data(), n, x, 1, T(0), y, 1);
+    };
+}
+
+template<class T> void test_eigsh(size_t n, mkl::krylov::which target, double tol, int block_size = 1)
+{
+    auto A = random_matrix<T>(n, true);
+    mkl::krylov::options opt;
+    opt.nev = 4;
+    opt.block_size = block_size;
+    opt.target = target;
+    opt.tol = is_s<T> || is_c<T> ? 1e-5 : 1e-10;
+    auto r = mkl::krylov::eigsh<T>(dense_operator(A, n), n, opt);
+    if(r.converged < opt.nev) throw std::runtime_error("eigsh did not converge");
+
+    auto S = A;
+    std::vector<real_t<T>> w(n);
+    if(0 != mkl::lapack::heev<T>('N', n, S.data(), n, w.data())) throw std::runtime_error("heev failed");
+    std::stable_sort(w.begin(), w.end(), [&](auto a, auto b){
+        return mkl::krylov::priority(target, a) > mkl::krylov::priority(target, b);
+    });
+    for(int k = 0; k < opt.nev; k++){
+        if(std::abs(r.values[k] - w[k]) > tol * std::max<double>(1, std::abs(w[k]))){
+            throw std::runtime_error("eigsh eigenvalue mismatch");
+        }
+    }
+    check_residual(A, n, r, tol, "eigsh");
+}
+template<class T> void test_eigs(size_t n, mkl::krylov::which target, double tol, int block_size = 1)
+{
+    auto A = random_matrix<T>(n, false);
+    mkl::krylov::options opt;
+    opt.nev = 3;
+    opt.ncv = 30;
+    opt.block_size = block_size;
+    opt.target = target;
+    opt.tol = is_s<T> || is_c<T> ? 1e-5 : 1e-10;
+    auto r = mkl::krylov::eigs<T>(dense_operator(A, n), n, opt);
+    if(r.converged < opt.nev) throw std::runtime_error("eigs did not converge");
+
+    auto S = A, Q = A;
+    std::vector<complex_t<T>> w(n);
+    if(0 != mkl::lapack::gees<T>(n, S.data(), n, w.data(), Q.data(), n)) throw std::runtime_error("gees failed");
+    std::stable_sort(w.begin(), w.end(), [&](auto a, auto b){
+        return mkl::krylov::priority(target, a) > mkl::krylov::priority(target, b);
+    });
+    //== every returned value must be one of the wanted ones (conjugate pairs may tie)
+    for(int k = 0; k < opt.nev; k++){
+        double best = 1e30;
+        for(int i = 0; i < opt.nev + 1; i++) best = std::min(best, double(std::abs(r.values[k] - w[i])));
+        if(best > tol * std::max<double>(1, std::abs(w[k]))) throw std::runtime_error("eigs eigenvalue mismatch");
+    }
+    check_residual(A, n, r, tol, "eigs");
+}
+
+//== a doubly degenerate top eigenvalue : the block solver recovers both copies
+void test_repeated_eigenvalue(size_t n)
+{
+    auto op = [n](const double* x, double* y){
+        for(size_t i = 0; i < n; i++) y[i] = (i < 2 ? 10.0 : 1.0 / double(i)) * x[i];
+    };
+    mkl::krylov::options opt;
+    opt.nev = 3;
+    opt.block_size = 2;
+    opt.tol = 1e-10;
+    auto r = mkl::krylov::eigsh<double>(op, n, opt);
+    if(r.converged < 3 || std::abs(r.values[0] - 10) > 1e-8 || std::abs(r.values[1] - 10) > 1e-8 || std::abs(r.values[2] - 0.5) > 1e-8){
+        throw std::runtime_error("block eigsh missed a repeated eigenvalue");
+    }
+}
+
+//== few distinct eigenvalues : the block Krylov space becomes invariant after a few steps and
+//   columns deflate. 9, 7 x2, 5 x3, then 2 and 1 repeated, in a random orthonormal basis
+template<class T> void test_clustered_spectrum(size_t n, int block_size, unsigned seed)
+{
+    std::vector<real_t<T>> lambda(n);
+    for(size_t i = 0; i < n; i++) lambda[i] = i == 0 ? 9 : i < 3 ? 7 : i < 6 ? 5 : i % 2 ? 2 : 1;
+    auto Q = random_matrix<T>(n, false);
+    std::vector<T> tau(n);
+    if(0 != mkl::lapack::geqrf<T>(n, n, Q.data(), n, tau.data())) throw std::runtime_error("geqrf failed");
+    if(0 != mkl::lapack::ungqr<T>(n, n, n, Q.data(), n, tau.data())) throw std::runtime_error("ungqr failed");
+    std::vector<T> A(n * n, T(0));
+    for(size_t j = 0; j < n; j++) for(size_t i = 0; i < n; i++){
+        T s = 0;
+        for(size_t k = 0; k < n; k++) s += Q[k * n + i] * lambda[k] * conj_of(Q[k * n + j]);
+        A[j * n + i] = s;
+    }
+    mkl::krylov::options opt;
+    opt.nev = 4;
+    opt.block_size = block_size;
+    opt.seed = seed;
+    opt.tol = 1e-10;
+    auto r = mkl::krylov::eigsh<T>(dense_operator(A, n), n, opt);
+    const std::string name = "clustered spectrum, block " + std::to_string(block_size) + ", seed " + std::to_string(seed);
+    if(r.converged < opt.nev) throw std::runtime_error("eigsh did not converge on the " + name);
+    const double expected[4] = {9, 7, 7, 5};
+    for(int k = 0; k < opt.nev; k++){
+        if(std::abs(r.values[k] - expected[k]) > 1e-8) throw std::runtime_error("eigsh value " + std::to_string(double(r.values[k])) + " on the " + name);
+    }
+    check_residual(A, n, r, 1e-8, name);
+}
+
+int main()
+{
+    using mkl::krylov::which;
+    test_eigsh<double>(300, which::largest_magnitude, 1e-8);
+    test_eigsh<double>(300, which::smallest_real, 1e-8);
+    test_eigsh<float>(200, which::largest_real, 1e-3);
+    test_eigsh<std::complex<double>>(200, which::largest_magnitude, 1e-8);
+    test_eigs<double>(200, which::largest_magnitude, 1e-8);
+    test_eigs<double>(200, which::largest_real, 1e-8);
+    test_eigs<float>(150, which::largest_magnitude, 1e-3);
+    test_eigs<std::complex<double>>(200, which::largest_magnitude, 1e-8);
+    test_eigs<std::complex<float>>(150, which::largest_real, 1e-3);
+    test_eigsh<double>(300, which::largest_magnitude, 1e-8, 4);
+    test_eigsh<std::complex<double>>(200, which::smallest_real, 1e-8, 3);
+    test_eigs<double>(200, which::largest_magnitude, 1e-8, 4);
+    test_eigs<std::complex<float>>(150, which::largest_real, 1e-3, 2);
+    test_repeated_eigenvalue(400);
+    for(int b = 1; b <= 4; b++) for(unsigned seed : {0u, 1u, 7u}) test_clustered_spectrum<double>(80, b, seed);
+    test_clustered_spectrum<std::complex<double>>(80, 2, 3);
+    std::cout << "krylov tests passed" << std::endl;
+    return 0;
+}
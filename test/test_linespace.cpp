@@ -35,5 +35,45 @@ int main()
         mkl::meshgrid_nd(out.data(), num, start, step);
         print_matrix(out, product(num)/num.front(), num.front());
     }
-    
+
+    // ===== meshgrid_nd vs lazy grid =====
+    {
+        vec<size_t, 3> num = {37, 5, 300};
+        vec<double, 3> start = {-1.0, 2.0, 0.5};
+        vec<double, 3> step = {0.25, -1.0, 0.01};
+        std::vector<vec3<double>> out(product(num));
+        mkl::meshgrid_nd(out.data(), num, start, step);
+        auto grid = mkl::make_grid(num, start, step);
+        for (size_t i = 0; i < out.size(); i++) {
+            auto idx = grid.unravel(i);
+            for (size_t d = 0; d < 3; d++) {
+                if (out[i][d] != start[d] + step[d] * double(idx[d])) throw std::runtime_error("meshgrid_nd mismatch");
+            }
+            if (grid.at(i) != out[i]) throw std::runtime_error("grid_nd::at mismatch");
+        }
+        std::vector<int> visited(out.size(), 0);
+        grid.for_each([&](size_t linear, const vec3<double>& coord) {
+            if (coord != out[linear]) throw std::runtime_error("grid_nd::for_each mismatch");
+            visited[linear]++;
+        });
+        if (std::count(visited.begin(), visited.end(), 1) != (long)visited.size()) throw std::runtime_error("grid_nd::for_each coverage");
+    }
+
+    // ===== kspace : shifted grid == fftshift(unshifted grid) =====
+    for (vec<size_t, 2> num : {vec<size_t, 2>{8, 6}, vec<size_t, 2>{7, 5}}) {
+        vec<double, 2> pitch = {0.5, 2.0};
+        std::vector<std::complex<double>> k(product(num)), k_shifted(product(num));
+        mkl::kspace(k.data(), num, pitch, false);
+        mkl::kspace(k_shifted.data(), num, pitch, true);
+        fftshift(k.data(), num[0], num[1]);
+        if (k != k_shifted) throw std::runtime_error("kspace shift convention mismatch");
+
+        std::vector<double> f(num[0]);
+        mkl::fftfreq(f.data(), num[0], pitch[0]);
+        for (size_t i = 0; i < num[0]; i++) {
+            double expected = (i < (num[0] + 1) / 2 ? double(i) : double(i) - double(num[0])) / (num[0] * pitch[0]);
+            if (std::abs(f[i] - expected) > 1e-15) throw std::runtime_error("fftfreq mismatch");
+        }
+    }
+    std::cout << "All tests passed!" << std::endl;
 }
\ No newline at end of file
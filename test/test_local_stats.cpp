@@ -0,0 +1,69 @@
+#include <mkl_local_stats.hpp>
+
+template<class T> void check_close(const std::vector<T>& a, const std::vector<double>& b, double tol, const std::string& msg)
+{
+    for(size_t i = 0; i < a.size(); i++){
+        if(std::abs(double(a.at(i)) - b.at(i)) > tol * (1 + std::abs(b.at(i)))){
+            throw std::runtime_error("local stats mismatch at " + std::to_string(i) + " in " + msg);
+        }
+    }
+}
+template<class T> void test_local_stats(size_t ysize, size_t xsize, vec2<size_t> radius, bool compensated)
+{
+    uniform_random<T> rand(100, 101);
+    std::vector<T> image(ysize * xsize);
+    for(auto& n : image) n = rand();
+    mkl::integral_image<T> sat({ysize, xsize}, image.data(), true, compensated);
+
+    const auto [ry, rx] = radius;
+    std::vector<double> mean(image.size()), var(image.size());
+    for(size_t y = 0; y < ysize; y++){
+        for(size_t x = 0; x < xsize; x++){
+            size_t y0 = y > ry ? y - ry : 0, y1 = std::min(ysize, y + ry + 1);
+            size_t x0 = x > rx ? x - rx : 0, x1 = std::min(xsize, x + rx + 1);
+            double s = 0, sq = 0, n = double((y1 - y0) * (x1 - x0));
+            for(size_t i = y0; i < y1; i++) for(size_t j = x0; j < x1; j++){
+                s += image.at(i * xsize + j);
+            }
+            for(size_t i = y0; i < y1; i++) for(size_t j = x0; j < x1; j++){
+                double d = image.at(i * xsize + j) - s / n;
+                sq += d * d;
+            }
+            mean.at(y * xsize + x) = s / n;
+            var.at(y * xsize + x) = sq / n;
+        }
+    }
+    std::vector<T> out(image.size());
+    sat.box_mean(radius, out.data());
+    check_close(out, mean, is_s<T> ? 1e-6 : 1e-12, "box_mean");
+    sat.box_variance(radius, out.data());
+    check_close(out, var, 1e-3, "box_variance");
+
+    const size_t wy = 2 * ry + 1, wx = 2 * rx + 1;
+    if(wy > ysize || wx > xsize) return;
+    std::vector<T> ncc((ysize - wy + 1) * (xsize - wx + 1));
+    std::vector<double> expected(ncc.size());
+    for(size_t y = 0; y + wy <= ysize; y++){
+        for(size_t x = 0; x + wx <= xsize; x++){
+            double s = 0, sq = 0;
+            for(size_t i = 0; i < wy; i++) for(size_t j = 0; j < wx; j++) s += image.at((y + i) * xsize + x + j);
+            for(size_t i = 0; i < wy; i++) for(size_t j = 0; j < wx; j++){
+                double d = image.at((y + i) * xsize + x + j) - s / (wy * wx);
+                sq += d * d;
+            }
+            expected.at(y * (xsize - wx + 1) + x) = std::sqrt(sq);
+        }
+    }
+    sat.ncc_denominator({wy, wx}, ncc.data());
+    check_close(ncc, expected, 1e-3, "ncc_denominator");
+}
+int main()
+{
+    test_local_stats<float>(37, 53, {2, 3}, false);
+    test_local_stats<float>(300, 400, {7, 7}, false);
+    test_local_stats<double>(300, 400, {7, 7}, true);
+    test_local_stats<double>(5, 4, {6, 1}, true);
+    test_local_stats<float>(1, 9, {0, 4}, false);
+    std::cout << "all test done\n";
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <mkl_long_fft.hpp>
+
+using namespace mekil;
+
+template<class T> void check_close(const mkl::aligned_vector<T>& a, const mkl::aligned_vector<T>& b, real_t<T> scale, const std::string& what)
+{
+    const real_t<T> tol = (is_s<real_t<T>> ? 1e-4 : 1e-10) * scale;
+    for(size_t i = 0; i < a.size(); i++){
+        if(std::abs(a[i] - b[i]) > tol) throw std::runtime_error(what + " mismatch at " + std::to_string(i) + " : " + std::to_string(std::abs(a[i] - b[i])));
+    }
+}
+
+//== every algorithm against the direct transform, out of place and in place, and back
+template<class T> void test_against_direct(size_t n, long_fft_algorithm algorithm, size_t block_bytes = size_t(256) << 10)
+{
+    uniform_random<T> rand(-1, 1);
+    mkl::aligned_vector<T> x(n), reference(n), y(n), z(n);
+    for(auto& v : x) v = rand();
+    fft_plan<T>::directional({MKL_LONG(n)}, true).forward(x.data(), reference.data());
+
+    long_fft<T> fft(n, algorithm, block_bytes);
+    if(fft.algorithm() != algorithm) throw std::runtime_error("long_fft did not keep the requested algorithm");
+    const std::string what = std::string(long_fft_algorithm_name(algorithm)) + " n=" + std::to_string(n);
+    fft.forward(x.data(), y.data());
+    check_close(y, reference, std::sqrt(real_t<T>(n)), what + " forward");
+    fft.backward(y.data(), z.data());
+    check_close(z, x, 1, what + " round trip");
+
+    z = x;
+    fft.forward(z.data(), z.data());
+    check_close(z, reference, std::sqrt(real_t<T>(n)), what + " in-place forward");
+    fft.backward(z.data(), z.data());
+    check_close(z, x, 1, what + " in-place round trip");
+}
+
+void test_selection()
+{
+    using fft_t = long_fft<std::complex<float>>;
+    if(fft_t::split(4096) != 64 || fft_t::split(6300) != 75 || fft_t::split(8191) != 1) throw std::runtime_error("split is wrong");
+    const size_t saved = long_fft_threshold();
+    if(fft_t::select(4096) != long_fft_algorithm::direct) throw std::runtime_error("small transforms should stay direct");
+    long_fft_threshold() = 1024;
+    if(fft_t::select(4096) != long_fft_algorithm::six_step) throw std::runtime_error("large transforms should use six_step");
+    if(fft_t::select(8191) != long_fft_algorithm::direct) throw std::runtime_error("primes have no 2D split");
+    if(fft_t(8191, long_fft_algorithm::six_step).algorithm() != long_fft_algorithm::direct) throw std::runtime_error("prime sizes must fall back to direct");
+    long_fft_threshold() = saved;
+}
+
+int main()
+{
+    test_selection();
+    for(auto algorithm : {long_fft_algorithm::direct, long_fft_algorithm::four_step, long_fft_algorithm::six_step}){
+        test_against_direct<std::complex<float>>(4096, algorithm);
+        test_against_direct<std::complex<double>>(4096, algorithm);
+        test_against_direct<std::complex<double>>(6300, algorithm);
+        test_against_direct<std::complex<float>>(2 * 3 * 5 * 7 * 11, algorithm);
+    }
+    //== small blocks and no grain : every pass runs on several threads with a remainder block
+    auto policy = mkl::current_execution_policy();
+    mkl::current_execution_policy().grain = 1;
+    test_against_direct<std::complex<double>>(6300, long_fft_algorithm::four_step, 1000);
+    test_against_direct<std::complex<double>>(6300, long_fft_algorithm::six_step, 1000);
+    mkl::current_execution_policy() = policy;
+    std::cout << "long fft tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <mkl_krylov.hpp>
+
+//== A = diag(1 / (n - i)) + 0.01 * (shift up + shift down), symmetric, well separated top eigenvalues
+template<class T> struct tridiagonal
+{
+    size_t n;
+    std::vector<MKL_INT> row_ptr, col_idx;
+    std::vector<T> values;
+    T diagonal(size_t i) const {return T(1.0 / double(n - i));}
+    explicit tridiagonal(size_t n_, bool upper_only = false) : n(n_)
+    {
+        row_ptr.push_back(0);
+        for(size_t i = 0; i < n; i++){
+            if(!upper_only && i > 0) {col_idx.push_back(MKL_INT(i - 1)); values.push_back(T(0.01));}
+            col_idx.push_back(MKL_INT(i)); values.push_back(diagonal(i));
+            if(i + 1 < n) {col_idx.push_back(MKL_INT(i + 1)); values.push_back(T(0.01));}
+            row_ptr.push_back(MKL_INT(col_idx.size()));
+        }
+    }
+    std::vector<T> dense() const
+    {
+        std::vector<T> A(n * n, T(0));
+        for(size_t i = 0; i < n; i++){
+            A[i * n + i] = diagonal(i);
+            if(i + 1 < n) A[i * n + i + 1] = A[(i + 1) * n + i] = T(0.01);
+        }
+        return A;
+    }
+};
+
+template<class T> void check_equal(const std::vector<T>& a, const std::vector<T>& b, double tol, const std::string& msg)
+{
+    for(size_t i = 0; i < a.size(); i++){
+        if(std::abs(a[i] - b[i]) > tol * (1 + std::abs(b[i]))) throw std::runtime_error("operator mismatch in " + msg);
+    }
+}
+
+template<class T> void test_products(size_t n)
+{
+    tridiagonal<T> A(n), U(n, true);
+    auto D = A.dense();
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> x(n), expected(n), y(n);
+    for(auto& v : x) v = rand();
+    for(size_t i = 0; i < n; i++) for(size_t j = 0; j < n; j++) expected[i] += D[i * n + j] * x[j];
+
+    mkl::dense_operator<T>(n, n, D.data(), n, CblasRowMajor).apply(x.data(), y.data());
+    check_equal(y, expected, 1e-5, "dense");
+    auto csr = mkl::sparse_operator<T>::csr(n, n, A.row_ptr.data(), A.col_idx.data(), A.values.data());
+    csr(x.data(), y.data());
+    check_equal(y, expected, 1e-5, "csr");
+    auto sym = mkl::sparse_operator<T>::csr(n, n, U.row_ptr.data(), U.col_idx.data(), U.values.data(), mkl::hermitian_descr<T>());
+    sym(x.data(), y.data());
+    check_equal(y, expected, 1e-5, "csr upper");
+
+    //== the same matrix as 2x2 blocks (row-major inside each block)
+    const size_t nb = n / 2;
+    std::vector<MKL_INT> brow{0}, bcol;
+    std::vector<T> bval;
+    for(size_t bi = 0; bi < nb; bi++){
+        for(size_t bj = bi > 0 ? bi - 1 : 0; bj < std::min(nb, bi + 2); bj++){
+            bcol.push_back(MKL_INT(bj));
+            for(size_t i = 0; i < 2; i++) for(size_t j = 0; j < 2; j++) bval.push_back(D[(2 * bi + i) * n + 2 * bj + j]);
+        }
+        brow.push_back(MKL_INT(bcol.size()));
+    }
+    auto bsr = mkl::sparse_operator<T>::bsr(nb, nb, 2, brow.data(), bcol.data(), bval.data());
+    bsr(x.data(), y.data());
+    check_equal(y, expected, 1e-5, "bsr");
+
+    //== block products, column-major X
+    std::vector<T> X(n * 3), Y(n * 3);
+    for(size_t k = 0; k < 3; k++) std::copy(x.begin(), x.end(), X.begin() + k * n);
+    csr.apply_block(X.data(), 3, n, Y.data(), n);
+    for(size_t k = 0; k < 3; k++) check_equal(std::vector<T>(Y.begin() + k * n, Y.begin() + (k + 1) * n), expected, 1e-5, "csr block");
+}
+
+//== the eigensolver only sees products : the CSR operator and a matrix-free callback agree
+template<class T> void test_eigsh(size_t n)
+{
+    tridiagonal<T> U(n, true);
+    auto csr = mkl::sparse_operator<T>::csr(n, n, U.row_ptr.data(), U.col_idx.data(), U.values.data(), mkl::hermitian_descr<T>());
+    auto stencil = mkl::make_operator<T>(n, [n](const T* x, T* y){
+        for(size_t i = 0; i < n; i++){
+            T s = T(1.0 / double(n - i)) * x[i];
+            if(i > 0) s += T(0.01) * x[i - 1];
+            if(i + 1 < n) s += T(0.01) * x[i + 1];
+            y[i] = s;
+        }
+    });
+    mkl::krylov::options opt;
+    opt.nev = 5;
+    opt.tol = 1e-10;
+    opt.target = mkl::krylov::which::largest_real;
+    auto r0 = mkl::krylov::eigsh(csr, opt);
+    auto r1 = mkl::krylov::eigsh(stencil, opt);
+    if(r0.converged < opt.nev || r1.converged < opt.nev) throw std::runtime_error("eigsh did not converge");
+    check_equal(r0.values, r1.values, 1e-9, "eigsh csr vs callback");
+
+    if(n > 2000) return;
+    auto D = U.dense();
+    std::vector<real_t<T>> w(n);
+    mkl::lapack::heev<T>('N', n, D.data(), n, w.data());
+    for(int k = 0; k < opt.nev; k++){
+        if(std::abs(r0.values[k] - w[n - 1 - k]) > 1e-8) throw std::runtime_error("eigsh vs heev mismatch");
+    }
+}
+
+int main()
+{
+    test_products<double>(64);
+    test_products<float>(64);
+    test_products<std::complex<double>>(64);
+    test_eigsh<double>(1000);
+    test_eigsh<double>(200000);
+    std::cout << "operator tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <mkl_out_of_core.hpp>
+
+using namespace mkl;
+
+std::string temp_path(const std::string& name)
+{
+    return "/tmp/mekil_test_ooc_" + std::to_string(::getpid()) + "_" + name;
+}
+template<class T> real_t<T> tolerance() {return is_s<real_t<T>> ? 1e-4 : 1e-10;}
+template<class T> void check_close(const T* a, const T* b, size_t n, real_t<T> scale, const std::string& what)
+{
+    for(size_t i = 0; i < n; i++){
+        if(std::abs(a[i] - b[i]) > tolerance<T>() * scale) throw std::runtime_error(what + " mismatch at " + std::to_string(i));
+    }
+}
+
+//== a budget of a few KiB forces many slabs and tiles, with and without prefetching
+template<class T> void test_complex(std::vector<size_t> shape, bool prefetch)
+{
+    using plan_t = mekil::fft_plan<T>;
+    const size_t N = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+    uniform_random<T> rand(-1, 1);
+    aligned_vector<T> data(N);
+    for(auto& x : data) x = rand();
+
+    const std::string path = temp_path("c2c.raw");
+    auto file = io::create_raw<T>(path, shape);
+    std::copy(data.begin(), data.end(), file.mutable_view().data);
+    out_of_core::options opt;
+    opt.memory_budget = 4096;
+    opt.prefetch = prefetch;
+    out_of_core::fft(file, true, opt);
+
+    aligned_vector<T> reference(N);
+    plan_t::directional(std::vector<MKL_LONG>(shape.begin(), shape.end()), true).forward(data.data(), reference.data());
+    check_close(file.view().data, reference.data(), N, std::sqrt(real_t<T>(N)), "out-of-core forward");
+
+    opt.scratch_directory = "/tmp";
+    out_of_core::fft(file.mutable_view(), false, opt);
+    check_close(file.view().data, data.data(), N, 1, "out-of-core round trip");
+    std::remove(path.c_str());
+}
+
+template<class T> void test_real(std::vector<size_t> shape)
+{
+    using complex_type = complex_t<T>;
+    std::vector<size_t> half = shape;
+    half.back() = half.back() / 2 + 1;
+    const size_t N = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+    const size_t NF = N / shape.back() * half.back();
+    uniform_random<T> rand(-1, 1);
+
+    const std::string in_path = temp_path("r.raw"), out_path = temp_path("h.raw");
+    auto input = io::create_raw<T>(in_path, shape);
+    for(size_t i = 0; i < N; i++) input.mutable_view().data[i] = rand();
+    auto spectrum = io::create_raw<complex_type>(out_path, half);
+    out_of_core::options opt;
+    opt.memory_budget = 8192;
+    out_of_core::rfft<T>(input, spectrum, opt);
+
+    aligned_vector<complex_type> reference(NF);
+    mekil::fft_plan<T>::directional(std::vector<MKL_LONG>(shape.begin(), shape.end()), true).forward(input.view().data, reference.data());
+    check_close(spectrum.view().data, reference.data(), NF, std::sqrt(real_t<T>(N)), "out-of-core rfft");
+
+    auto output = io::create_raw<T>(in_path + ".back", shape);
+    opt.scratch_directory = "/tmp";
+    out_of_core::irfft<T>(spectrum.view(), output.mutable_view(), opt);
+    check_close(output.view().data, input.view().data, N, 1, "out-of-core irfft");
+    std::remove(in_path.c_str());
+    std::remove(out_path.c_str());
+    std::remove((in_path + ".back").c_str());
+}
+
+//== views do not know where their data lives : no silent fallback to a RAM-backed temp directory
+void test_scratch_directory()
+{
+    const std::string path = temp_path("dir.raw");
+    auto file = io::create_raw<std::complex<float>>(path, {4, 4});
+    bool thrown = false;
+    try{
+        out_of_core::fft(file.mutable_view(), true);
+    }
+    catch(const std::invalid_argument&){
+        thrown = true;
+    }
+    std::remove(path.c_str());
+    if(!thrown) throw std::runtime_error("view transform without a scratch directory was accepted");
+    if(out_of_core::detail::beside(file.file(), {}).scratch_directory != "/tmp") throw std::runtime_error("scratch directory is not the data file's");
+}
+
+//== every prefetch of every pass runs on the same background thread, and its errors reach the caller
+void test_prefetch_thread()
+{
+    std::vector<std::thread::id> loaders;
+    std::vector<size_t> order;
+    for(int pass = 0; pass < 3; pass++){
+        out_of_core::detail::pipelined(5, true,
+            [&](size_t i, int){ if(i > 0) loaders.push_back(std::this_thread::get_id()); },
+            [&](size_t i, int){ order.push_back(i); });
+    }
+    if(loaders.size() != 12 || order.size() != 15) throw std::runtime_error("pipeline skipped blocks");
+    for(auto id : loaders){
+        if(id != loaders.front() || id == std::this_thread::get_id()) throw std::runtime_error("prefetch thread is not reused");
+    }
+    bool thrown = false;
+    try{
+        out_of_core::detail::pipelined(3, true, [](size_t i, int){ if(2 == i) throw std::runtime_error("load"); }, [](size_t, int){});
+    }
+    catch(const std::runtime_error&){
+        thrown = true;
+    }
+    if(!thrown) throw std::runtime_error("prefetch error was lost");
+}
+
+int main()
+{
+    test_scratch_directory();
+    test_prefetch_thread();
+    for(bool prefetch : {true, false}){
+        test_complex<std::complex<float>>({40, 36}, prefetch);
+        test_complex<std::complex<double>>({12, 10, 14}, prefetch);
+    }
+    test_complex<std::complex<double>>({50}, true);
+    test_real<float>({24, 30});
+    test_real<double>({6, 10, 9});
+    test_real<double>({7, 5, 4, 6});
+    std::cout << "out-of-core tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <mkl_randomized.hpp>
+
+//== A = G diag(sigma) H^H + noise, column-major, with sigma_i = 2^-i
+template<class T> std::vector<T> low_rank_matrix(size_t m, size_t n, size_t r, double noise, std::vector<real_t<T>>& sigma)
+{
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> G(m * r), H(n * r), R(r * r), A(m * n);
+    for(auto& v : G) v = rand();
+    for(auto& v : H) v = rand();
+    mkl::block_qr<T>(m, r, G.data(), m, R.data(), r);
+    mkl::block_qr<T>(n, r, H.data(), n, R.data(), r);
+    sigma.resize(r);
+    for(size_t i = 0; i < r; i++){
+        sigma[i] = real_t<T>(std::pow(2.0, -double(i)));
+        mkl::blas::scal<T>(m, T(sigma[i]), G.data() + i * m);
+    }
+    mkl::blas::gemm<T>(CblasNoTrans, mkl::blas::adjoint<T>, m, n, r, T(1), G.data(), m, H.data(), n, T(0), A.data(), m);
+    for(auto& v : A) v += T(noise) * rand();
+    return A;
+}
+
+template<class T> void check_svd(const mkl::randomized::svd_result<T>& r, const std::vector<T>& A, const std::vector<real_t<T>>& sigma, double tol, const std::string& msg)
+{
+    const size_t m = r.m, n = r.n, k = r.rank;
+    for(size_t i = 0; i < k; i++){
+        if(std::abs(r.s[i] - sigma[i]) > tol) throw std::runtime_error("randomized svd " + msg + ": singular value " + std::to_string(i) + " is " + std::to_string(r.s[i]));
+    }
+    //== || A - U S V^H ||_max against the discarded tail
+    std::vector<T> US = r.U, E = A;
+    for(size_t i = 0; i < k; i++) mkl::blas::scal<T>(m, T(r.s[i]), US.data() + i * m);
+    mkl::blas::gemm<T>(CblasNoTrans, mkl::blas::adjoint<T>, m, n, k, T(-1), US.data(), m, r.V.data(), n, T(1), E.data(), m);
+    double err = 0;
+    for(auto& e : E) err = std::max(err, double(std::abs(e)));
+    if(err > 10 * tol + double(sigma.size() > k ? sigma[k] : 0)) throw std::runtime_error("randomized svd " + msg + ": reconstruction error " + std::to_string(err));
+}
+
+template<class T> void test_randomized(size_t m, size_t n, double tol)
+{
+    const size_t r = 8;
+    std::vector<real_t<T>> sigma;
+    auto A = low_rank_matrix<T>(m, n, r, 1e-9, sigma);
+
+    mkl::randomized::options opt;
+    opt.rank = r;
+    check_svd(mkl::randomized::svd(m, n, A.data(), m, opt), A, sigma, tol, "gaussian");
+
+    opt.kind = mkl::randomized::sketch::srft;
+    opt.rank = 5;
+    opt.power_iterations = 1;
+    check_svd(mkl::randomized::svd(mkl::randomized::dense_source<T>(m, n, A.data(), m, 37), opt), A, sigma, tol, "srft");
+
+    //== the same matrix streamed in row-major blocks
+    std::vector<T> row_major(m * n);
+    for(size_t i = 0; i < m; i++) for(size_t j = 0; j < n; j++) row_major[i * n + j] = A[j * m + i];
+    size_t passes = 0;
+    auto source = mkl::randomized::make_row_block_source<T>(m, n, [&](size_t row0, size_t nrows, T* dst){
+        if(0 == row0) passes++;
+        std::copy(row_major.begin() + row0 * n, row_major.begin() + (row0 + nrows) * n, dst);
+    }, 50);
+    for(auto kind : {mkl::randomized::sketch::gaussian, mkl::randomized::sketch::srft}){
+        opt.kind = kind;
+        opt.rank = r;
+        opt.power_iterations = 2;
+        passes = 0;
+        check_svd(mkl::randomized::svd(source, opt), A, sigma, tol, "streamed");
+        //== sketch, 2 x 2 power products, projection
+        if(passes != 6) throw std::runtime_error("streamed source was read " + std::to_string(passes) + " times");
+    }
+}
+
+int main()
+{
+    test_randomized<double>(400, 150, 1e-8);
+    test_randomized<std::complex<double>>(200, 120, 1e-8);
+    test_randomized<float>(300, 100, 1e-4);
+    test_randomized<double>(120, 330, 1e-8);
+    std::cout << "randomized svd tests passed" << std::endl;
+    return 0;
+}
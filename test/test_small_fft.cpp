@@ -0,0 +1,134 @@
+#define MEKIL_FFT_VALIDATE 1
+#include <mkl_small_fft.hpp>
+#include <mkl_fft.hpp>
+
+template<class T> double tolerance() {return is_s<real_t<T>> ? 2e-5 : 1e-12;}
+
+//== O(N^2) reference in long double
+template<class T> std::vector<std::complex<long double>> naive_dft(const std::vector<T>& x, int sign)
+{
+    const size_t N = x.size();
+    std::vector<std::complex<long double>> X(N);
+    for(size_t k = 0; k < N; k++){
+        std::complex<long double> s = 0;
+        for(size_t n = 0; n < N; n++){
+            const long double a = sign * 2 * mekil::detail::small_fft_pi * static_cast<long double>((n * k) % N) / N;
+            s += std::complex<long double>(std::real(x[n]), std::imag(x[n])) * std::complex<long double>(std::cos(a), std::sin(a));
+        }
+        X[k] = s;
+    }
+    return X;
+}
+template<class T> std::vector<T> random_vector(size_t n)
+{
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> v(n);
+    for(auto& x : v) x = rand();
+    return v;
+}
+template<class A, class B> void expect_close(const A& a, const B& b, size_t n, double tol, const std::string& what)
+{
+    for(size_t i = 0; i < n; i++){
+        const std::complex<long double> d = std::complex<long double>(std::real(a[i]), std::imag(a[i])) - std::complex<long double>(std::real(b[i]), std::imag(b[i]));
+        if(std::abs(d) > tol) throw std::runtime_error(what + " mismatch at " + std::to_string(i));
+    }
+}
+
+template<class T, size_t N> void test_size()
+{
+    using fft = mekil::small_fft<T, N>;
+    using C = complex_t<T>;
+    const double tol = tolerance<T>() * N;
+    const std::string name = "N=" + std::to_string(N) + (is_real_v<T> ? " real" : " complex");
+
+    //== pointers against the reference, backward gives the input back
+    const auto x = random_vector<T>(N);
+    std::vector<C> X(fft::fourier_size);
+    fft::forward(x.data(), X.data());
+    expect_close(X, naive_dft(x, -1), fft::fourier_size, tol, name + " forward");
+    std::vector<T> y(N);
+    fft::backward(X.data(), y.data());
+    expect_close(y, x, N, tol, name + " round trip");
+
+    //== ::vec by value and in place
+    ::vec<T, N> v;
+    std::copy(x.begin(), x.end(), v.begin());
+    const auto V = fft::forward(v);
+    expect_close(V, X, fft::fourier_size, tol, name + " vec forward");
+    expect_close(fft::backward(V), x, N, tol, name + " vec backward");
+    ::vec<T, is_real_v<T> ? 2 * fft::fourier_size : N> inplace{};
+    std::copy(x.begin(), x.end(), inplace.begin());
+    fft::forward_inplace(inplace);
+    expect_close(reinterpret_cast<const C*>(inplace.data()), X, fft::fourier_size, tol, name + " in-place forward");
+    fft::backward_inplace(inplace);
+    expect_close(inplace, x, N, tol, name + " in-place backward");
+
+    //== batches with a partial last group and gaps between transforms
+    auto batch = [&](auto lanes){
+        constexpr size_t L = decltype(lanes)::value;
+        const size_t count = 2 * L + 3, in_distance = N + 2, out_distance = fft::fourier_size + 1;
+        const auto stack = random_vector<T>(count * in_distance);
+        std::vector<C> spectra(count * out_distance, C(-7)), one(fft::fourier_size);
+        fft::template forward_batch<L>(stack.data(), in_distance, spectra.data(), out_distance, count);
+        for(size_t b = 0; b < count; b++){
+            fft::forward(stack.data() + b * in_distance, one.data());
+            expect_close(spectra.data() + b * out_distance, one, fft::fourier_size, tol, name + " batch forward");
+            if(spectra[b * out_distance + fft::fourier_size] != C(-7)) throw std::runtime_error(name + " batch wrote past a transform");
+        }
+        std::vector<T> back(count * in_distance, T(0));
+        fft::template backward_batch<L>(spectra.data(), out_distance, back.data(), in_distance, count);
+        for(size_t b = 0; b < count; b++) expect_close(back.data() + b * in_distance, stack.data() + b * in_distance, N, tol, name + " batch backward");
+    };
+    batch(std::integral_constant<size_t, 4>());
+    batch(std::integral_constant<size_t, 8>());
+    batch(std::integral_constant<size_t, 16>());
+    batch(std::integral_constant<size_t, fft::simd_lanes>());
+}
+
+//== same layout and scaling as a descriptor-backed plan
+template<class T> void test_matches_plan()
+{
+    constexpr size_t N = 32;
+    const auto x = random_vector<T>(N);
+    std::vector<complex_t<T>> a(mekil::small_fft<T, N>::fourier_size), b(a.size());
+    mekil::small_fft<T, N>::forward(x.data(), a.data());
+    mekil::fft_plan<T>::directional({MKL_LONG(N)}, true).forward(x.data(), b.data());
+    expect_close(a, b, a.size(), tolerance<T>() * N, "small fft against fft_plan");
+    std::vector<T> y(N), z(N);
+    mekil::small_fft<T, N>::backward(a.data(), y.data());
+    mekil::fft_plan<T>::directional({MKL_LONG(N)}, false).backward(b.data(), z.data());
+    expect_close(y, z, N, tolerance<T>() * N, "small inverse fft against fft_plan");
+}
+
+template<class T> void test_all()
+{
+    test_size<T, 1>();
+    test_size<T, 2>();
+    test_size<T, 3>();
+    test_size<T, 4>();
+    test_size<T, 5>();
+    test_size<T, 6>();
+    test_size<T, 8>();
+    test_size<T, 9>();
+    test_size<T, 12>();
+    test_size<T, 15>();
+    test_size<T, 16>();
+    test_size<T, 20>();
+    test_size<T, 25>();
+    test_size<T, 32>();
+    test_size<T, 45>();
+    test_size<T, 48>();
+    test_size<T, 60>();
+    test_size<T, 64>();
+    test_matches_plan<T>();
+}
+
+int main()
+{
+    test_all<float>();
+    test_all<double>();
+    test_all<std::complex<float>>();
+    test_all<std::complex<double>>();
+    std::cout << "small fft tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <mkl_structured.hpp>
+#include <mkl_krylov.hpp>
+
+template<class T> void check_close(const T* a, const std::vector<T>& b, double tol, const std::string& msg)
+{
+    for(size_t i = 0; i < b.size(); i++){
+        if(std::abs(a[i] - b[i]) > tol * (1 + std::abs(b[i]))) throw std::runtime_error("structured operator mismatch in " + msg);
+    }
+}
+//== y = A x with a dense row-major A
+template<class T> std::vector<T> dense_apply(const std::vector<T>& A, const T* x, size_t n)
+{
+    std::vector<T> y(n, T(0));
+    for(size_t i = 0; i < n; i++) for(size_t j = 0; j < n; j++) y[i] += A[i * n + j] * x[j];
+    return y;
+}
+//== every column of a (ncol x n) block through apply_block, with ld > n and a batch chunk smaller than ncol
+template<class T, class Op> void check_block(const Op& op, const std::vector<T>& A, size_t n, double tol, const std::string& msg)
+{
+    const size_t ncol = 5, ld = n + 3;
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> X(ld * ncol), Y(ld * ncol);
+    for(auto& v : X) v = rand();
+    op.apply_block(X.data(), ncol, ld, Y.data(), ld);
+    for(size_t j = 0; j < ncol; j++) check_close(Y.data() + j * ld, dense_apply(A, X.data() + j * ld, n), tol, msg + " block");
+    std::vector<T> y(n);
+    op.apply(X.data(), y.data());
+    check_close(y.data(), dense_apply(A, X.data(), n), tol, msg);
+}
+
+template<class T> void test_circulant(std::vector<size_t> shape, double tol)
+{
+    const size_t rank = shape.size(), n = rank == 1 ? shape[0] : shape[0] * shape[1];
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> kernel(n);
+    for(auto& v : kernel) v = rand();
+    mkl::circulant_operator<T> op(shape, kernel.data(), 2);
+
+    //== A[i, j] = kernel[(i - j) mod shape], per axis
+    std::vector<T> A(n * n);
+    const size_t ny = rank == 1 ? 1 : shape[0], nx = shape.back();
+    for(size_t i = 0; i < n; i++) for(size_t j = 0; j < n; j++){
+        const size_t dy = (i / nx + ny - j / nx) % ny, dx = (i % nx + nx - j % nx) % nx;
+        A[i * n + j] = kernel[dy * nx + dx];
+    }
+    check_block(op, A, n, tol, "circulant");
+}
+
+template<class T> void test_toeplitz_1d(size_t n, double tol)
+{
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> c(n), r(n);
+    for(auto& v : c) v = rand();
+    for(auto& v : r) v = rand();
+    auto op = mkl::toeplitz_operator<T>::from_column_row(n, c.data(), r.data(), 2);
+    std::vector<T> A(n * n);
+    for(size_t i = 0; i < n; i++) for(size_t j = 0; j < n; j++) A[i * n + j] = i >= j ? c[i - j] : r[j - i];
+    check_block(op, A, n, tol, "toeplitz 1d");
+}
+
+template<class T> void test_bttb(size_t ny, size_t nx, double tol)
+{
+    const size_t ky = 2 * ny - 1, kx = 2 * nx - 1, n = ny * nx;
+    uniform_random<T> rand(-1, 1);
+    std::vector<T> kernel(ky * kx);
+    for(auto& v : kernel) v = rand();
+    mkl::toeplitz_operator<T> op({ny, nx}, kernel.data(), 3);
+    std::vector<T> A(n * n);
+    for(size_t i = 0; i < n; i++) for(size_t j = 0; j < n; j++){
+        const size_t dy = i / nx + ny - 1 - j / nx, dx = i % nx + nx - 1 - j % nx;
+        A[i * n + j] = kernel[dy * kx + dx];
+    }
+    check_block(op, A, n, tol, "bttb");
+}
+
+//== symmetric Toeplitz through the eigensolver, against the dense spectrum
+void test_eigsh_toeplitz(size_t n)
+{
+    std::vector<double> c(n);
+    for(size_t i = 0; i < n; i++) c[i] = 1.0 / (1.0 + double(i * i));
+    auto op = mkl::toeplitz_operator<double>::from_column_row(n, c.data(), c.data());
+    mkl::krylov::options opt;
+    opt.nev = 3;
+    opt.tol = 1e-10;
+    opt.block_size = 2;
+    auto r = mkl::krylov::eigsh(op, opt);
+
+    std::vector<double> A(n * n), w(n);
+    for(size_t i = 0; i < n; i++) for(size_t j = 0; j < n; j++) A[i * n + j] = c[i > j ? i - j : j - i];
+    mkl::lapack::heev<double>('N', n, A.data(), n, w.data());
+    for(int k = 0; k < opt.nev; k++){
+        if(std::abs(r.values[k] - w[n - 1 - k]) > 1e-8) throw std::runtime_error("toeplitz eigsh mismatch");
+    }
+}
+
+int main()
+{
+    test_circulant<double>({48}, 1e-12);
+    test_circulant<std::complex<double>>({35}, 1e-12);
+    test_circulant<float>({12, 10}, 1e-4);
+    test_circulant<std::complex<double>>({9, 6}, 1e-12);
+    test_toeplitz_1d<double>(37, 1e-12);
+    test_toeplitz_1d<std::complex<float>>(20, 1e-4);
+    test_bttb<double>(7, 9, 1e-12);
+    test_bttb<std::complex<double>>(5, 4, 1e-12);
+    test_eigsh_toeplitz(120);
+    std::cout << "structured operator tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <mkl_task.hpp>
+#include <mkl_fft.hpp>
+#include <mkl_intergral.hpp>
+#include <mkl_reshape.hpp>
+#include <chrono>
+#include <ctime>
+
+//== tasks spawning subtasks : every leaf runs exactly once
+size_t count_leaves(mkl::task_group& g, std::atomic<size_t>& leaves, int depth)
+{
+    if(0 == depth){
+        leaves.fetch_add(1);
+        return 1;
+    }
+    for(int i = 0; i < 3; i++) g.spawn([&g, &leaves, depth]{ count_leaves(g, leaves, depth - 1); });
+    return 0;
+}
+void test_spawn(mkl::task_scheduler& s)
+{
+    std::atomic<size_t> leaves{0};
+    mkl::task_group g(s);
+    count_leaves(g, leaves, 7);
+    g.wait();
+    if(leaves != 2187) throw std::runtime_error("spawned subtasks lost or repeated");
+
+    //== nested groups waited on from inside a task
+    std::atomic<size_t> inner{0};
+    mkl::task_group outer(s);
+    for(int i = 0; i < 16; i++){
+        outer.spawn([&]{
+            mkl::task_group g2(s);
+            for(int j = 0; j < 16; j++) g2.spawn([&]{ inner.fetch_add(1); });
+            g2.wait();
+        });
+    }
+    outer.wait();
+    if(inner != 256) throw std::runtime_error("nested groups incomplete");
+}
+
+//== workers run the library sequentially
+void test_worker_settings(mkl::task_scheduler& s)
+{
+    std::atomic<int> bad{0};
+    mkl::task_group g(s);
+    for(int i = 0; i < 64; i++){
+        g.spawn([&]{
+            if(!mkl::in_task_worker() || 1 != mkl::loop_threads(size_t(1) << 30)) bad.fetch_add(1);
+        });
+    }
+    g.wait();
+    if(bad) throw std::runtime_error("library loops are not sequential inside tasks");
+    if(mkl::in_task_worker() || -1 != s.worker_index()) throw std::runtime_error("caller thread marked as a worker");
+}
+
+void test_exception(mkl::task_scheduler& s)
+{
+    std::atomic<int> ran{0};
+    mkl::task_group g(s);
+    for(int i = 0; i < 32; i++){
+        g.spawn([&, i]{
+            ran.fetch_add(1);
+            if(7 == i) throw std::invalid_argument("task 7");
+        });
+    }
+    bool caught = false;
+    try{ g.wait(); } catch(const std::invalid_argument&){ caught = true; }
+    if(!caught || ran != 32) throw std::runtime_error("task exception not propagated");
+}
+
+//== uneven iterations : parallel_tasks visits every index once
+void test_parallel_tasks(mkl::task_scheduler& s)
+{
+    std::vector<std::atomic<int>> hits(1000);
+    mkl::parallel_tasks(0, hits.size(), [&](size_t i){
+        volatile double x = 0;
+        for(size_t k = 0; k < (i % 17) * 1000; k++) x = x + 1;
+        hits[i].fetch_add(1);
+    }, 4, s);
+    for(auto& h : hits) if(1 != h) throw std::runtime_error("parallel_tasks index missed or repeated");
+}
+
+//== mixed small fft / crop / integral jobs of different sizes against the same jobs run serially
+struct job
+{
+    size_t n;
+    std::vector<std::complex<float>> image, spectrum, cropped;
+    std::vector<double> table;
+
+    void run()
+    {
+        const auto& plan = mekil::cached_plan<std::complex<float>>({MKL_LONG(n), MKL_LONG(n)}, true);
+        plan.forward(image.data(), spectrum.data());
+        crop_convert<std::complex<float>, std::complex<float>>(cropped.data(), {n / 2, n / 2}, {0, 0}, spectrum.data(), {n, n}, {n / 4, n / 4}, 0.5f, {}, true);
+        for(size_t i = 0; i < table.size(); i++) table[i] = std::abs(image[i]);
+        mkl::integral_xy<double>({n, n}, table.data());
+    }
+};
+std::vector<job> make_jobs()
+{
+    std::vector<job> jobs;
+    uniform_random<std::complex<float>> rand(-1, 1);
+    for(size_t i = 0; i < 200; i++){
+        const size_t n = 4 + 4 * (i % 7);
+        job j{n, std::vector<std::complex<float>>(n * n), std::vector<std::complex<float>>(n * n), std::vector<std::complex<float>>(n * n / 4), std::vector<double>(n * n)};
+        for(auto& v : j.image) v = rand();
+        jobs.push_back(std::move(j));
+    }
+    return jobs;
+}
+void test_library_jobs(mkl::task_scheduler& s)
+{
+    auto serial = make_jobs();
+    auto tasks = serial;
+    for(auto& j : serial) j.run();
+    mkl::task_group g(s);
+    for(auto& j : tasks) g.spawn([&j]{ j.run(); });
+    g.wait();
+    for(size_t i = 0; i < serial.size(); i++){
+        if(serial[i].spectrum != tasks[i].spectrum || serial[i].cropped != tasks[i].cropped || serial[i].table != tasks[i].table)
+            throw std::runtime_error("job run as a task differs from the serial run");
+    }
+}
+
+//== a thread waiting on running tasks sleeps instead of spinning
+void test_idle_wait(mkl::task_scheduler& s)
+{
+    mkl::task_group g(s);
+    const std::clock_t cpu0 = std::clock();
+    const auto wall0 = std::chrono::steady_clock::now();
+    g.spawn([]{ std::this_thread::sleep_for(std::chrono::milliseconds(300)); });
+    g.wait();
+    const double cpu = double(std::clock() - cpu0) / CLOCKS_PER_SEC;
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+    if(wall < 0.29) throw std::runtime_error("wait returned before the task finished");
+    if(cpu > 0.5 * wall) throw std::runtime_error("waiting burned " + std::to_string(cpu) + " s of cpu in " + std::to_string(wall) + " s");
+}
+
+int main()
+{
+    mkl::task_scheduler s(4);
+    test_spawn(s);
+    test_worker_settings(s);
+    test_exception(s);
+    test_parallel_tasks(s);
+    test_library_jobs(s);
+    test_idle_wait(s);
+    //== the process-wide scheduler
+    test_spawn(mkl::task_scheduler::global());
+    std::cout << "task tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include <mkl_fft.hpp>
+#include <mkl_vec.hpp>
+#include <thread>
+
+using namespace mkl::trace;
+
+const totals& find(const std::map<shape_key, totals>& s, const std::string& name, uint64_t d0 = 0, uint64_t d1 = 0, uint64_t d2 = 0)
+{
+    auto it = s.find({name, d0, d1, d2});
+    if(it == s.end()) throw std::runtime_error("no trace of " + name + " " + std::to_string(d0) + "x" + std::to_string(d1));
+    return it->second;
+}
+
+void test_counts()
+{
+    clear();
+    std::vector<float> image(32 * 16);
+    for(int i = 0; i < 3; i++) fftshift(image.data(), 32, 16);
+    fftshift(image.data(), 15, 7);
+
+    std::vector<std::complex<float>> spectrum(10 * 8);
+    std::vector<float> cropped(6 * 4);
+    crop_to(cropped.data(), {6, 4}, {0, 0}, spectrum.data(), {10, 8}, {2, 2});
+
+    std::vector<double> a(100, 1.0), b(100, 2.0), y(100);
+    mkl::vec::add(100, a.data(), b.data(), y.data());
+    mkl::vec::mul(100, a.data(), b.data(), y.data());
+    mkl::vec::mul(100, 3.0, y.data());
+
+    using fft = mekil::mklFFT<std::complex<double>>;
+    std::vector<std::complex<double>> data(8 * 4);
+    auto plan = fft::make_row_major_plan({8, 4}, true, 0, 1);
+    fft::exec_forward(*plan, data.data());
+    fft::exec_backward(*plan, data.data());
+
+    const auto s = summary();
+    const auto& shift = find(s, "reshape.fftshift", 32, 16);
+    if(shift.count != 3 || shift.bytes != 3 * 2 * sizeof(float) * 32 * 16) throw std::runtime_error("fftshift totals are wrong");
+    if(find(s, "reshape.fftshift", 15, 7).count != 1) throw std::runtime_error("odd fftshift is not a separate shape");
+    if(find(s, "reshape.crop_to", 6, 4).bytes != (sizeof(float) + sizeof(std::complex<float>)) * 24) throw std::runtime_error("crop_to bytes are wrong");
+    if(find(s, "vec.add", 100).count != 1 || find(s, "vec.mul", 100).count != 1 || find(s, "vec.scale", 100).count != 1)
+        throw std::runtime_error("vec kernels are not traced");
+    if(find(s, "fft.make_plan", 8, 4).count != 1) throw std::runtime_error("plan creation is not traced");
+    if(find(s, "fft.exec_forward", 8, 4).count != 1 || find(s, "fft.exec_backward", 8, 4).count != 1) throw std::runtime_error("fft execution is not traced with its shape");
+}
+
+//== every thread records into its own buffer, totals are merged
+void test_threads()
+{
+    clear();
+    std::vector<std::thread> workers;
+    for(int t = 0; t < 4; t++){
+        workers.emplace_back([]{
+            std::vector<double> image(8 * 8);
+            for(int i = 0; i < 50; i++) fftshift(image.data(), 8, 8);
+        });
+    }
+    for(auto& w : workers) w.join();
+    if(find(summary(), "reshape.fftshift", 8, 8).count != 200) throw std::runtime_error("per-thread totals are lost");
+}
+
+//== a full buffer drops events from the trace but keeps the totals exact
+void test_overflow_and_export()
+{
+    clear();
+    set_capacity(4);
+    std::thread([]{
+        std::vector<float> image(4 * 4);
+        for(int i = 0; i < 10; i++) fftshift(image.data(), 4, 4);
+    }).join();
+    set_capacity(size_t(1) << 16);
+    if(find(summary(), "reshape.fftshift", 4, 4).count != 10) throw std::runtime_error("overflow changed the totals");
+
+    const std::string json = chrome_trace();
+    size_t events = 0;
+    for(size_t p = json.find("\"ph\": \"X\""); p != std::string::npos; p = json.find("\"ph\": \"X\"", p + 1)) events++;
+    if(events != 4) throw std::runtime_error("trace holds " + std::to_string(events) + " events instead of 4");
+    if(json.find("\"shape\": \"4x4\"") == std::string::npos || json.find("traceEvents") == std::string::npos)
+        throw std::runtime_error("malformed chrome trace");
+    print_summary();
+}
+
+//== buffers grow by chunks, exited threads are released by print_summary and clear
+void test_growth_and_release()
+{
+    clear();
+    auto& r = detail::global();
+    std::thread([&]{
+        std::vector<float> image(4 * 4);
+        fftshift(image.data(), 4, 4);
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if(r.buffers.back()->chunks.size() != 1) throw std::runtime_error("one event allocated more than one chunk");
+    }).join();
+    std::thread([]{
+        std::vector<float> image(4 * 4);
+        for(size_t i = 0; i < chunk_events + 5; i++) fftshift(image.data(), 4, 4);
+    }).join();
+    const std::string json = chrome_trace();
+    size_t events = 0;
+    for(size_t p = json.find("\"ph\": \"X\""); p != std::string::npos; p = json.find("\"ph\": \"X\"", p + 1)) events++;
+    if(events != chunk_events + 6) throw std::runtime_error("events lost across chunks");
+
+    const size_t before = r.buffers.size();
+    print_summary();
+    if(chrome_trace().find("\"ph\": \"X\"") != std::string::npos) throw std::runtime_error("print_summary kept the events of exited threads");
+    if(find(summary(), "reshape.fftshift", 4, 4).count != chunk_events + 6) throw std::runtime_error("print_summary lost the totals");
+    clear();
+    if(r.buffers.size() != before - 2) throw std::runtime_error("clear kept the buffers of exited threads");
+}
+
+//== the per-shape table is fixed : shapes past its slots are summed under "(other)", none is lost
+void test_shape_table()
+{
+    clear();
+    std::vector<float> image(4 * (shape_slots + 10));
+    for(size_t n = 1; n <= shape_slots + 10; n++) fftshift(image.data(), 4, int(n));
+    const auto s = summary();
+    uint64_t calls = 0;
+    for(auto& [key, t] : s) calls += t.count;
+    if(calls != shape_slots + 10) throw std::runtime_error("calls lost past the shape table");
+    if(find(s, "(other)").count != 10 || find(s, "reshape.fftshift", 4, 1).count != 1) throw std::runtime_error("shape table overflow is wrong");
+}
+
+void test_disabled()
+{
+    clear();
+    set_enabled(false);
+    std::vector<float> image(4 * 4);
+    fftshift(image.data(), 4, 4);
+    set_enabled(true);
+    if(!summary().empty()) throw std::runtime_error("disabled tracing recorded events");
+}
+
+int main()
+{
+#ifdef MEKIL_ENABLE_TRACE
+    test_counts();
+    test_threads();
+    test_overflow_and_export();
+    test_growth_and_release();
+    test_shape_table();
+    test_disabled();
+    std::cout << "trace tests passed" << std::endl;
+#else
+    std::cout << "tracing is compiled out (configure with -DMEKIL_TRACE=ON), trace tests skipped" << std::endl;
+#endif
+    return 0;
+}
@@ -100,6 +100,67 @@ void test_transpose()
     for (int i=0; i<6; i++) std::cout << B[i] << " ";
     std::cout << std::endl;
 }
+//== reference : element (r, c) of a rows x cols matrix in the given layout
+template<class T, bool is_c> std::vector<T> reference_transpose(const std::vector<T>& a, size_t rows, size_t cols)
+{
+    std::vector<T> t(a.size());
+    for(size_t r = 0; r < rows; r++){
+        for(size_t c = 0; c < cols; c++){
+            if constexpr(is_c) t[c * rows + r] = a[r * cols + c];
+            else               t[r * cols + c] = a[c * rows + r];
+        }
+    }
+    return t;
+}
+template<class T> std::vector<T> iota_matrix(size_t n)
+{
+    std::vector<T> a(n);
+    for(size_t i = 0; i < n; i++) a[i] = T(int(i % 100003));
+    return a;
+}
+template<class T, bool is_c> void test_transpose_layout(size_t rows, size_t cols)
+{
+    const auto a = iota_matrix<T>(rows * cols);
+    const auto expect = reference_transpose<T, is_c>(a, rows, cols);
+
+    std::vector<T> b(a.size());
+    transpose<T, is_c>(a.data(), b.data(), {int(rows), int(cols)});
+    check_equal(b, expect, "transpose " + std::to_string(rows) + "x" + std::to_string(cols));
+
+    auto inplace = a;
+    transpose_inplace<T, is_c>(inplace.data(), {rows, cols});
+    check_equal(inplace, expect, "transpose_inplace " + std::to_string(rows) + "x" + std::to_string(cols));
+
+    //== stack with gaps between the images
+    const size_t batch = 5, in_distance = rows * cols + 7, out_distance = rows * cols + 3;
+    std::vector<T> stack(batch * in_distance), out(batch * out_distance, T(-1));
+    for(size_t i = 0; i < batch; i++) std::copy(a.begin(), a.end(), stack.begin() + i * in_distance);
+    transpose_batch<T, is_c>(stack.data(), out.data(), {rows, cols}, batch, in_distance, out_distance);
+    for(size_t i = 0; i < batch; i++){
+        check_equal(std::vector<T>(out.begin() + i * out_distance, out.begin() + i * out_distance + rows * cols), expect, "transpose_batch");
+    }
+}
+template<class T> void test_transpose_type()
+{
+    const std::array<std::array<size_t, 2>, 6> shapes{{{1, 1}, {1, 9}, {64, 64}, {67, 67}, {13, 200}, {301, 37}}};
+    for(const auto& [rows, cols] : shapes){
+        test_transpose_layout<T, true>(rows, cols);
+        test_transpose_layout<T, false>(rows, cols);
+    }
+}
+void test_transposes()
+{
+    auto policy = mkl::current_execution_policy();
+    for(size_t grain : {policy.grain, size_t(1)}){
+        mkl::current_execution_policy().grain = grain;
+        test_transpose_type<float>();
+        test_transpose_type<std::complex<double>>();
+        //== not covered by mkl : cache-oblivious and cycle-following fallbacks
+        test_transpose_type<int>();
+        test_transpose_type<uint16_t>();
+    }
+    mkl::current_execution_policy() = policy;
+}
 int main() {
     try {
         test_int_2D_Cstyle();
@@ -107,6 +168,7 @@ int main() {
         test_double_1D();
         test_int_4D_mixed();
         test_transpose();
+        test_transposes();
     } catch (const std::exception& ex) {
         std::cerr << "Test failed: " << ex.what() << std::endl;
         return 1;